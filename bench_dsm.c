@@ -0,0 +1,610 @@
+#define _GNU_SOURCE
+#include "dsm.h"
+#include <math.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+// Benchmark do DSM: lança N processos locais (loopback), sincroniza-os por
+// pipes e executa a mesma carga em todos. O pai não inicializa o DSM; só
+// coordena as barreiras e soma os resultados. Com a mesma semente, cada
+// execução gera exatamente a mesma sequência de operações.
+
+typedef enum {
+    POPULARIDADE_UNIFORME = 0,
+    POPULARIDADE_ZIPF = 1,
+    POPULARIDADE_SEQUENCIAL = 2   // Varredura: cada thread percorre a memória a partir do seu trecho
+} Popularidade;
+
+typedef struct {
+    int num_processos;
+    int threads_por_processo;
+    long operacoes_por_thread;
+    long aquecimento_por_thread;  // Operações antes da medição (não contadas)
+    double fracao_leituras;
+    Popularidade popularidade;
+    double theta_zipf;
+    int tamanho_acesso;
+    int intervalo_release;        // Operações entre dsm_release (0 = só no fim)
+    unsigned long semente;
+    int porta_base;
+    ConfigDSM config;
+} ParametrosBench;
+
+// Enviado de cada processo ao pai no fim da execução
+typedef struct {
+    int falhou;
+    uint64_t leituras;
+    uint64_t escritas;
+    uint64_t erros;
+    uint64_t duracao_ns;
+    HistogramaLatencia latencia_leitura;
+    HistogramaLatencia latencia_escrita;
+    EstatisticasDSM stats;
+} ResultadoProcesso;
+
+typedef struct {
+    const ParametrosBench *parametros;
+    int indice_global;            // processo * threads_por_processo + thread
+    uint64_t aleatorio;           // Estado do gerador, preservado entre as fases
+    long posicao_varredura;       // POPULARIDADE_SEQUENCIAL: próxima posição da varredura
+    long operacoes;               // Operações da fase atual
+    int medindo;                  // 0 no aquecimento
+    HistogramaLatencia latencia_leitura;
+    HistogramaLatencia latencia_escrita;
+    uint64_t leituras;
+    uint64_t escritas;
+    uint64_t erros;
+} EstadoThread;
+
+static ParametrosBench parametros;
+static double *cdf_zipf = NULL;       // Probabilidade acumulada por posição no ranking
+static int *permutacao_blocos = NULL; // Bloco de cada posição no ranking (igual em todos os processos)
+static int canal_para_pai = -1;
+static int canal_do_pai = -1;
+
+// =============================================================================
+// GERAÇÃO DA CARGA
+// =============================================================================
+
+// xorshift64*: rápido e reproduzível a partir da semente
+static uint64_t proximo_aleatorio(uint64_t *estado) {
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * 2685821657736338717ULL;
+}
+
+static double aleatorio_unitario(uint64_t *estado) {
+    return (double)(proximo_aleatorio(estado) >> 11) / (double)(1ULL << 53);
+}
+
+// Prepara o ranking de popularidade: a CDF de Zipf sobre os blocos e uma
+// permutação que espalha os blocos mais populares entre os donos
+static int preparar_popularidade(int num_blocos) {
+    permutacao_blocos = (int*)malloc(num_blocos * sizeof(int));
+    if (!permutacao_blocos) return -1;
+    uint64_t estado = parametros.semente * 0x9E3779B97F4A7C15ULL + 1;
+    for (int i = 0; i < num_blocos; i++) permutacao_blocos[i] = i;
+    for (int i = num_blocos - 1; i > 0; i--) {
+        int j = (int)(proximo_aleatorio(&estado) % (uint64_t)(i + 1));
+        int t = permutacao_blocos[i];
+        permutacao_blocos[i] = permutacao_blocos[j];
+        permutacao_blocos[j] = t;
+    }
+
+    if (parametros.popularidade != POPULARIDADE_ZIPF) return 0;
+    cdf_zipf = (double*)malloc(num_blocos * sizeof(double));
+    if (!cdf_zipf) return -1;
+    double soma = 0.0;
+    for (int i = 0; i < num_blocos; i++) {
+        soma += 1.0 / pow((double)(i + 1), parametros.theta_zipf);
+        cdf_zipf[i] = soma;
+    }
+    for (int i = 0; i < num_blocos; i++) cdf_zipf[i] /= soma;
+    return 0;
+}
+
+static int sortear_bloco(uint64_t *estado, int num_blocos) {
+    if (parametros.popularidade == POPULARIDADE_UNIFORME) {
+        return (int)(proximo_aleatorio(estado) % (uint64_t)num_blocos);
+    }
+
+    // Zipf: busca binária na CDF
+    double u = aleatorio_unitario(estado);
+    int inicio = 0, fim = num_blocos - 1;
+    while (inicio < fim) {
+        int meio = (inicio + fim) / 2;
+        if (cdf_zipf[meio] < u) inicio = meio + 1;
+        else fim = meio;
+    }
+    return permutacao_blocos[inicio];
+}
+
+static uint64_t agora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+// Executa as operações de uma fase (aquecimento ou medição) em uma thread
+static void* executar_carga(void *arg) {
+    EstadoThread *estado_thread = (EstadoThread*)arg;
+    const ParametrosBench *p = estado_thread->parametros;
+    int tamanho_bloco = dsm_global->tamanho_bloco;
+    int num_blocos = dsm_global->num_blocos;
+    int tamanho_memoria = dsm_global->tamanho_memoria;
+    int tamanho = p->tamanho_acesso < tamanho_memoria ? p->tamanho_acesso : tamanho_memoria;
+
+    byte *buffer = (byte*)malloc(tamanho);
+    if (!buffer) {
+        estado_thread->erros++;
+        return NULL;
+    }
+
+    for (long op = 0; op < estado_thread->operacoes; op++) {
+        int posicao;
+        if (p->popularidade == POPULARIDADE_SEQUENCIAL) {
+            if (estado_thread->posicao_varredura + tamanho > tamanho_memoria) estado_thread->posicao_varredura = 0;
+            posicao = (int)estado_thread->posicao_varredura;
+            estado_thread->posicao_varredura += tamanho;
+        } else {
+            // Posição aleatória dentro do bloco sorteado, sem passar do fim da memória
+            int id_bloco = sortear_bloco(&estado_thread->aleatorio, num_blocos);
+            int folga = tamanho_bloco - tamanho;
+            posicao = id_bloco * tamanho_bloco;
+            if (folga > 0) posicao += (int)(proximo_aleatorio(&estado_thread->aleatorio) % (uint64_t)(folga + 1));
+            if (posicao + tamanho > tamanho_memoria) posicao = tamanho_memoria - tamanho;
+        }
+        int leitura = aleatorio_unitario(&estado_thread->aleatorio) < p->fracao_leituras;
+
+        uint64_t inicio = agora_ns();
+        int resultado;
+        if (leitura) {
+            resultado = le(posicao, buffer, tamanho);
+        } else {
+            memset(buffer, (int)(op & 0xff), tamanho);
+            resultado = escreve(posicao, buffer, tamanho);
+        }
+        uint64_t duracao = agora_ns() - inicio;
+
+        if (p->intervalo_release > 0 && (op + 1) % p->intervalo_release == 0) {
+            dsm_release();
+        }
+
+        if (!estado_thread->medindo) continue;
+        if (resultado != 0) {
+            estado_thread->erros++;
+        } else if (leitura) {
+            estado_thread->leituras++;
+            registrar_no_histograma(&estado_thread->latencia_leitura, duracao);
+        } else {
+            estado_thread->escritas++;
+            registrar_no_histograma(&estado_thread->latencia_escrita, duracao);
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+// Roda uma fase em todas as threads do processo e espera o fim
+static int executar_fase(EstadoThread *estados, long operacoes, int medindo) {
+    int n = parametros.threads_por_processo;
+    pthread_t *threads = (pthread_t*)malloc(n * sizeof(pthread_t));
+    if (!threads) return -1;
+
+    int criadas = 0;
+    for (int i = 0; i < n; i++) {
+        estados[i].operacoes = operacoes;
+        estados[i].medindo = medindo;
+        if (pthread_create(&threads[i], NULL, executar_carga, &estados[i]) != 0) break;
+        criadas++;
+    }
+    for (int i = 0; i < criadas; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    return criadas == n ? 0 : -1;
+}
+
+// =============================================================================
+// COORDENAÇÃO ENTRE PROCESSOS
+// =============================================================================
+
+// Barreira: o filho informa ao pai se está pronto e espera a liberação.
+// Todos passam pelas mesmas barreiras; basta um processo falhar para o pai
+// responder 0 a todos e a execução ser abortada
+static int barreira_filho(int pronto) {
+    char c = pronto ? 1 : 0;
+    if (write(canal_para_pai, &c, 1) != 1) return -1;
+    if (read(canal_do_pai, &c, 1) != 1 || c == 0) return -1;
+    return pronto ? 0 : -1;
+}
+
+static int escrever_tudo(int fd, const void *dados, size_t tamanho) {
+    const char *p = (const char*)dados;
+    while (tamanho > 0) {
+        ssize_t n = write(fd, p, tamanho);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        tamanho -= n;
+    }
+    return 0;
+}
+
+static int ler_tudo(int fd, void *dados, size_t tamanho) {
+    char *p = (char*)dados;
+    while (tamanho > 0) {
+        ssize_t n = read(fd, p, tamanho);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        tamanho -= n;
+    }
+    return 0;
+}
+
+// Libera todos os filhos da barreira (ou aborta com liberar = 0).
+// Retorna -1 se algum filho não chegou
+static int barreira_pai(const int *de_filhos, const int *para_filhos, int n) {
+    char resposta = 1;
+    for (int i = 0; i < n; i++) {
+        char c;
+        if (ler_tudo(de_filhos[i], &c, 1) != 0 || c == 0) resposta = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (write(para_filhos[i], &resposta, 1) != 1) resposta = 0;
+    }
+    return resposta ? 0 : -1;
+}
+
+// Corpo de cada processo filho: inicializa o DSM, aquece, mede e envia o
+// ResultadoProcesso ao pai
+static int executar_processo(int meu_id) {
+    ResultadoProcesso resultado;
+    memset(&resultado, 0, sizeof(resultado));
+    resultado.falhou = 1;
+
+    InfoProcesso *processos = (InfoProcesso*)calloc(parametros.num_processos, sizeof(InfoProcesso));
+    EstadoThread *estados = (EstadoThread*)calloc(parametros.threads_por_processo, sizeof(EstadoThread));
+    if (!processos || !estados) {
+        free(processos);
+        free(estados);
+        escrever_tudo(canal_para_pai, &resultado, sizeof(resultado));
+        return 1;
+    }
+    for (int i = 0; i < parametros.num_processos; i++) {
+        processos[i].id = i;
+        strcpy(processos[i].ip, "127.0.0.1");
+        processos[i].porta = parametros.porta_base + i;
+    }
+
+    int inicializado = dsm_init_config(meu_id, processos, parametros.num_processos, &parametros.config) == 0;
+    if (inicializado && preparar_popularidade(dsm_global->num_blocos) != 0) inicializado = 0;
+
+    // Barreira 1: todos inicializados
+    int ok = barreira_filho(inicializado) == 0;
+
+    if (ok) {
+        int total_threads = parametros.num_processos * parametros.threads_por_processo;
+        for (int i = 0; i < parametros.threads_por_processo; i++) {
+            EstadoThread *e = &estados[i];
+            e->parametros = &parametros;
+            e->indice_global = meu_id * parametros.threads_por_processo + i;
+            e->aleatorio = (parametros.semente + 1) * 0x9E3779B97F4A7C15ULL ^ (uint64_t)(e->indice_global + 1) * 0xBF58476D1CE4E5B9ULL;
+            if (e->aleatorio == 0) e->aleatorio = 1;
+            // Varredura: cada thread começa no seu trecho da memória
+            e->posicao_varredura = (long)dsm_global->tamanho_memoria / total_threads * e->indice_global;
+        }
+
+        if (parametros.aquecimento_por_thread > 0) {
+            ok = executar_fase(estados, parametros.aquecimento_por_thread, 0) == 0;
+            dsm_release();
+        }
+    }
+
+    // Barreira 2: aquecimento concluído em todos; a medição começa zerada
+    ok = barreira_filho(ok) == 0;
+    if (ok) {
+        dsm_zerar_stats();
+        uint64_t inicio = agora_ns();
+        ok = executar_fase(estados, parametros.operacoes_por_thread, 1) == 0;
+        dsm_release();
+        resultado.duracao_ns = agora_ns() - inicio;
+
+        for (int i = 0; i < parametros.threads_por_processo; i++) {
+            resultado.leituras += estados[i].leituras;
+            resultado.escritas += estados[i].escritas;
+            resultado.erros += estados[i].erros;
+            somar_histogramas(&resultado.latencia_leitura, &estados[i].latencia_leitura);
+            somar_histogramas(&resultado.latencia_escrita, &estados[i].latencia_escrita);
+        }
+        dsm_get_stats(&resultado.stats);
+        resultado.falhou = 0;
+    }
+
+    // Barreira 3: ninguém encerra enquanto outro processo ainda pode pedir blocos
+    barreira_filho(ok);
+    escrever_tudo(canal_para_pai, &resultado, sizeof(resultado));
+
+    if (inicializado) dsm_cleanup();
+    free(cdf_zipf);
+    free(permutacao_blocos);
+    free(processos);
+    free(estados);
+    return resultado.falhou;
+}
+
+// =============================================================================
+// RELATÓRIO
+// =============================================================================
+
+static const char* nome_popularidade(Popularidade p) {
+    switch (p) {
+        case POPULARIDADE_ZIPF: return "zipf";
+        case POPULARIDADE_SEQUENCIAL: return "sequencial";
+        default: return "uniforme";
+    }
+}
+
+static void imprimir_latencia(const char *nome, const HistogramaLatencia *h) {
+    ResumoLatencia r;
+    resumir_histograma(h, &r);
+    if (r.amostras == 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "%s: sem amostras", nome);
+        return;
+    }
+    log_padronizado(COLOR_DEFAULT, "    • ", "%s: %llu ops, média %.1f us, p50 %.1f us, p99 %.1f us, p999 %.1f us, máx %.1f us",
+                    nome, (unsigned long long)r.amostras, r.media_ns / 1000.0,
+                    r.p50_ns / 1000.0, r.p99_ns / 1000.0, r.p999_ns / 1000.0, r.maximo_ns / 1000.0);
+}
+
+static void imprimir_relatorio(const ResultadoProcesso *resultados, int n) {
+    HistogramaLatencia leitura, escrita;
+    memset(&leitura, 0, sizeof(leitura));
+    memset(&escrita, 0, sizeof(escrita));
+    uint64_t leituras = 0, escritas = 0, erros = 0, duracao_ns = 0;
+    uint64_t bytes_enviados = 0, mensagens_enviadas = 0, hits = 0, misses = 0;
+    uint64_t revalidacoes = 0, respostas_delta = 0, escritas_sem_efeito = 0;
+    uint64_t invalidacoes = 0, atualizacoes_enviadas = 0, atualizacoes_aplicadas = 0;
+    uint64_t respostas_comprimidas = 0, bytes_sem_compressao = 0, bytes_comprimidos = 0;
+
+    for (int i = 0; i < n; i++) {
+        const ResultadoProcesso *r = &resultados[i];
+        leituras += r->leituras;
+        escritas += r->escritas;
+        erros += r->erros;
+        // A vazão usa o processo mais lento: todos começam juntos na barreira
+        if (r->duracao_ns > duracao_ns) duracao_ns = r->duracao_ns;
+        somar_histogramas(&leitura, &r->latencia_leitura);
+        somar_histogramas(&escrita, &r->latencia_escrita);
+        for (int t = 0; t < NUM_TIPOS_MENSAGEM; t++) {
+            bytes_enviados += r->stats.bytes_enviados[t];
+            mensagens_enviadas += r->stats.mensagens_enviadas[t];
+        }
+        hits += r->stats.cache_hits;
+        misses += r->stats.cache_misses;
+        revalidacoes += r->stats.revalidacoes;
+        respostas_delta += r->stats.respostas_delta;
+        escritas_sem_efeito += r->stats.escritas_sem_efeito;
+        invalidacoes += r->stats.invalidacoes_enviadas;
+        atualizacoes_enviadas += r->stats.atualizacoes_enviadas;
+        atualizacoes_aplicadas += r->stats.atualizacoes_aplicadas;
+        respostas_comprimidas += r->stats.respostas_comprimidas;
+        bytes_sem_compressao += r->stats.bytes_sem_compressao;
+        bytes_comprimidos += r->stats.bytes_comprimidos;
+    }
+
+    uint64_t ops = leituras + escritas;
+    double segundos = duracao_ns / 1e9;
+    double vazao = segundos > 0 ? ops / segundos : 0.0;
+    double bytes_por_op = ops > 0 ? (double)bytes_enviados / ops : 0.0;
+    double mensagens_por_op = ops > 0 ? (double)mensagens_enviadas / ops : 0.0;
+    double taxa_hits = hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0;
+
+    log_padronizado(COLOR_STEP, "\n█ ", "RESULTADO DO BENCHMARK");
+    log_padronizado(COLOR_DEFAULT, "    • ", "Carga: %d processos x %d threads, %s, %.0f%% leituras, acessos de %d bytes, semente %lu",
+                    parametros.num_processos, parametros.threads_por_processo, nome_popularidade(parametros.popularidade),
+                    parametros.fracao_leituras * 100.0, parametros.tamanho_acesso, parametros.semente);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Geometria: %d blocos de %d bytes", parametros.config.num_blocos, parametros.config.tamanho_bloco);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Operações: %llu (%llu leituras, %llu escritas, %llu erros) em %.3f s",
+                    (unsigned long long)ops, (unsigned long long)leituras, (unsigned long long)escritas,
+                    (unsigned long long)erros, segundos);
+    log_padronizado(COLOR_SUCCESS, "    • ", "Vazão: %.0f ops/s", vazao);
+    imprimir_latencia("Leitura", &leitura);
+    imprimir_latencia("Escrita", &escrita);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Rede: %.1f bytes/op, %.2f mensagens/op; cache: %.1f%% de acertos",
+                    bytes_por_op, mensagens_por_op, taxa_hits);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Versões: %llu cópias revalidadas sem reenvio, %llu atualizadas por trechos, %llu escritas sem efeito",
+                    (unsigned long long)revalidacoes, (unsigned long long)respostas_delta, (unsigned long long)escritas_sem_efeito);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Coerência: %llu invalidações, %llu atualizações de cópias (%llu aplicadas)",
+                    (unsigned long long)invalidacoes, (unsigned long long)atualizacoes_enviadas, (unsigned long long)atualizacoes_aplicadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "Compressão: %llu blocos, %llu -> %llu bytes (razão %.1f:1)",
+                    (unsigned long long)respostas_comprimidas, (unsigned long long)bytes_sem_compressao,
+                    (unsigned long long)bytes_comprimidos,
+                    bytes_comprimidos > 0 ? (double)bytes_sem_compressao / bytes_comprimidos : 0.0);
+
+    // Linha única chave=valor para comparar execuções com scripts
+    ResumoLatencia rl, re;
+    resumir_histograma(&leitura, &rl);
+    resumir_histograma(&escrita, &re);
+    printf("resumo: ops=%llu erros=%llu ops_s=%.0f bytes_op=%.1f msgs_op=%.2f "
+           "le_p50_ns=%llu le_p99_ns=%llu le_p999_ns=%llu "
+           "es_p50_ns=%llu es_p99_ns=%llu es_p999_ns=%llu\n",
+           (unsigned long long)ops, (unsigned long long)erros, vazao, bytes_por_op, mensagens_por_op,
+           (unsigned long long)rl.p50_ns, (unsigned long long)rl.p99_ns, (unsigned long long)rl.p999_ns,
+           (unsigned long long)re.p50_ns, (unsigned long long)re.p99_ns, (unsigned long long)re.p999_ns);
+    fflush(stdout);
+}
+
+// =============================================================================
+// LINHA DE COMANDO
+// =============================================================================
+
+static void imprimir_uso(const char *programa) {
+    fprintf(stderr,
+        "Uso: %s [opções]\n"
+        "  -n processos     Processos DSM locais (padrão 4)\n"
+        "  -t threads       Threads de carga por processo (padrão 1)\n"
+        "  -o operações     Operações medidas por thread (padrão 10000)\n"
+        "  -w operações     Operações de aquecimento por thread (padrão 1000)\n"
+        "  -l fração        Fração de leituras, de 0 a 1 (padrão 0.9)\n"
+        "  -p popularidade  uniforme, zipf ou sequencial (padrão uniforme)\n"
+        "  -z theta         Expoente da distribuição de Zipf (padrão 0.99)\n"
+        "  -a bytes         Tamanho de cada acesso (padrão 64)\n"
+        "  -r operações     dsm_release a cada N operações (padrão 0 = só no fim)\n"
+        "  -s semente       Semente da carga (padrão 1)\n"
+        "  -P porta         Porta do processo 0; os demais usam as seguintes (padrão 9000)\n"
+        "  -c arquivo       Arquivo de configuração do DSM (ver dsm_carregar_config)\n"
+        "  -k blocos        Número de blocos (sobrepõe o arquivo)\n"
+        "  -b bytes         Tamanho do bloco (sobrepõe o arquivo)\n"
+        "  -v               Mantém os logs do DSM no nível INFO\n",
+        programa);
+}
+
+static int ler_argumentos(int argc, char *argv[]) {
+    memset(&parametros, 0, sizeof(parametros));
+    parametros.num_processos = 4;
+    parametros.threads_por_processo = 1;
+    parametros.operacoes_por_thread = 10000;
+    parametros.aquecimento_por_thread = 1000;
+    parametros.fracao_leituras = 0.9;
+    parametros.popularidade = POPULARIDADE_UNIFORME;
+    parametros.theta_zipf = 0.99;
+    parametros.tamanho_acesso = 64;
+    parametros.semente = 1;
+    parametros.porta_base = 9000;
+    dsm_config_padrao(&parametros.config);
+    parametros.config.nivel_log = NIVEL_LOG_ERRO;
+
+    int num_blocos = 0, tamanho_bloco = 0, verboso = 0;
+    const char *arquivo_config = NULL;
+    int opcao;
+    while ((opcao = getopt(argc, argv, "n:t:o:w:l:p:z:a:r:s:P:c:k:b:vh")) != -1) {
+        switch (opcao) {
+            case 'n': parametros.num_processos = atoi(optarg); break;
+            case 't': parametros.threads_por_processo = atoi(optarg); break;
+            case 'o': parametros.operacoes_por_thread = atol(optarg); break;
+            case 'w': parametros.aquecimento_por_thread = atol(optarg); break;
+            case 'l': parametros.fracao_leituras = atof(optarg); break;
+            case 'p':
+                if (strcmp(optarg, "uniforme") == 0) parametros.popularidade = POPULARIDADE_UNIFORME;
+                else if (strcmp(optarg, "zipf") == 0) parametros.popularidade = POPULARIDADE_ZIPF;
+                else if (strcmp(optarg, "sequencial") == 0) parametros.popularidade = POPULARIDADE_SEQUENCIAL;
+                else return -1;
+                break;
+            case 'z': parametros.theta_zipf = atof(optarg); break;
+            case 'a': parametros.tamanho_acesso = atoi(optarg); break;
+            case 'r': parametros.intervalo_release = atoi(optarg); break;
+            case 's': parametros.semente = strtoul(optarg, NULL, 10); break;
+            case 'P': parametros.porta_base = atoi(optarg); break;
+            case 'c': arquivo_config = optarg; break;
+            case 'k': num_blocos = atoi(optarg); break;
+            case 'b': tamanho_bloco = atoi(optarg); break;
+            case 'v': verboso = 1; break;
+            default: return -1;
+        }
+    }
+
+    // O arquivo pode mudar o nível de log; -v continua valendo
+    if (arquivo_config && dsm_carregar_config(arquivo_config, &parametros.config) != 0) return -1;
+    if (num_blocos > 0) parametros.config.num_blocos = num_blocos;
+    if (tamanho_bloco > 0) parametros.config.tamanho_bloco = tamanho_bloco;
+    if (verboso) parametros.config.nivel_log = NIVEL_LOG_INFO;
+
+    if (parametros.num_processos < 1 || parametros.num_processos > MAX_PROCESSOS) return -1;
+    if (parametros.threads_por_processo < 1 || parametros.operacoes_por_thread < 1) return -1;
+    if (parametros.aquecimento_por_thread < 0 || parametros.intervalo_release < 0) return -1;
+    if (parametros.fracao_leituras < 0.0 || parametros.fracao_leituras > 1.0) return -1;
+    if (parametros.tamanho_acesso < 1 || parametros.theta_zipf < 0.0) return -1;
+    if (parametros.porta_base < 1 || parametros.porta_base + parametros.num_processos > 65535) return -1;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (ler_argumentos(argc, argv) != 0) {
+        imprimir_uso(argv[0]);
+        return 1;
+    }
+    // Um filho que morreu não deve derrubar o pai ao escrever no pipe dele
+    signal(SIGPIPE, SIG_IGN);
+
+    int n = parametros.num_processos;
+    pid_t *pids = (pid_t*)calloc(n, sizeof(pid_t));
+    int *de_filhos = (int*)malloc(n * sizeof(int));
+    int *para_filhos = (int*)malloc(n * sizeof(int));
+    ResultadoProcesso *resultados = (ResultadoProcesso*)calloc(n, sizeof(ResultadoProcesso));
+    if (!pids || !de_filhos || !para_filhos || !resultados) {
+        log_erro("    • ", "Erro ao alocar estruturas do benchmark");
+        return 1;
+    }
+
+    log_padronizado(COLOR_STEP, "\n█ ", "BENCHMARK DSM: %d processos em 127.0.0.1:%d-%d",
+                    n, parametros.porta_base, parametros.porta_base + n - 1);
+    fflush(stdout);
+
+    int lancados = 0;
+    for (int i = 0; i < n; i++) {
+        int subida[2], descida[2];
+        if (pipe(subida) != 0 || pipe(descida) != 0) break;
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            // Filho: fecha os canais dos irmãos lançados antes dele
+            for (int j = 0; j < i; j++) {
+                close(de_filhos[j]);
+                close(para_filhos[j]);
+            }
+            close(subida[0]);
+            close(descida[1]);
+            canal_para_pai = subida[1];
+            canal_do_pai = descida[0];
+            _exit(executar_processo(i));
+        }
+        close(subida[1]);
+        close(descida[0]);
+        pids[i] = pid;
+        de_filhos[i] = subida[0];
+        para_filhos[i] = descida[1];
+        lancados++;
+    }
+
+    int ok = lancados == n;
+    if (!ok) {
+        log_erro("    • ", "Erro ao lançar os processos: %s", strerror(errno));
+    } else {
+        // Inicialização, aquecimento e medição, nessa ordem
+        for (int fase = 0; fase < 3; fase++) {
+            if (barreira_pai(de_filhos, para_filhos, n) != 0) ok = 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (ler_tudo(de_filhos[i], &resultados[i], sizeof(ResultadoProcesso)) != 0 || resultados[i].falhou) {
+                ok = 0;
+            }
+        }
+    }
+
+    for (int i = 0; i < lancados; i++) {
+        close(de_filhos[i]);
+        close(para_filhos[i]);
+    }
+    for (int i = 0; i < lancados; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+
+    if (ok) {
+        imprimir_relatorio(resultados, n);
+    } else {
+        log_erro("    • ", "Benchmark abortado: algum processo falhou (use -v para ver os logs do DSM)");
+    }
+
+    free(pids);
+    free(de_filhos);
+    free(para_filhos);
+    free(resultados);
+    return ok ? 0 : 1;
+}
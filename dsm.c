@@ -1,440 +1,3768 @@
+#define _GNU_SOURCE
 #include "dsm.h"
 #include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <limits.h>
+#include <ctype.h>
+#include <sched.h>
+
+#ifndef MPOL_LOCAL
+#define MPOL_LOCAL 4  // linux/mempolicy.h: aloca no nó da CPU que toca a página
+#endif
 
 // Variável global do sistema
 SistemaDSM *dsm_global = NULL;
 
-// Contadores para estatísticas
-static int cache_hits = 0;
-static int cache_misses = 0;
-static int invalidacoes_enviadas = 0;
-static int invalidacoes_recebidas = 0;
+// Contadores para estatísticas (na ordem dos campos de EstatisticasDSM)
+typedef enum {
+    CACHE_HITS,
+    CACHE_MISSES,
+    INVALIDACOES_ENVIADAS,
+    INVALIDACOES_RECEBIDAS,
+    SUBSTITUICOES_CACHE,
+    ESCRITAS_ADIADAS,
+    ESCRITAS_REMOTAS_ENVIADAS,
+    ESCRITAS_REMOTAS_RECEBIDAS,
+    MIGRACOES_ENVIADAS,
+    MIGRACOES_RECEBIDAS,
+    REDIRECIONAMENTOS,
+    REVALIDACOES,
+    ESCRITAS_SEM_EFEITO,
+    RESPOSTAS_DELTA,
+    ATUALIZACOES_ENVIADAS,
+    ATUALIZACOES_APLICADAS,
+    RESPOSTAS_COMPRIMIDAS,
+    BYTES_SEM_COMPRESSAO,
+    BYTES_COMPRIMIDOS,
+    PREFETCH_EMITIDOS,
+    PREFETCH_ACERTOS,
+    PREFETCH_DESPERDICADOS,
+    NUM_CONTADORES
+} Contador;
+
+// Cada thread atualiza o seu fragmento, alinhado à linha de cache para que
+// threads diferentes não disputem as mesmas linhas. A leitura soma todos.
+typedef struct {
+    uint64_t contadores[NUM_CONTADORES];
+    uint64_t mensagens_enviadas[NUM_TIPOS_MENSAGEM];
+    uint64_t bytes_enviados[NUM_TIPOS_MENSAGEM];
+    uint64_t mensagens_recebidas[NUM_TIPOS_MENSAGEM];
+    uint64_t bytes_recebidos[NUM_TIPOS_MENSAGEM];
+    HistogramaLatencia latencias[NUM_LATENCIAS];
+} __attribute__((aligned(64))) FragmentoEstatisticas;
+
+static FragmentoEstatisticas fragmentos_estatisticas[NUM_FRAGMENTOS_ESTATISTICAS];
+static int proximo_fragmento = 0;
+static __thread FragmentoEstatisticas *fragmento_da_thread = NULL;
+
+static inline FragmentoEstatisticas *meu_fragmento(void) {
+    if (!fragmento_da_thread) {
+        int i = __atomic_fetch_add(&proximo_fragmento, 1, __ATOMIC_RELAXED);
+        fragmento_da_thread = &fragmentos_estatisticas[i % NUM_FRAGMENTOS_ESTATISTICAS];
+    }
+    return fragmento_da_thread;
+}
+
+static inline void contar(Contador contador) {
+    __atomic_fetch_add(&meu_fragmento()->contadores[contador], 1, __ATOMIC_RELAXED);
+}
+
+static inline void somar(Contador contador, uint64_t valor) {
+    __atomic_fetch_add(&meu_fragmento()->contadores[contador], valor, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t agora_ns(void) {
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return (uint64_t)agora.tv_sec * 1000000000ULL + (uint64_t)agora.tv_nsec;
+}
+
+// Balde log-linear: valores abaixo de 2^BITS têm um balde cada; acima,
+// cada potência de 2 é dividida em 2^BITS baldes de mesma largura
+static inline int balde_latencia(uint64_t ns) {
+    const int sub = 1 << BITS_SUBBALDES_LATENCIA;
+    if (ns < (uint64_t)sub) return (int)ns;
+    int expoente = 63 - __builtin_clzll(ns);
+    return ((expoente - BITS_SUBBALDES_LATENCIA + 1) << BITS_SUBBALDES_LATENCIA) +
+           (int)((ns >> (expoente - BITS_SUBBALDES_LATENCIA)) & (uint64_t)(sub - 1));
+}
+
+// Maior valor que cai no balde
+static uint64_t limite_balde_latencia(int balde) {
+    const int sub = 1 << BITS_SUBBALDES_LATENCIA;
+    if (balde < sub) return (uint64_t)balde;
+    int deslocamento = (balde >> BITS_SUBBALDES_LATENCIA) - 1;
+    uint64_t inicio = (uint64_t)(sub + (balde & (sub - 1))) << deslocamento;
+    return inicio + ((uint64_t)1 << deslocamento) - 1;
+}
+
+void registrar_no_histograma(HistogramaLatencia *h, uint64_t ns) {
+    __atomic_fetch_add(&h->amostras, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->soma_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->baldes[balde_latencia(ns)], 1, __ATOMIC_RELAXED);
+    
+    uint64_t atual = __atomic_load_n(&h->maximo_ns, __ATOMIC_RELAXED);
+    while (ns > atual && !__atomic_compare_exchange_n(&h->maximo_ns, &atual, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    atual = __atomic_load_n(&h->minimo_ns, __ATOMIC_RELAXED);
+    while ((atual == 0 || ns < atual) &&
+           !__atomic_compare_exchange_n(&h->minimo_ns, &atual, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void registrar_latencia(TipoLatencia tipo, uint64_t ns) {
+    registrar_no_histograma(&meu_fragmento()->latencias[tipo], ns);
+}
+
+// Contabiliza uma mensagem de rede (cabeçalho e payload) do tipo dado
+static void contar_mensagem(int tipo, int tamanho_dados, int enviada) {
+    FragmentoEstatisticas *f = meu_fragmento();
+    int i = (tipo > 0 && tipo < NUM_TIPOS_MENSAGEM) ? tipo : 0;
+    uint64_t bytes = (uint64_t)TAMANHO_CABECALHO + (tamanho_dados > 0 ? (uint64_t)tamanho_dados : 0);
+    if (enviada) {
+        __atomic_fetch_add(&f->mensagens_enviadas[i], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&f->bytes_enviados[i], bytes, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&f->mensagens_recebidas[i], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&f->bytes_recebidos[i], bytes, __ATOMIC_RELAXED);
+    }
+}
 
 // =============================================================================
 // FUNÇÕES DE DEBUG E UTILIDADES
 // =============================================================================
 
 
-// Função de log padronizada
+// Log assíncrono: fila circular limitada com vários produtores e um único
+// consumidor. Cada entrada tem um número de sequência: igual à posição
+// quando livre para a escrita e posição + 1 quando a linha está pronta.
+// Produtores reservam posições com CAS e nunca bloqueiam.
+typedef struct {
+    uint64_t sequencia;
+    int tamanho;
+    char texto[TAMANHO_LINHA_LOG];
+} EntradaLog;
+
+static EntradaLog anel_log[CAPACIDADE_ANEL_LOG];
+static uint64_t cabeca_anel_log = 0;  // Próxima posição a reservar
+static uint64_t cauda_anel_log = 0;   // Próxima posição a escrever (só a thread de log)
+static int log_assincrono_ativo = 0;
+static int thread_log_rodando = 0;
+static pthread_t thread_log;
+static int logs_descartados = 0;
+static int produtores_log = 0;        // Threads entre a checagem do modo assíncrono e o fim da reserva
+
+int nivel_log_minimo = NIVEL_LOG_PADRAO;
+
+// Formata "cor prefixo mensagem reset\n" em destino; devolve os bytes
+// escritos (a linha é truncada se não couber)
+static int formatar_linha_log(char *destino, int capacidade, const char *cor, const char *prefixo,
+                              const char *formato, va_list args) {
+    int n = snprintf(destino, capacidade, "%s%s", cor, prefixo);
+    if (n < 0 || n >= capacidade) n = capacidade - 1;
+    int m = vsnprintf(destino + n, capacidade - n, formato, args);
+    n = (m < 0 || m >= capacidade - n) ? capacidade - 1 : n + m;
+    
+    // Garantir espaço para o reset da cor e a quebra de linha
+    int final = (int)strlen(COLOR_RESET) + 1;
+    if (n > capacidade - 1 - final) n = capacidade - 1 - final;
+    memcpy(destino + n, COLOR_RESET "\n", final + 1);
+    return n + final;
+}
+
+// Reserva uma entrada do anel e formata a linha nela. Devolve -1 com o anel
+// cheio, sem esperar pela thread de log.
+static int enfileirar_log(const char *cor, const char *prefixo, const char *formato, va_list args) {
+    uint64_t posicao = __atomic_load_n(&cabeca_anel_log, __ATOMIC_RELAXED);
+    EntradaLog *entrada;
+    for (;;) {
+        entrada = &anel_log[posicao & (CAPACIDADE_ANEL_LOG - 1)];
+        uint64_t sequencia = __atomic_load_n(&entrada->sequencia, __ATOMIC_ACQUIRE);
+        int64_t diferenca = (int64_t)(sequencia - posicao);
+        if (diferenca == 0) {
+            if (__atomic_compare_exchange_n(&cabeca_anel_log, &posicao, posicao + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diferenca < 0) {
+            return -1;  // Entrada ainda não escrita pela thread de log: anel cheio
+        } else {
+            posicao = __atomic_load_n(&cabeca_anel_log, __ATOMIC_RELAXED);
+        }
+    }
+    
+    entrada->tamanho = formatar_linha_log(entrada->texto, TAMANHO_LINHA_LOG, cor, prefixo, formato, args);
+    __atomic_store_n(&entrada->sequencia, posicao + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Escreve as linhas prontas do anel, na ordem de reserva. Devolve quantas
+// foram escritas; para na primeira entrada reservada e ainda não pronta.
+static int esvaziar_anel_log(void) {
+    int escritas = 0;
+    for (;;) {
+        EntradaLog *entrada = &anel_log[cauda_anel_log & (CAPACIDADE_ANEL_LOG - 1)];
+        if (__atomic_load_n(&entrada->sequencia, __ATOMIC_ACQUIRE) != cauda_anel_log + 1) {
+            break;
+        }
+        fwrite(entrada->texto, 1, entrada->tamanho, stdout);
+        __atomic_store_n(&entrada->sequencia, cauda_anel_log + CAPACIDADE_ANEL_LOG, __ATOMIC_RELEASE);
+        cauda_anel_log++;
+        escritas++;
+    }
+    if (escritas > 0) {
+        fflush(stdout);
+    }
+    return escritas;
+}
+
+static void* thread_escrita_log(void* arg) {
+    (void)arg; // Suprimir warning de parâmetro não utilizado
+    while (__atomic_load_n(&thread_log_rodando, __ATOMIC_ACQUIRE)) {
+        if (esvaziar_anel_log() == 0) {
+            usleep(ESPERA_ANEL_LOG_US);
+        }
+    }
+    
+    // Novas linhas já vão direto para a saída; esperar as reservadas antes da parada
+    while (cauda_anel_log != __atomic_load_n(&cabeca_anel_log, __ATOMIC_ACQUIRE)) {
+        if (esvaziar_anel_log() == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Passa a enviar os logs para o anel, escritos por uma thread de fundo
+int dsm_iniciar_log_assincrono(void) {
+    if (__atomic_load_n(&thread_log_rodando, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < CAPACIDADE_ANEL_LOG; i++) {
+        anel_log[i].sequencia = cauda_anel_log + i;
+    }
+    __atomic_store_n(&cabeca_anel_log, cauda_anel_log, __ATOMIC_RELAXED);
+    
+    thread_log_rodando = 1;
+    if (pthread_create(&thread_log, NULL, thread_escrita_log, NULL) != 0) {
+        thread_log_rodando = 0;
+        log_erro("    • ", "[P?] Erro ao criar thread de log; logs continuam síncronos");
+        return -1;
+    }
+    __atomic_store_n(&log_assincrono_ativo, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Volta aos logs síncronos depois de escrever todas as linhas pendentes
+void dsm_parar_log_assincrono(void) {
+    if (!__atomic_load_n(&thread_log_rodando, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(&log_assincrono_ativo, 0, __ATOMIC_SEQ_CST);
+    
+    // Quem viu o modo assíncrono ativo ainda pode estar reservando uma entrada;
+    // a thread de log só para depois que essas linhas entram no anel
+    while (__atomic_load_n(&produtores_log, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+    __atomic_store_n(&thread_log_rodando, 0, __ATOMIC_RELEASE);
+    pthread_join(thread_log, NULL);
+}
+
+void dsm_definir_nivel_log(NivelLog nivel) {
+    __atomic_store_n(&nivel_log_minimo, (int)nivel, __ATOMIC_RELAXED);
+}
+
+static void registrar_log(NivelLog nivel, const char *cor, const char *prefixo, const char *formato, va_list args) {
+    if ((int)nivel < __atomic_load_n(&nivel_log_minimo, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    if (__atomic_load_n(&log_assincrono_ativo, __ATOMIC_ACQUIRE)) {
+        // Registrar-se antes de confirmar o modo, para a parada esperar esta linha
+        __atomic_fetch_add(&produtores_log, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&log_assincrono_ativo, __ATOMIC_SEQ_CST)) {
+            if (enfileirar_log(cor, prefixo, formato, args) != 0) {
+                __atomic_fetch_add(&logs_descartados, 1, __ATOMIC_RELAXED);
+            }
+            __atomic_fetch_sub(&produtores_log, 1, __ATOMIC_RELEASE);
+            return;
+        }
+        __atomic_fetch_sub(&produtores_log, 1, __ATOMIC_RELEASE);
+    }
+    
+    // Uma única escrita por linha, para que linhas de threads diferentes não se misturem
+    char linha[1024];
+    int tamanho = formatar_linha_log(linha, sizeof(linha), cor, prefixo, formato, args);
+    fwrite(linha, 1, tamanho, stdout);
+    fflush(stdout);
+}
+
+void log_nivel(NivelLog nivel, const char *cor, const char *prefixo, const char *formato, ...) {
+    va_list args;
+    va_start(args, formato);
+    registrar_log(nivel, cor, prefixo, formato, args);
+    va_end(args);
+}
+
+// Função de log padronizada (nível INFO; erros usam log_erro)
 void log_padronizado(const char *cor, const char *prefixo, const char *formato, ...) {
     va_list args;
     va_start(args, formato);
+    registrar_log(NIVEL_LOG_INFO, cor, prefixo, formato, args);
+    va_end(args);
+}
+
+// Percentil (0..1) de um histograma somado: limite superior do primeiro
+// balde que alcança a fração pedida das amostras, limitado ao máximo
+static uint64_t percentil_latencia(const HistogramaLatencia *h, double fracao) {
+    if (h->amostras == 0) return 0;
+    uint64_t alvo = (uint64_t)(fracao * (double)h->amostras + 0.999999);
+    if (alvo == 0) alvo = 1;
+    uint64_t acumulado = 0;
+    for (int b = 0; b < NUM_BALDES_LATENCIA; b++) {
+        acumulado += h->baldes[b];
+        if (acumulado >= alvo) {
+            uint64_t limite = limite_balde_latencia(b);
+            return limite < h->maximo_ns ? limite : h->maximo_ns;
+        }
+    }
+    return h->maximo_ns;
+}
+
+// Acumula origem em destino (origem pode estar sendo atualizado)
+void somar_histogramas(HistogramaLatencia *destino, const HistogramaLatencia *origem) {
+    uint64_t minimo = __atomic_load_n(&origem->minimo_ns, __ATOMIC_RELAXED);
+    uint64_t maximo = __atomic_load_n(&origem->maximo_ns, __ATOMIC_RELAXED);
+    destino->amostras += __atomic_load_n(&origem->amostras, __ATOMIC_RELAXED);
+    destino->soma_ns += __atomic_load_n(&origem->soma_ns, __ATOMIC_RELAXED);
+    if (minimo != 0 && (destino->minimo_ns == 0 || minimo < destino->minimo_ns)) destino->minimo_ns = minimo;
+    if (maximo > destino->maximo_ns) destino->maximo_ns = maximo;
+    for (int b = 0; b < NUM_BALDES_LATENCIA; b++) {
+        destino->baldes[b] += __atomic_load_n(&origem->baldes[b], __ATOMIC_RELAXED);
+    }
+}
+
+void resumir_histograma(const HistogramaLatencia *h, ResumoLatencia *resumo) {
+    resumo->amostras = h->amostras;
+    resumo->minimo_ns = h->minimo_ns;
+    resumo->maximo_ns = h->maximo_ns;
+    resumo->media_ns = h->amostras > 0 ? (double)h->soma_ns / (double)h->amostras : 0.0;
+    resumo->p50_ns = percentil_latencia(h, 0.50);
+    resumo->p90_ns = percentil_latencia(h, 0.90);
+    resumo->p99_ns = percentil_latencia(h, 0.99);
+    resumo->p999_ns = percentil_latencia(h, 0.999);
+}
+
+// Soma os fragmentos de todas as threads. Pode ser chamada a qualquer
+// momento (inclusive antes do dsm_init); com atividade concorrente, os
+// valores de campos diferentes podem não ser do mesmo instante.
+int dsm_get_stats(EstatisticasDSM *stats) {
+    if (!stats) return -1;
+    memset(stats, 0, sizeof(EstatisticasDSM));
+    
+    uint64_t contadores[NUM_CONTADORES] = {0};
+    HistogramaLatencia somas[NUM_LATENCIAS];
+    memset(somas, 0, sizeof(somas));
+    
+    for (int f = 0; f < NUM_FRAGMENTOS_ESTATISTICAS; f++) {
+        FragmentoEstatisticas *fragmento = &fragmentos_estatisticas[f];
+        for (int c = 0; c < NUM_CONTADORES; c++) {
+            contadores[c] += __atomic_load_n(&fragmento->contadores[c], __ATOMIC_RELAXED);
+        }
+        for (int t = 0; t < NUM_TIPOS_MENSAGEM; t++) {
+            stats->mensagens_enviadas[t] += __atomic_load_n(&fragmento->mensagens_enviadas[t], __ATOMIC_RELAXED);
+            stats->bytes_enviados[t] += __atomic_load_n(&fragmento->bytes_enviados[t], __ATOMIC_RELAXED);
+            stats->mensagens_recebidas[t] += __atomic_load_n(&fragmento->mensagens_recebidas[t], __ATOMIC_RELAXED);
+            stats->bytes_recebidos[t] += __atomic_load_n(&fragmento->bytes_recebidos[t], __ATOMIC_RELAXED);
+        }
+        for (int l = 0; l < NUM_LATENCIAS; l++) {
+            somar_histogramas(&somas[l], &fragmento->latencias[l]);
+        }
+    }
+    
+    stats->cache_hits = contadores[CACHE_HITS];
+    stats->cache_misses = contadores[CACHE_MISSES];
+    stats->invalidacoes_enviadas = contadores[INVALIDACOES_ENVIADAS];
+    stats->invalidacoes_recebidas = contadores[INVALIDACOES_RECEBIDAS];
+    stats->substituicoes_cache = contadores[SUBSTITUICOES_CACHE];
+    stats->escritas_adiadas = contadores[ESCRITAS_ADIADAS];
+    stats->escritas_remotas_enviadas = contadores[ESCRITAS_REMOTAS_ENVIADAS];
+    stats->escritas_remotas_recebidas = contadores[ESCRITAS_REMOTAS_RECEBIDAS];
+    stats->migracoes_enviadas = contadores[MIGRACOES_ENVIADAS];
+    stats->migracoes_recebidas = contadores[MIGRACOES_RECEBIDAS];
+    stats->redirecionamentos = contadores[REDIRECIONAMENTOS];
+    stats->revalidacoes = contadores[REVALIDACOES];
+    stats->escritas_sem_efeito = contadores[ESCRITAS_SEM_EFEITO];
+    stats->respostas_delta = contadores[RESPOSTAS_DELTA];
+    stats->atualizacoes_enviadas = contadores[ATUALIZACOES_ENVIADAS];
+    stats->atualizacoes_aplicadas = contadores[ATUALIZACOES_APLICADAS];
+    stats->respostas_comprimidas = contadores[RESPOSTAS_COMPRIMIDAS];
+    stats->bytes_sem_compressao = contadores[BYTES_SEM_COMPRESSAO];
+    stats->bytes_comprimidos = contadores[BYTES_COMPRIMIDOS];
+    stats->prefetch_emitidos = contadores[PREFETCH_EMITIDOS];
+    stats->prefetch_acertos = contadores[PREFETCH_ACERTOS];
+    stats->prefetch_desperdicados = contadores[PREFETCH_DESPERDICADOS];
+    stats->logs_descartados = (uint64_t)__atomic_load_n(&logs_descartados, __ATOMIC_RELAXED);
+    
+    for (int l = 0; l < NUM_LATENCIAS; l++) {
+        resumir_histograma(&somas[l], &stats->latencias[l]);
+    }
+    return 0;
+}
+
+// Zera contadores e histogramas (para medir uma fase isolada); incrementos
+// concorrentes com a chamada podem se perder
+void dsm_zerar_stats(void) {
+    memset(fragmentos_estatisticas, 0, sizeof(fragmentos_estatisticas));
+    __atomic_store_n(&logs_descartados, 0, __ATOMIC_RELAXED);
+}
+
+void imprimir_estatisticas(int id) {
+    static const char *nomes_latencias[NUM_LATENCIAS] = {
+        "Leitura local", "Cache hit", "Busca remota", "Escrita"
+    };
+    EstatisticasDSM stats;
+    dsm_get_stats(&stats);
+    
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache hits: %llu", id, (unsigned long long)stats.cache_hits);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache misses: %llu", id, (unsigned long long)stats.cache_misses);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidações enviadas: %llu", id, (unsigned long long)stats.invalidacoes_enviadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidações recebidas: %llu", id, (unsigned long long)stats.invalidacoes_recebidas);
+    uint64_t acessos = stats.cache_hits + stats.cache_misses;
+    float taxa = acessos > 0 ? (stats.cache_hits * 100.0) / acessos : 0.0;
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Taxa de acerto do cache: %.2f%%", id, taxa);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Substituições no cache: %llu", id, (unsigned long long)stats.substituicoes_cache);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Escritas com invalidação adiada para o release: %llu", id, (unsigned long long)stats.escritas_adiadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Escritas enviadas a outros donos: %llu", id, (unsigned long long)stats.escritas_remotas_enviadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Escritas recebidas de outros processos: %llu", id, (unsigned long long)stats.escritas_remotas_recebidas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Blocos migrados para outros processos: %llu", id, (unsigned long long)stats.migracoes_enviadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Blocos recebidos por migração: %llu", id, (unsigned long long)stats.migracoes_recebidas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Requisições redirecionadas: %llu", id, (unsigned long long)stats.redirecionamentos);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cópias revalidadas sem reenvio do bloco: %llu", id, (unsigned long long)stats.revalidacoes);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Escritas sem efeito (bytes iguais): %llu", id, (unsigned long long)stats.escritas_sem_efeito);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cópias atualizadas só com os trechos alterados: %llu", id, (unsigned long long)stats.respostas_delta);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Atualizações enviadas a cópias remotas: %llu", id, (unsigned long long)stats.atualizacoes_enviadas);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Atualizações recebidas aplicadas na cópia local: %llu", id, (unsigned long long)stats.atualizacoes_aplicadas);
+    double razao = stats.bytes_comprimidos > 0 ? (double)stats.bytes_sem_compressao / stats.bytes_comprimidos : 0.0;
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Blocos enviados comprimidos: %llu (%llu -> %llu bytes, razão %.1f:1)", id,
+                    (unsigned long long)stats.respostas_comprimidas, (unsigned long long)stats.bytes_sem_compressao,
+                    (unsigned long long)stats.bytes_comprimidos, razao);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Blocos trazidos pelo prefetch: %llu", id, (unsigned long long)stats.prefetch_emitidos);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Acertos do prefetch: %llu", id, (unsigned long long)stats.prefetch_acertos);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Prefetches desperdiçados (invalidados antes do uso): %llu", id, (unsigned long long)stats.prefetch_desperdicados);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Linhas de log descartadas (anel cheio): %llu", id, (unsigned long long)stats.logs_descartados);
+    
+    for (int l = 0; l < NUM_LATENCIAS; l++) {
+        ResumoLatencia *r = &stats.latencias[l];
+        if (r->amostras == 0) continue;
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Latência %s: %llu amostras, média %.0fns, p50 %lluns, p99 %lluns, p99.9 %lluns, máx %lluns",
+                       id, nomes_latencias[l], (unsigned long long)r->amostras, r->media_ns, (unsigned long long)r->p50_ns,
+                       (unsigned long long)r->p99_ns, (unsigned long long)r->p999_ns, (unsigned long long)r->maximo_ns);
+    }
+    for (int t = 0; t < NUM_TIPOS_MENSAGEM; t++) {
+        if (stats.mensagens_enviadas[t] == 0 && stats.mensagens_recebidas[t] == 0) continue;
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Mensagens tipo %d: %llu enviadas (%llu bytes), %llu recebidas (%llu bytes)",
+                       id, t, (unsigned long long)stats.mensagens_enviadas[t], (unsigned long long)stats.bytes_enviados[t],
+                       (unsigned long long)stats.mensagens_recebidas[t], (unsigned long long)stats.bytes_recebidos[t]);
+    }
+}
+
+void imprimir_estado_cache(void) {
+    int id = dsm_global->meu_id;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] ESTADO DO CACHE", id);
+    int blocos_validos = 0;
+    pthread_mutex_lock(&dsm_global->mutex_cache);
+    for (int i = 0; i < dsm_global->capacidade_cache; i++) {
+        BlocoCache *slot = &dsm_global->slots_cache[i];
+        if (slot->id_bloco >= 0 && (slot->estado == CACHE_COMPARTILHADO || slot->estado == CACHE_MODIFICADO)) {
+            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d: %s", id, slot->id_bloco,
+                           slot->estado == CACHE_MODIFICADO ? "MODIFICADO" : "COMPARTILHADO");
+            blocos_validos++;
+        }
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_cache);
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Total de blocos em cache: %d de %d slots", id, blocos_validos, dsm_global->capacidade_cache);
+}
+
+// =============================================================================
+// FUNÇÕES AUXILIARES
+// =============================================================================
+
+// Dono conhecido do bloco. A distribuição inicial é por módulo (bloco i no
+// processo i % num_processos); depois cada migração atualiza o mapa
+int calcular_dono_bloco(int id_bloco) {
+    return __atomic_load_n(&dsm_global->dono_do_bloco[id_bloco], __ATOMIC_ACQUIRE);
+}
+
+// Registra um novo dono informado por outro processo. Apenas este processo
+// decide que um bloco é seu (ao instalá-lo), então avisos que apontam para
+// ele mesmo, ou que chegam depois de o bloco voltar a ser local, são ignorados
+static void atualizar_dono_conhecido(int id_bloco, int dono) {
+    if (id_bloco < 0 || id_bloco >= dsm_global->num_blocos || dono < 0 || dono >= dsm_global->num_processos ||
+        dono == dsm_global->meu_id) {
+        return;
+    }
+    pthread_mutex_lock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    if (dsm_global->indice_local[id_bloco] < 0) {
+        __atomic_store_n(&dsm_global->dono_do_bloco[id_bloco], dono, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+}
+
+int e_meu_bloco(int id_bloco) {
+    return calcular_dono_bloco(id_bloco) == dsm_global->meu_id;
+}
+
+static int comparar_inteiros(const void *a, const void *b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Índice do bloco em minha_memoria_local, ou -1 se o bloco não é deste processo
+int obter_indice_local(int id_bloco) {
+    if (id_bloco < 0 || id_bloco >= dsm_global->num_blocos) {
+        return -1;
+    }
+    return __atomic_load_n(&dsm_global->indice_local[id_bloco], __ATOMIC_ACQUIRE);
+}
+
+// Muda o índice do bloco (com a trava de posse); leitores o consultam sem trava
+static void definir_indice_local(int id_bloco, int idx_local) {
+    __atomic_store_n(&dsm_global->indice_local[id_bloco], idx_local, __ATOMIC_SEQ_CST);
+}
+
+// Endereço do bloco de índice idx_local na arena de memória local
+byte* obter_bloco_local(int idx_local) {
+    return dsm_global->minha_memoria_local + (size_t)idx_local * dsm_global->tamanho_bloco;
+}
+
+// Trava a posse do bloco e retorna seu índice local, com a trava mantida
+// até destravar_bloco_local. Retorna -1, sem trava, se o bloco não é (mais)
+// deste processo.
+static int travar_bloco_local(int id_bloco) {
+    if (id_bloco < 0 || id_bloco >= dsm_global->num_blocos) {
+        return -1;
+    }
+    pthread_mutex_lock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    int idx_local = dsm_global->indice_local[id_bloco];
+    if (idx_local < 0) {
+        pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    }
+    return idx_local;
+}
+
+static void destravar_bloco_local(int id_bloco) {
+    pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+}
+
+// Seqlock dos blocos locais: a versão do índice fica ímpar enquanto o
+// conteúdo é escrito. Escritores, já com a trava de posse, envolvem a
+// escrita com iniciar_escrita_bloco/concluir_escrita_bloco; leitores não
+// travam nada e refazem a cópia se validar_leitura_bloco falhar.
+static void iniciar_escrita_bloco(int idx_local) {
+    __atomic_fetch_add(&dsm_global->seqlock_blocos[idx_local], 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void concluir_escrita_bloco(int idx_local) {
+    __atomic_fetch_add(&dsm_global->seqlock_blocos[idx_local], 1, __ATOMIC_RELEASE);
+}
+
+// Começa uma leitura otimista de um bloco local: retorna o índice e guarda
+// a versão, ou retorna -1 se o bloco não é (mais) deste processo
+static int iniciar_leitura_bloco(int id_bloco, uint32_t *versao) {
+    for (;;) {
+        int idx_local = obter_indice_local(id_bloco);
+        if (idx_local < 0) {
+            return -1;
+        }
+        *versao = __atomic_load_n(&dsm_global->seqlock_blocos[idx_local], __ATOMIC_ACQUIRE);
+        if (!(*versao & 1)) {
+            return idx_local;
+        }
+        sched_yield();
+    }
+}
+
+// 1 se o que foi lido desde iniciar_leitura_bloco é um retrato consistente:
+// nenhuma escrita no meio e o índice ainda é deste bloco (não migrou nem
+// foi reaproveitado). A consulta ao índice é SEQ_CST, como a retirada dos
+// compartilhadores em migrar_bloco: um leitor que se registrou tarde demais
+// para ser invalidado vê o bloco fora do índice.
+static int validar_leitura_bloco(int id_bloco, int idx_local, uint32_t versao) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&dsm_global->seqlock_blocos[idx_local], __ATOMIC_RELAXED) == versao &&
+           __atomic_load_n(&dsm_global->indice_local[id_bloco], __ATOMIC_SEQ_CST) == idx_local;
+}
+
+// Conta um acesso de 'processo' ao bloco no índice idx_local da arena, para
+// o rebalanceador (nada a contar com a migração desligada)
+static void registrar_acesso_bloco(int idx_local, int processo) {
+    if (dsm_global->config.intervalo_migracao_ms > 0 && processo >= 0 && processo < dsm_global->num_processos) {
+        __atomic_fetch_add(&dsm_global->acessos_bloco[idx_local * dsm_global->num_processos + processo], 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Copia um bloco local inteiro; -1 se o bloco não é deste processo
+static int copiar_bloco_local(int id_bloco, byte *destino) {
+    uint32_t versao;
+    int idx_local;
+    do {
+        idx_local = iniciar_leitura_bloco(id_bloco, &versao);
+        if (idx_local < 0) {
+            return -1;
+        }
+        memcpy(destino, obter_bloco_local(idx_local), dsm_global->tamanho_bloco);
+    } while (!validar_leitura_bloco(id_bloco, idx_local, versao));
+    registrar_acesso_bloco(idx_local, dsm_global->meu_id);
+    return 0;
+}
+
+// Registra que 'processo' vai receber uma cópia do bloco local. Chamado antes
+// de ler os dados para a resposta: uma escrita concorrente ou já vê o
+// processo no diretório, ou terminou antes e a cópia enviada é a nova.
+static void registrar_compartilhador(int idx_local, int processo) {
+    __atomic_fetch_or(&dsm_global->compartilhadores[idx_local], (uint64_t)1 << processo, __ATOMIC_SEQ_CST);
+}
+
+// Retorna e zera os processos com cópia do bloco local. Chamado depois de
+// escrever os dados: quem pedir o bloco a partir daqui já recebe a versão nova.
+static uint64_t retirar_compartilhadores(int idx_local) {
+    return __atomic_exchange_n(&dsm_global->compartilhadores[idx_local], 0, __ATOMIC_SEQ_CST);
+}
+
+// Marca 'copias', recém-obtidas por uma escrita no bloco local, como em
+// invalidação até concluir_invalidacao, e retorna as cópias que a escrita
+// deve tratar: essas e as que outras escritas ainda estão invalidando (uma
+// escrita que encontra o diretório vazio não pode retornar antes delas).
+// Chamada com a trava de posse.
+static uint64_t assumir_invalidacao(int idx_local, uint64_t copias) {
+    uint64_t todas = copias | dsm_global->copias_em_invalidacao[idx_local];
+    uint32_t *assumidas = &dsm_global->invalidacoes_assumidas[idx_local * dsm_global->num_processos];
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        if (todas & ((uint64_t)1 << p)) {
+            assumidas[p]++;
+        }
+    }
+    dsm_global->copias_em_invalidacao[idx_local] = todas;
+    return todas;
+}
+
+// Fim do tratamento das cópias 'assumidas' (o retorno de
+// assumir_invalidacao) por uma escrita: as que nenhuma outra escrita está
+// invalidando deixam de estar em invalidação, e as 'sem_ack', que talvez
+// não tenham sido invalidadas, voltam ao diretório para a próxima escrita
+static void concluir_invalidacao(int id_bloco, uint64_t assumidas, uint64_t sem_ack) {
+    if (!assumidas && !sem_ack) {
+        return;
+    }
+    int idx_local = travar_bloco_local(id_bloco);
+    if (idx_local < 0) {
+        // O bloco migrou: as cópias foram invalidadas na migração
+        return;
+    }
+    uint32_t *contagem = &dsm_global->invalidacoes_assumidas[idx_local * dsm_global->num_processos];
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        uint64_t bit = (uint64_t)1 << p;
+        if ((assumidas & bit) && contagem[p] > 0 && --contagem[p] == 0) {
+            dsm_global->copias_em_invalidacao[idx_local] &= ~bit;
+        }
+    }
+    __atomic_fetch_or(&dsm_global->compartilhadores[idx_local], sem_ack, __ATOMIC_SEQ_CST);
+    destravar_bloco_local(id_bloco);
+}
+
+// Coloca um bloco local escrito na lista do próximo release
+static void marcar_bloco_sujo(int id_bloco) {
+    pthread_mutex_lock(&dsm_global->mutex_sujos);
+    if (!dsm_global->bloco_sujo[id_bloco]) {
+        dsm_global->bloco_sujo[id_bloco] = 1;
+        dsm_global->blocos_sujos[dsm_global->num_blocos_sujos++] = id_bloco;
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_sujos);
+    contar(ESCRITAS_ADIADAS);
+}
+
+// Guarda o trecho alterado pela escrita que gera 'versao' no histórico das
+// respostas delta. Chamada dentro do seqlock do índice.
+static void registrar_trecho_escrito(int idx_local, uint64_t versao, int inicio, int fim) {
+    int *guardadas = &dsm_global->versoes_no_historico[idx_local];
+    TrechoEscrito *trecho = &dsm_global->historico_escritas[idx_local * PROFUNDIDADE_DELTAS + versao % PROFUNDIDADE_DELTAS];
+    trecho->inicio = inicio;
+    trecho->fim = fim;
+    if (*guardadas < PROFUNDIDADE_DELTAS) {
+        (*guardadas)++;
+    }
+}
+
+// Obtém as cópias de um bloco local recém-escrito conforme o protocolo do
+// bloco: no de atualização elas continuam no diretório; no de invalidação
+// são retiradas. Retorna 1 se as cópias devem ser atualizadas. No modo
+// adaptativo, uma escrita por invalidação abre uma medição, e se a maioria
+// das cópias invalidadas voltar a ser lida até a escrita seguinte, as
+// próximas JANELA_ATUALIZACAO_ADAPTATIVA escritas atualizam. Chamada com a
+// trava de posse.
+static int recolher_copias(int id_bloco, int idx_local, uint64_t *copias) {
+    AdaptacaoBloco *adaptacao = &dsm_global->adaptacao[idx_local];
+    int atualizar = 0;
+    switch (__atomic_load_n(&dsm_global->protocolo_bloco[id_bloco], __ATOMIC_RELAXED)) {
+        case PROTOCOLO_ATUALIZACAO:
+            atualizar = 1;
+            break;
+        case PROTOCOLO_ADAPTATIVO: {
+            if (adaptacao->escritas_restantes > 0) {
+                adaptacao->escritas_restantes--;
+                atualizar = 1;
+                break;
+            }
+            uint32_t releituras = __atomic_exchange_n(&adaptacao->releituras, 0, __ATOMIC_RELAXED);
+            if (adaptacao->copias_invalidadas > 0 && 2 * releituras >= (uint32_t)adaptacao->copias_invalidadas) {
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d: %u de %d cópias invalidadas voltaram; propagando por atualização",
+                          dsm_global->meu_id, id_bloco, releituras, adaptacao->copias_invalidadas);
+                adaptacao->escritas_restantes = JANELA_ATUALIZACAO_ADAPTATIVA - 1;
+                atualizar = 1;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    if (atualizar) {
+        // Como na retirada, a consulta vem depois da escrita: quem se
+        // registrar a partir daqui já lê os dados novos
+        *copias = __atomic_load_n(&dsm_global->compartilhadores[idx_local], __ATOMIC_SEQ_CST);
+        adaptacao->copias_invalidadas = 0;
+    } else {
+        *copias = retirar_compartilhadores(idx_local);
+        adaptacao->copias_invalidadas = __builtin_popcountll(*copias);
+    }
+    return atualizar;
+}
+
+// Aplica uma escrita de 'processo' em um bloco local. Com 'copias', obtém
+// os processos com cópia do bloco, que o chamador deve invalidar ou, se
+// 'atualizacao->dados' ficar preenchido, atualizar (ver recolher_copias);
+// sem ele (modo CONSISTENCIA_RELEASE), o bloco entra na lista do próximo
+// release. As cópias obtidas ficam em invalidação até o chamador passá-las
+// a concluir_invalidacao. Uma escrita dos mesmos bytes que o bloco já tem
+// não muda a versão nem o diretório, mas ainda espera as cópias que outras
+// escritas estão invalidando. Retorna -1, sem escrever, se o bloco não é
+// mais deste processo.
+static int aplicar_escrita_local(int id_bloco, int offset, const byte *dados, int bytes, int processo,
+                                 uint64_t *copias, AtualizacaoCopia *atualizacao) {
+    int idx_local = travar_bloco_local(id_bloco);
+    if (idx_local < 0) {
+        return -1;
+    }
+    registrar_acesso_bloco(idx_local, processo);
+    
+    // Escritores estão serializados pela trava: a comparação não precisa do seqlock
+    byte *destino = obter_bloco_local(idx_local) + offset;
+    if (atualizacao) {
+        atualizacao->offset = offset;
+        atualizacao->bytes = bytes;
+        atualizacao->dados = NULL;
+        atualizacao->versao = dsm_global->versoes_dono[id_bloco];
+    }
+    if (memcmp(destino, dados, bytes) == 0) {
+        if (copias) *copias = assumir_invalidacao(idx_local, 0);
+        destravar_bloco_local(id_bloco);
+        contar(ESCRITAS_SEM_EFEITO);
+        return 0;
+    }
     
-    // Imprimir cor e prefixo
-    printf("%s%s", cor, prefixo);
+    // Só o trecho que de fato muda vai para o histórico das respostas delta
+    int inicio = 0;
+    int fim = bytes;
+    while (destino[inicio] == dados[inicio]) inicio++;
+    while (destino[fim - 1] == dados[fim - 1]) fim--;
     
-    // Imprimir o conteúdo formatado
-    vprintf(formato, args);
+    iniciar_escrita_bloco(idx_local);
+    memcpy(destino, dados, bytes);
+    // Com 64 bits, a versão não dá a volta: uma cópia antiga nunca tem o
+    // mesmo número que a atual
+    uint64_t versao = dsm_global->versoes_dono[id_bloco] + 1;
+    registrar_trecho_escrito(idx_local, versao, offset + inicio, offset + fim);
+    __atomic_store_n(&dsm_global->versoes_dono[id_bloco], versao, __ATOMIC_RELAXED);
+    concluir_escrita_bloco(idx_local);
+    if (copias) {
+        int atualizar = recolher_copias(id_bloco, idx_local, copias);
+        *copias = assumir_invalidacao(idx_local, *copias);
+        if (atualizacao) {
+            atualizacao->dados = atualizar ? dados : NULL;
+            atualizacao->versao = versao;
+        }
+    } else {
+        marcar_bloco_sujo(id_bloco);
+    }
+    destravar_bloco_local(id_bloco);
+    return 0;
+}
+
+// =============================================================================
+// CACHE DE BLOCOS REMOTOS
+// =============================================================================
+
+// As funções abaixo, exceto obter_bloco_cache e liberar_bloco_cache, são
+// chamadas com mutex_cache travado
+
+static int posicao_indice_cache(int id_bloco) {
+    return (int)(((uint32_t)id_bloco * 2654435761u) & (uint32_t)dsm_global->mascara_indice_cache);
+}
+
+static void remover_indice_cache(int slot) {
+    BlocoCache *slots = dsm_global->slots_cache;
+    int *anterior = &dsm_global->indice_cache[posicao_indice_cache(slots[slot].id_bloco)];
+    while (*anterior != slot) {
+        anterior = &slots[*anterior].proximo_hash;
+    }
+    *anterior = slots[slot].proximo_hash;
+}
+
+static void remover_lru(int slot) {
+    BlocoCache *slots = dsm_global->slots_cache;
+    if (slots[slot].anterior_lru >= 0) {
+        slots[slots[slot].anterior_lru].proximo_lru = slots[slot].proximo_lru;
+    } else {
+        dsm_global->inicio_lru = slots[slot].proximo_lru;
+    }
+    if (slots[slot].proximo_lru >= 0) {
+        slots[slots[slot].proximo_lru].anterior_lru = slots[slot].anterior_lru;
+    } else {
+        dsm_global->fim_lru = slots[slot].anterior_lru;
+    }
+}
+
+static void inserir_inicio_lru(int slot) {
+    BlocoCache *slots = dsm_global->slots_cache;
+    slots[slot].anterior_lru = -1;
+    slots[slot].proximo_lru = dsm_global->inicio_lru;
+    if (dsm_global->inicio_lru >= 0) {
+        slots[dsm_global->inicio_lru].anterior_lru = slot;
+    } else {
+        dsm_global->fim_lru = slot;
+    }
+    dsm_global->inicio_lru = slot;
+}
+
+static void registrar_uso_cache(int slot) {
+    switch (dsm_global->config.politica_cache) {
+        case POLITICA_CLOCK:
+            dsm_global->slots_cache[slot].referenciado = 1;
+            break;
+        case POLITICA_LRU:
+        default:
+            if (dsm_global->inicio_lru != slot) {
+                remover_lru(slot);
+                inserir_inicio_lru(slot);
+            }
+            break;
+    }
+}
+
+// Slot não fixado a ser reaproveitado, ou -1 se todos estão fixados
+static int escolher_vitima_cache(void) {
+    BlocoCache *slots = dsm_global->slots_cache;
     
-    // Reset da cor e quebra de linha
-    printf("%s\n", COLOR_RESET);
+    switch (dsm_global->config.politica_cache) {
+        case POLITICA_CLOCK:
+            // Segunda chance: duas voltas bastam para zerar todos os bits
+            for (int i = 0; i < 2 * dsm_global->capacidade_cache; i++) {
+                int slot = dsm_global->ponteiro_clock;
+                dsm_global->ponteiro_clock = (slot + 1) % dsm_global->capacidade_cache;
+                if (__atomic_load_n(&slots[slot].fixacoes, __ATOMIC_ACQUIRE) > 0) continue;
+                if (slots[slot].referenciado) {
+                    slots[slot].referenciado = 0;
+                    continue;
+                }
+                return slot;
+            }
+            return -1;
+        case POLITICA_LRU:
+        default:
+            for (int slot = dsm_global->fim_lru; slot >= 0; slot = slots[slot].anterior_lru) {
+                if (__atomic_load_n(&slots[slot].fixacoes, __ATOMIC_ACQUIRE) == 0) return slot;
+            }
+            return -1;
+    }
+}
+
+// Slot do bloco no cache, fixado até liberar_bloco_cache. Com 'criar', um
+// bloco ausente recebe um slot livre ou o da vítima da política de
+// substituição (em CACHE_INVALIDO). Retorna NULL se o bloco não está no
+// cache (sem 'criar') ou se todos os slots estão fixados.
+BlocoCache* obter_bloco_cache(int id_bloco, int criar) {
+    if (id_bloco < 0 || id_bloco >= dsm_global->num_blocos) {
+        return NULL;
+    }
+    
+    BlocoCache *slots = dsm_global->slots_cache;
+    pthread_mutex_lock(&dsm_global->mutex_cache);
+    
+    int posicao = posicao_indice_cache(id_bloco);
+    int slot = dsm_global->indice_cache[posicao];
+    while (slot >= 0 && slots[slot].id_bloco != id_bloco) {
+        slot = slots[slot].proximo_hash;
+    }
+    
+    if (slot < 0 && criar) {
+        slot = dsm_global->slots_livres;
+        if (slot >= 0) {
+            dsm_global->slots_livres = slots[slot].proximo_lru;
+        } else {
+            slot = escolher_vitima_cache();
+            if (slot >= 0) {
+                // Sem fixações ninguém mais referencia o slot
+                if (slots[slot].estado == CACHE_COMPARTILHADO && slots[slot].prefetch) {
+                    contar(PREFETCH_DESPERDICADOS);
+                }
+                remover_indice_cache(slot);
+                if (dsm_global->config.politica_cache == POLITICA_LRU) {
+                    remover_lru(slot);
+                }
+                contar(SUBSTITUICOES_CACHE);
+            }
+        }
+        
+        if (slot >= 0) {
+            slots[slot].id_bloco = id_bloco;
+            slots[slot].estado = CACHE_INVALIDO;
+            slots[slot].versao = 0;
+            slots[slot].invalidado_na_busca = 0;
+            slots[slot].prefetch = 0;
+            slots[slot].referenciado = 0;
+            slots[slot].proximo_hash = dsm_global->indice_cache[posicao];
+            dsm_global->indice_cache[posicao] = slot;
+            if (dsm_global->config.politica_cache == POLITICA_LRU) {
+                inserir_inicio_lru(slot);
+            }
+        }
+    }
+    
+    if (slot >= 0) {
+        __atomic_fetch_add(&slots[slot].fixacoes, 1, __ATOMIC_RELAXED);
+        if (criar) {
+            registrar_uso_cache(slot);
+        }
+    }
+    
+    pthread_mutex_unlock(&dsm_global->mutex_cache);
+    return slot >= 0 ? &slots[slot] : NULL;
+}
+
+// Desfaz a fixação de obter_bloco_cache (com o mutex do slot já solto).
+// Sem mutex_cache: um acerto no cache trava o mutex global uma única vez. A
+// escolha da vítima lê a fixação com acquire, e só depois o slot é reusado.
+void liberar_bloco_cache(BlocoCache *slot) {
+    __atomic_fetch_sub(&slot->fixacoes, 1, __ATOMIC_RELEASE);
+}
+
+// Aloca os slots, a memória de dados e o índice para 'memoria' bytes de cache
+static int alocar_cache(size_t memoria) {
+    int capacidade = (int)(memoria / dsm_global->tamanho_bloco);
+    if (capacidade < 1) capacidade = 1;
+    
+    int posicoes = 1;
+    while (posicoes < 2 * capacidade) {
+        posicoes <<= 1;
+    }
+    
+    dsm_global->slots_cache = (BlocoCache*)calloc(capacidade, sizeof(BlocoCache));
+    dsm_global->indice_cache = (int*)malloc(posicoes * sizeof(int));
+    // Reservada com mmap: as páginas só ocupam memória quando um slot é usado
+    byte *dados = (byte*)mmap(NULL, (size_t)capacidade * dsm_global->tamanho_bloco, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (!dsm_global->slots_cache || !dsm_global->indice_cache || dados == MAP_FAILED) {
+        if (dados != MAP_FAILED) {
+            munmap(dados, (size_t)capacidade * dsm_global->tamanho_bloco);
+        }
+        free(dsm_global->slots_cache);
+        free(dsm_global->indice_cache);
+        dsm_global->slots_cache = NULL;
+        dsm_global->indice_cache = NULL;
+        return -1;
+    }
+    
+    dsm_global->memoria_cache = dados;
+    dsm_global->mascara_indice_cache = posicoes - 1;
+    for (int i = 0; i < posicoes; i++) {
+        dsm_global->indice_cache[i] = -1;
+    }
+    
+    // Todos os slots começam na lista de livres
+    for (int i = 0; i < capacidade; i++) {
+        BlocoCache *slot = &dsm_global->slots_cache[i];
+        slot->id_bloco = -1;
+        slot->estado = CACHE_INVALIDO;
+        slot->versao = 0;
+        slot->dados = dados + (size_t)i * dsm_global->tamanho_bloco;
+        slot->proximo_hash = -1;
+        slot->anterior_lru = -1;
+        slot->proximo_lru = i + 1 < capacidade ? i + 1 : -1;
+        pthread_mutex_init(&slot->mutex, NULL);
+        pthread_cond_init(&slot->cond, NULL);
+    }
+    dsm_global->slots_livres = 0;
+    dsm_global->inicio_lru = -1;
+    dsm_global->fim_lru = -1;
+    dsm_global->ponteiro_clock = 0;
+    dsm_global->capacidade_cache = capacidade;
+    return 0;
+}
+
+// =============================================================================
+// COMPRESSÃO DE BLOCOS
+// =============================================================================
+
+// Bloco inteiro em zero (caso comum de blocos nunca escritos)
+static int bloco_zerado(const byte *dados, int tamanho) {
+    return dados[0] == 0 && memcmp(dados, dados + 1, tamanho - 1) == 0;
+}
+
+// Grava os bytes de extensão de um comprimento que não coube nos 4 bits do token
+static int gravar_extensao_lz(byte *saida, int escrito, int valor) {
+    if (valor < 15) return escrito;
+    valor -= 15;
+    while (valor >= 255) {
+        saida[escrito++] = 255;
+        valor -= 255;
+    }
+    saida[escrito++] = (byte)valor;
+    return escrito;
+}
+
+// Grava uma sequência LZ a partir de saida[escrito]: token, literais e, se
+// 'comprimento' > 0, o casamento. Retorna a nova posição ou -1 se a saída
+// alcançaria 'limite'.
+static int gravar_sequencia_lz(byte *saida, int escrito, int limite, const byte *literais, int num_literais,
+                               int deslocamento, int comprimento) {
+    int resto = comprimento > 0 ? comprimento - CASAMENTO_MINIMO_LZ : 0;
+    if (escrito + 1 + num_literais / 255 + 1 + num_literais + 2 + resto / 255 + 1 >= limite) {
+        return -1;
+    }
+    saida[escrito++] = (byte)(((num_literais < 15 ? num_literais : 15) << 4) | (resto < 15 ? resto : 15));
+    escrito = gravar_extensao_lz(saida, escrito, num_literais);
+    memcpy(saida + escrito, literais, num_literais);
+    escrito += num_literais;
+    if (comprimento > 0) {
+        saida[escrito++] = (byte)(deslocamento & 0xff);
+        saida[escrito++] = (byte)(deslocamento >> 8);
+        escrito = gravar_extensao_lz(saida, escrito, resto);
+    }
+    return escrito;
+}
+
+// Comprime 'tamanho' bytes no formato LZ descrito em dsm.h, com uma tabela
+// hash de uma posição por entrada (como o LZ4 rápido). Sequências de bytes
+// repetidos viram casamentos com deslocamento 1. Trechos sem casamentos são
+// percorridos em passos crescentes, para que um bloco incompressível custe
+// pouco. Retorna o tamanho comprimido ou -1 se ele alcançaria 'limite'.
+static int comprimir_lz(const byte *entrada, int tamanho, byte *saida, int limite) {
+    uint32_t posicoes[1 << BITS_HASH_COMPRESSAO];  // Posição + 1 (0 = vazia)
+    memset(posicoes, 0, sizeof(posicoes));
+    
+    int ancora = 0;   // Início dos literais ainda não gravados
+    int posicao = 0;
+    int falhas = 0;
+    int escrito = 0;
+    while (posicao + CASAMENTO_MINIMO_LZ <= tamanho) {
+        uint32_t quatro;
+        memcpy(&quatro, entrada + posicao, sizeof(quatro));
+        uint32_t h = (quatro * 2654435761u) >> (32 - BITS_HASH_COMPRESSAO);
+        int candidato = (int)posicoes[h] - 1;
+        posicoes[h] = (uint32_t)posicao + 1;
+        if (candidato < 0 || posicao - candidato > DISTANCIA_MAX_LZ ||
+            memcmp(entrada + candidato, entrada + posicao, CASAMENTO_MINIMO_LZ) != 0) {
+            posicao += 1 + (falhas++ >> 6);
+            continue;
+        }
+        
+        // Estender o casamento 8 bytes por vez e, no fim, byte a byte
+        int comprimento = CASAMENTO_MINIMO_LZ;
+        while (posicao + comprimento + 8 <= tamanho) {
+            uint64_t a, b;
+            memcpy(&a, entrada + candidato + comprimento, sizeof(a));
+            memcpy(&b, entrada + posicao + comprimento, sizeof(b));
+            if (a != b) break;
+            comprimento += 8;
+        }
+        while (posicao + comprimento < tamanho && entrada[candidato + comprimento] == entrada[posicao + comprimento]) {
+            comprimento++;
+        }
+        escrito = gravar_sequencia_lz(saida, escrito, limite, entrada + ancora, posicao - ancora, posicao - candidato, comprimento);
+        if (escrito < 0) return -1;
+        posicao += comprimento;
+        ancora = posicao;
+        falhas = 0;
+    }
+    return gravar_sequencia_lz(saida, escrito, limite, entrada + ancora, tamanho - ancora, 0, 0);
+}
+
+// =============================================================================
+// COMUNICAÇÃO DE REDE
+// =============================================================================
+
+// Envia todos os buffers do vetor, tratando envios parciais
+static int enviar_iov(int sock, struct iovec *iov, int num_iov) {
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    while (num_iov > 0) {
+        mh.msg_iov = iov;
+        mh.msg_iovlen = num_iov;
+        ssize_t n = sendmsg(sock, &mh, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Avançar sobre o que já foi enviado
+        while (num_iov > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            num_iov--;
+        }
+        if (num_iov > 0) {
+            iov->iov_base = (byte*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Recebe exatamente 'tamanho' bytes; retorna o total lido (menor se o par desconectou) ou -1
+static ssize_t receber_tudo(int sock, void *buf, size_t tamanho) {
+    byte *p = (byte*)buf;
+    size_t total = 0;
+    while (total < tamanho) {
+        ssize_t n = recv(sock, p + total, tamanho - total, MSG_WAITALL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+static void serializar_cabecalho(const Mensagem *msg, byte *cabecalho) {
+    uint16_t tipo = htons((uint16_t)(((msg->flags & 0xff) << 8) | (msg->tipo & 0xff)));
+    uint16_t origem = htons((uint16_t)(dsm_global ? dsm_global->meu_id : 0));
+    uint32_t id_bloco = htonl((uint32_t)msg->id_bloco);
+    uint32_t tamanho = htonl((uint32_t)msg->tamanho_dados);
+    uint32_t sequencia = htonl(msg->sequencia);
+    uint32_t versao[2] = { htonl((uint32_t)(msg->versao >> 32)), htonl((uint32_t)msg->versao) };
+    
+    memcpy(cabecalho + 0, &tipo, 2);
+    memcpy(cabecalho + 2, &origem, 2);
+    memcpy(cabecalho + 4, &id_bloco, 4);
+    memcpy(cabecalho + 8, &tamanho, 4);
+    memcpy(cabecalho + 12, &sequencia, 4);
+    memcpy(cabecalho + 16, versao, 8);
+}
+
+static void desserializar_cabecalho(const byte *cabecalho, Mensagem *msg) {
+    uint16_t tipo, origem;
+    uint32_t id_bloco, tamanho, sequencia, versao[2];
+    
+    memcpy(&tipo, cabecalho + 0, 2);
+    memcpy(&origem, cabecalho + 2, 2);
+    memcpy(&id_bloco, cabecalho + 4, 4);
+    memcpy(&tamanho, cabecalho + 8, 4);
+    memcpy(&sequencia, cabecalho + 12, 4);
+    memcpy(versao, cabecalho + 16, 8);
+    
+    msg->tipo = (TipoMensagem)(ntohs(tipo) & 0xff);
+    msg->flags = ntohs(tipo) >> 8;
+    msg->origem = ntohs(origem);
+    msg->id_bloco = (int32_t)ntohl(id_bloco);
+    msg->tamanho_dados = (int32_t)ntohl(tamanho);
+    msg->sequencia = ntohl(sequencia);
+    msg->versao = ((uint64_t)ntohl(versao[0]) << 32) | ntohl(versao[1]);
+}
+
+// Envia cabeçalho e payload em uma única chamada, sem copiá-los para um buffer intermediário
+int transmitir_mensagem(int socket, const Mensagem *msg) {
+    byte cabecalho[TAMANHO_CABECALHO];
+    serializar_cabecalho(msg, cabecalho);
+    
+    struct iovec iov[2];
+    iov[0].iov_base = cabecalho;
+    iov[0].iov_len = TAMANHO_CABECALHO;
+    iov[1].iov_base = msg->dados;
+    iov[1].iov_len = msg->tamanho_dados > 0 ? (size_t)msg->tamanho_dados : 0;
+    
+    int resultado = enviar_iov(socket, iov, msg->tamanho_dados > 0 ? 2 : 1);
+    if (resultado == 0) {
+        contar_mensagem(msg->tipo, msg->tamanho_dados, 1);
+    }
+    return resultado;
+}
+
+// Abre uma conexão TCP com o processo indicado; retorna o socket ou -1
+static int conectar_processo(int id_processo) {
+    int id = dsm_global->meu_id;
+    InfoProcesso *destino = &dsm_global->processos[id_processo];
+    
+    // Criar socket cliente
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1) {
+        log_erro("    • ", "[P%d] Erro ao criar socket cliente: %s", id, strerror(errno));
+        return -1;
+    }
+    
+    // Mensagens pequenas de requisição/resposta não devem esperar pelo algoritmo de Nagle
+    int opt = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    
+    // Configurar endereço do destino
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(destino->porta);
+    inet_pton(AF_INET, destino->ip, &addr.sin_addr);
+    
+    // Conectar
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        if (errno != ECONNREFUSED) {
+            log_erro("    • ", "[P%d] Erro ao conectar com processo %d (%s:%d): %s", 
+                       id, id_processo, destino->ip, destino->porta, strerror(errno));
+        }
+        close(sock);
+        return -1;
+    }
+    
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Conexão persistente estabelecida com processo %d", id, id_processo);
+    return sock;
+}
+
+// Buffer da thread trabalhadora para o retrato de um bloco local enviado em
+// MSG_RESPOSTA_BLOCO (tamanho_bloco bytes)
+static __thread byte *buffer_resposta_bloco = NULL;
+
+// Buffer da thread trabalhadora para a versão comprimida do retrato
+// (tamanho_bloco bytes; NULL se ConfigDSM::compressao está desligada)
+static __thread byte *buffer_compressao = NULL;
+
+// Garante que a conexão com o destino (cujo mutex já está travado) está
+// aberta; retorna o socket ou -1 se o processo não está disponível
+static int abrir_conexao_travada(int id_processo_destino) {
+    ConexaoPar *conexao = &dsm_global->conexoes[id_processo_destino];
+    if (conexao->socket == -1) {
+        conexao->socket = conectar_processo(id_processo_destino);
+        if (conexao->socket == -1) {
+            log_erro("    • ", "[P%d] Processo %d não está disponível (provavelmente finalizado)", 
+                       dsm_global->meu_id, id_processo_destino);
+        }
+    }
+    return conexao->socket;
+}
+
+// Fecha a conexão (mutex já travado) após uma falha; a próxima mensagem reconecta
+static void descartar_conexao_travada(int id_processo_destino) {
+    ConexaoPar *conexao = &dsm_global->conexoes[id_processo_destino];
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Conexão com processo %d perdida, reconectando", 
+               dsm_global->meu_id, id_processo_destino);
+    close(conexao->socket);
+    conexao->socket = -1;
+    conexao->geracao++;
+}
+
+// Envia uma mensagem pela conexão persistente com o destino e, se 'resposta'
+// não for NULL, aguarda a resposta na mesma conexão. O payload da resposta é
+// recebido diretamente em resposta->dados (NULL se nenhum payload é esperado).
+// Se o par reiniciou, a conexão antiga falha na primeira tentativa e a
+// mensagem é reenviada por uma conexão nova.
+int trocar_mensagens(int id_processo_destino, Mensagem *msg, Mensagem *resposta) {
+    int id = dsm_global->meu_id;
+    if (id_processo_destino < 0 || id_processo_destino >= dsm_global->num_processos) {
+        log_erro("    • ", "[P%d] ID de processo destino inválido: %d", id, id_processo_destino);
+        return -1;
+    }
+    
+    if (id_processo_destino == dsm_global->meu_id) {
+        log_erro("    • ", "[P%d] Tentativa de enviar mensagem para si mesmo", id);
+        return -1;
+    }
+    
+    ConexaoPar *conexao = &dsm_global->conexoes[id_processo_destino];
+    int resultado = -1;
+    
+    pthread_mutex_lock(&conexao->mutex);
+    msg->sequencia = conexao->proxima_sequencia++;
+    for (int tentativa = 0; tentativa < 2 && resultado != 0; tentativa++) {
+        int sock = abrir_conexao_travada(id_processo_destino);
+        if (sock == -1) {
+            break;
+        }
+        
+        if (transmitir_mensagem(sock, msg) == 0 &&
+            (resposta == NULL || (receber_mensagem(sock, resposta) == 0 &&
+                                  resposta->sequencia == msg->sequencia))) {
+            resultado = 0;
+        } else {
+            descartar_conexao_travada(id_processo_destino);
+            // Uma resposta recebida pela metade pode ter caído sobre a cópia
+            // oferecida ao dono: a nova tentativa pede o bloco inteiro
+            if (msg->tipo == MSG_REQUISICAO_BLOCO) msg->versao = 0;
+        }
+    }
+    pthread_mutex_unlock(&conexao->mutex);
+    
+    return resultado;
+}
+
+int enviar_mensagem(int id_processo_destino, Mensagem *msg) {
+    int id = dsm_global->meu_id;
+    
+    // Invalidações e atualizações são confirmadas pelo par; o ACK precisa ser
+    // consumido para não ficar pendente na conexão persistente
+    Mensagem ack;
+    ack.dados = NULL;
+    int espera_ack = (msg->tipo == MSG_INVALIDAR_BLOCO || msg->tipo == MSG_ATUALIZAR_COPIA);
+    
+    if (trocar_mensagens(id_processo_destino, msg, espera_ack ? &ack : NULL) != 0) {
+        return -1;
+    }
+    
+    if (espera_ack && (ack.tipo != MSG_ACK_INVALIDACAO || ack.id_bloco != msg->id_bloco)) {
+        log_erro("    • ", "[P%d] ACK inválido do processo %d para bloco %d", id, id_processo_destino, msg->id_bloco);
+        return -1;
+    }
+    
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Mensagem tipo %d enviada para processo %d (bloco %d)", 
+               id, msg->tipo, id_processo_destino, msg->id_bloco);
+    return 0;
+}
+
+// Payload comprimido lido do socket aos poucos, por um buffer pequeno
+typedef struct {
+    int socket;
+    int restantes;  // Bytes do payload ainda no socket
+    int inicio;
+    int fim;
+    byte buffer[4096];
+} LeitorPayload;
+
+// Copia 'quantidade' bytes do payload para 'destino'; -1 se o payload acabou ou a conexão falhou
+static int ler_payload(LeitorPayload *leitor, byte *destino, int quantidade) {
+    while (quantidade > 0) {
+        if (leitor->inicio == leitor->fim) {
+            int parte = leitor->restantes < (int)sizeof(leitor->buffer) ? leitor->restantes : (int)sizeof(leitor->buffer);
+            if (parte == 0 || receber_tudo(leitor->socket, leitor->buffer, parte) != parte) return -1;
+            leitor->restantes -= parte;
+            leitor->inicio = 0;
+            leitor->fim = parte;
+        }
+        int n = leitor->fim - leitor->inicio < quantidade ? leitor->fim - leitor->inicio : quantidade;
+        memcpy(destino, leitor->buffer + leitor->inicio, n);
+        leitor->inicio += n;
+        destino += n;
+        quantidade -= n;
+    }
+    return 0;
+}
+
+// Lê um comprimento LZ: o valor do token ou, se ele é 15, a soma com os
+// bytes de extensão. Retorna -1 se o valor passa de 'maximo'.
+static int ler_comprimento_lz(LeitorPayload *leitor, int valor, int maximo) {
+    if (valor < 15) return valor;
+    byte extensao;
+    do {
+        if (ler_payload(leitor, &extensao, 1) != 0) return -1;
+        valor += extensao;
+        if (valor > maximo) return -1;
+    } while (extensao == 255);
+    return valor;
+}
+
+// Recebe a resposta comprimida de um bloco inteiro descomprimindo-a direto
+// em msg->dados (FLAG_BLOCO_ZERADO ou FLAG_COMPRESSAO_LZ), sem buffer
+// intermediário do tamanho do bloco. Qualquer inconsistência retorna -1:
+// a conexão perde o alinhamento e a cópia pode ter ficado pela metade.
+static int receber_bloco_comprimido(int socket_cliente, const Mensagem *msg) {
+    int tamanho = dsm_global->tamanho_bloco;
+    if (msg->flags & FLAG_BLOCO_ZERADO) {
+        if (msg->tamanho_dados != 0) return -1;
+        memset(msg->dados, 0, tamanho);
+        return 0;
+    }
+    if (msg->tamanho_dados <= 0 || msg->tamanho_dados >= tamanho) return -1;
+    
+    LeitorPayload leitor;
+    leitor.socket = socket_cliente;
+    leitor.restantes = msg->tamanho_dados;
+    leitor.inicio = 0;
+    leitor.fim = 0;
+    
+    int escrito = 0;
+    for (;;) {
+        byte token;
+        if (ler_payload(&leitor, &token, 1) != 0) return -1;
+        int num_literais = ler_comprimento_lz(&leitor, token >> 4, tamanho - escrito);
+        if (num_literais < 0 || num_literais > tamanho - escrito ||
+            ler_payload(&leitor, msg->dados + escrito, num_literais) != 0) {
+            return -1;
+        }
+        escrito += num_literais;
+        
+        // A última sequência só tem literais
+        if (leitor.inicio == leitor.fim && leitor.restantes == 0) break;
+        
+        byte deslocamento_lido[2];
+        if (ler_payload(&leitor, deslocamento_lido, 2) != 0) return -1;
+        int deslocamento = deslocamento_lido[0] | (deslocamento_lido[1] << 8);
+        int comprimento = ler_comprimento_lz(&leitor, token & 15, tamanho - escrito);
+        if (comprimento < 0) return -1;
+        comprimento += CASAMENTO_MINIMO_LZ;
+        if (deslocamento == 0 || deslocamento > escrito || comprimento > tamanho - escrito) return -1;
+        
+        // Com deslocamento menor que o comprimento o casamento se sobrepõe
+        // ao que ele mesmo escreve: o trecho é periódico, então cada cópia
+        // pode repetir tudo o que já foi copiado, dobrando de tamanho
+        byte *destino = msg->dados + escrito;
+        const byte *origem = destino - deslocamento;
+        for (int copiado = 0; copiado < comprimento; ) {
+            int n = deslocamento + copiado < comprimento - copiado ? deslocamento + copiado : comprimento - copiado;
+            memcpy(destino + copiado, origem, n);
+            copiado += n;
+        }
+        escrito += comprimento;
+    }
+    return escrito == tamanho ? 0 : -1;
+}
+
+// Recebe o payload de um MSG_RESPOSTA_DELTA escrevendo cada trecho direto na
+// sua posição da cópia em msg->dados. Qualquer inconsistência retorna -1: a
+// conexão perde o alinhamento e a cópia pode ter ficado pela metade.
+static int receber_trechos_delta(int socket_cliente, const Mensagem *msg) {
+    uint32_t tabela[1 + 2 * PROFUNDIDADE_DELTAS];
+    if (msg->tamanho_dados < (int)sizeof(uint32_t) ||
+        receber_tudo(socket_cliente, tabela, sizeof(uint32_t)) != (ssize_t)sizeof(uint32_t)) {
+        return -1;
+    }
+    uint32_t num_trechos = ntohl(tabela[0]);
+    if (num_trechos == 0 || num_trechos > PROFUNDIDADE_DELTAS) {
+        return -1;
+    }
+    size_t tamanho_tabela = 2 * num_trechos * sizeof(uint32_t);
+    if (receber_tudo(socket_cliente, &tabela[1], tamanho_tabela) != (ssize_t)tamanho_tabela) {
+        return -1;
+    }
+    
+    uint32_t tamanho_bloco = (uint32_t)dsm_global->tamanho_bloco;
+    uint64_t esperado = sizeof(uint32_t) + tamanho_tabela;
+    for (uint32_t i = 0; i < num_trechos; i++) {
+        uint32_t inicio = ntohl(tabela[1 + 2 * i]);
+        uint32_t bytes = ntohl(tabela[2 + 2 * i]);
+        if (bytes == 0 || inicio >= tamanho_bloco || bytes > tamanho_bloco - inicio) {
+            return -1;
+        }
+        esperado += bytes;
+    }
+    if (esperado != (uint64_t)msg->tamanho_dados) {
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < num_trechos; i++) {
+        uint32_t inicio = ntohl(tabela[1 + 2 * i]);
+        uint32_t bytes = ntohl(tabela[2 + 2 * i]);
+        if (receber_tudo(socket_cliente, msg->dados + inicio, bytes) != (ssize_t)bytes) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Recebe cabeçalho e payload. O payload é gravado em msg->dados, que deve ter
+// capacidade para um bloco, SistemaDSM::tamanho_bloco bytes (ou ser NULL se nenhum é esperado).
+int receber_mensagem(int socket_cliente, Mensagem *msg) {
+    int id = (dsm_global != NULL) ? dsm_global->meu_id : -1;
+    byte cabecalho[TAMANHO_CABECALHO];
+    ssize_t bytes_recebidos = receber_tudo(socket_cliente, cabecalho, TAMANHO_CABECALHO);
+    if (bytes_recebidos != TAMANHO_CABECALHO) {
+        if (bytes_recebidos == 0) {
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Cliente desconectou", id);
+        } else {
+            log_erro("    • ", "[P%d] Erro ao receber mensagem: %s", id, strerror(errno));
+        }
+        return -1;
+    }
+    
+    desserializar_cabecalho(cabecalho, msg);
+    
+    int capacidade = (msg->dados && dsm_global) ? dsm_global->tamanho_bloco : 0;
+    if (msg->tamanho_dados < 0 || msg->tamanho_dados > capacidade) {
+        log_erro("    • ", "[P%d] Payload de %d bytes inesperado (tipo %d)", id, msg->tamanho_dados, msg->tipo);
+        return -1;
+    }
+    
+    int tamanho_rede = msg->tamanho_dados;
+    if (msg->tipo == MSG_RESPOSTA_DELTA && msg->dados) {
+        // Os trechos vão direto para as suas posições na cópia de quem pediu
+        if (receber_trechos_delta(socket_cliente, msg) != 0) {
+            log_erro("    • ", "[P%d] Resposta delta inválida para o bloco %d", id, msg->id_bloco);
+            return -1;
+        }
+    } else if ((msg->flags & (FLAG_BLOCO_ZERADO | FLAG_COMPRESSAO_LZ)) && msg->dados) {
+        // Quem recebe vê o bloco inteiro, como em um MSG_RESPOSTA_BLOCO comum
+        if (receber_bloco_comprimido(socket_cliente, msg) != 0) {
+            log_erro("    • ", "[P%d] Resposta comprimida inválida para o bloco %d", id, msg->id_bloco);
+            return -1;
+        }
+        msg->tamanho_dados = dsm_global->tamanho_bloco;
+        msg->flags &= ~(FLAG_BLOCO_ZERADO | FLAG_COMPRESSAO_LZ);
+    } else if (msg->tamanho_dados > 0 &&
+        receber_tudo(socket_cliente, msg->dados, msg->tamanho_dados) != msg->tamanho_dados) {
+        log_erro("    • ", "[P%d] Erro ao receber payload da mensagem: %s", id, strerror(errno));
+        return -1;
+    }
+    contar_mensagem(msg->tipo, tamanho_rede, 0);
+    return 0;
+}
+
+// =============================================================================
+// OPERAÇÕES COM BLOCOS REMOTOS
+// =============================================================================
+
+// Segue um MSG_REDIRECIONAR recebido na resposta a uma requisição sobre o
+// bloco: registra o dono indicado e, a partir do segundo salto, espera um
+// pouco, porque durante uma migração o dono antigo e o novo apontam um para
+// o outro até o novo instalar o bloco.
+static void seguir_redirecionamento(int id_bloco, const Mensagem *resposta, int salto) {
+    uint32_t dono_rede;
+    memcpy(&dono_rede, resposta->dados, sizeof(uint32_t));
+    int dono = (int32_t)ntohl(dono_rede);
+    
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d não está mais no processo %d; dono indicado: processo %d",
+              dsm_global->meu_id, id_bloco, resposta->origem, dono);
+    contar(REDIRECIONAMENTOS);
+    atualizar_dono_conhecido(id_bloco, dono);
+    if (salto > 0) {
+        usleep(ESPERA_REDIRECIONAMENTO_US * salto);
+    }
+}
+
+// Resposta é um redirecionamento válido para o bloco
+static int e_redirecionamento(const Mensagem *resposta, int id_bloco) {
+    return resposta->tipo == MSG_REDIRECIONAR && resposta->id_bloco == id_bloco &&
+           resposta->tamanho_dados == (int)sizeof(uint32_t);
+}
+
+// Resposta trouxe os trechos que faltavam à cópia de 'id_bloco' na versão
+// oferecida; eles já foram aplicados sobre a cópia por receber_mensagem
+static int e_resposta_delta(const Mensagem *resposta, int id_bloco, uint64_t versao) {
+    return resposta->tipo == MSG_RESPOSTA_DELTA && resposta->id_bloco == id_bloco &&
+           versao != 0 && resposta->versao != 0;
+}
+
+// Resposta confirma que a cópia de 'id_bloco' na versão pedida continua atual
+static int e_nao_modificado(const Mensagem *resposta, int id_bloco, uint64_t versao) {
+    return resposta->tipo == MSG_NAO_MODIFICADO && resposta->id_bloco == id_bloco &&
+           resposta->tamanho_dados == 0 && versao != 0 && resposta->versao == versao;
+}
+
+// Busca um bloco remoto em 'dados_recebidos'. Se 'versao' aponta para uma
+// versão diferente de 0, 'dados_recebidos' já guarda o bloco nessa versão e o
+// dono só o reenvia se ele mudou; na volta, 'versao' tem a versão recebida
+// (0 se desconhecida)
+int requisitar_bloco_remoto(int id_bloco, byte *dados_recebidos, uint64_t *versao) {
+    int id = dsm_global->meu_id;
+    
+    for (int salto = 0; salto < MAX_REDIRECIONAMENTOS; salto++) {
+        int dono = calcular_dono_bloco(id_bloco);
+        if (dono == dsm_global->meu_id) {
+            // O bloco migrou para este processo durante a leitura
+            if (copiar_bloco_local(id_bloco, dados_recebidos) == 0) {
+                if (versao) *versao = 0;
+                return 0;
+            }
+            continue;
+        }
+        
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Requisitando bloco %d do processo %d", id, id_bloco, dono);
+        
+        // Preparar requisição e aguardar a resposta na conexão persistente
+        Mensagem msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.tipo = MSG_REQUISICAO_BLOCO;
+        msg.flags = dsm_global->config.compressao ? FLAG_ACEITA_COMPRESSAO : 0;
+        msg.id_bloco = id_bloco;
+        msg.versao = versao ? *versao : 0;
+        
+        // O payload da resposta é recebido direto no buffer de destino
+        Mensagem resposta;
+        resposta.dados = dados_recebidos;
+        if (trocar_mensagens(dono, &msg, &resposta) != 0) {
+            log_erro("    • ", "[P%d] Erro na requisição do bloco %d ao processo %d", id, id_bloco, dono);
+            return -1;
+        }
+        
+        if (e_redirecionamento(&resposta, id_bloco)) {
+            // O payload do redirecionamento caiu sobre a cópia oferecida
+            if (versao) *versao = 0;
+            seguir_redirecionamento(id_bloco, &resposta, salto);
+            continue;
+        }
+        
+        if (e_nao_modificado(&resposta, id_bloco, msg.versao)) {
+            log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d revalidado no processo %d", id, id_bloco, dono);
+            contar(REVALIDACOES);
+            return 0;
+        }
+        
+        if (e_resposta_delta(&resposta, id_bloco, msg.versao)) {
+            log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d atualizado com %d bytes de trechos do processo %d",
+                      id, id_bloco, resposta.tamanho_dados, dono);
+            contar(RESPOSTAS_DELTA);
+            *versao = resposta.versao;
+            return 0;
+        }
+        
+        // Verificar se a resposta é válida
+        if (resposta.tipo != MSG_RESPOSTA_BLOCO || resposta.id_bloco != id_bloco ||
+            resposta.tamanho_dados != dsm_global->tamanho_bloco) {
+            log_erro("    • ", "[P%d] Resposta inválida para bloco %d", id, id_bloco);
+            return -1;
+        }
+        
+        if (versao) *versao = resposta.versao;
+        log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d recebido com sucesso do processo %d", id, id_bloco, dono);
+        return 0;
+    }
+    
+    log_erro("    • ", "[P%d] Bloco %d não encontrado após %d redirecionamentos", id, id_bloco, MAX_REDIRECIONAMENTOS);
+    return -1;
+}
+
+// Busca vários blocos remotos de uma vez. Cada dono recebe uma única
+// MSG_REQUISICAO_MULTIPLA com a lista dos seus blocos (dividida apenas se
+// não couber em um payload de bloco) e devolve todos em sequência na mesma
+// conexão. Todas as requisições são enviadas antes de qualquer resposta ser
+// lida, então donos diferentes atendem em paralelo. Cada bloco é recebido
+// direto em destinos[i] e resultados[i] fica 0 em caso de sucesso. Se
+// 'versoes' não é NULL, versoes[i] funciona como em requisitar_bloco_remoto.
+// Retorna o número de blocos que não puderam ser obtidos.
+int requisitar_blocos_remotos(const int *ids_blocos, byte **destinos, uint64_t *versoes, int *resultados, int quantidade) {
+    int id = dsm_global->meu_id;
+    int num_processos = dsm_global->num_processos;
+    
+    // Índices dos blocos agrupados por dono, na ordem em que serão pedidos
+    int *ordem = (int*)malloc(quantidade * sizeof(int));
+    uint32_t *pares_rede = (uint32_t*)malloc((size_t)quantidade * TAMANHO_PAR_REQUISICAO);
+    uint32_t *sequencias = (uint32_t*)malloc(quantidade * sizeof(uint32_t));
+    int *sockets = (int*)malloc(quantidade * sizeof(int));
+    uint32_t *geracoes = (uint32_t*)malloc(quantidade * sizeof(uint32_t));
+    if (!ordem || !pares_rede || !sequencias || !sockets || !geracoes) {
+        free(ordem);
+        free(pares_rede);
+        free(sequencias);
+        free(sockets);
+        free(geracoes);
+        return quantidade;
+    }
+    
+    // Cada bloco pedido ocupa um par (ID, versão) no payload
+    int max_ids = dsm_global->tamanho_bloco / TAMANHO_PAR_REQUISICAO;
+    int inicio_dono[MAX_PROCESSOS + 1];
+    int total = 0;
+    for (int p = 0; p < num_processos; p++) {
+        inicio_dono[p] = total;
+        if (p == dsm_global->meu_id) continue;
+        for (int i = 0; i < quantidade; i++) {
+            if (calcular_dono_bloco(ids_blocos[i]) == p) {
+                uint64_t versao = versoes ? versoes[i] : 0;
+                ordem[total] = i;
+                pares_rede[3 * total] = htonl((uint32_t)ids_blocos[i]);
+                pares_rede[3 * total + 1] = htonl((uint32_t)(versao >> 32));
+                pares_rede[3 * total + 2] = htonl((uint32_t)versao);
+                total++;
+            }
+        }
+    }
+    inicio_dono[num_processos] = total;
+    for (int i = 0; i < quantidade; i++) {
+        resultados[i] = -1;
+    }
+    
+    // Travar as conexões envolvidas em ordem crescente de processo, evitando
+    // deadlock entre leituras concorrentes que envolvem os mesmos donos
+    for (int p = 0; p < num_processos; p++) {
+        if (inicio_dono[p + 1] > inicio_dono[p]) pthread_mutex_lock(&dsm_global->conexoes[p].mutex);
+    }
+    
+    // Enviar as requisições de todos os donos
+    for (int p = 0; p < num_processos; p++) {
+        for (int k = inicio_dono[p]; k < inicio_dono[p + 1]; k += max_ids) {
+            int n = inicio_dono[p + 1] - k < max_ids ? inicio_dono[p + 1] - k : max_ids;
+            int sock = abrir_conexao_travada(p);
+            
+            Mensagem msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.tipo = MSG_REQUISICAO_MULTIPLA;
+            msg.flags = dsm_global->config.compressao ? FLAG_ACEITA_COMPRESSAO : 0;
+            msg.id_bloco = ids_blocos[ordem[k]];
+            msg.tamanho_dados = n * TAMANHO_PAR_REQUISICAO;
+            msg.dados = (byte*)&pares_rede[3 * k];
+            msg.sequencia = dsm_global->conexoes[p].proxima_sequencia++;
+            
+            if (sock != -1) {
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Requisitando %d blocos do processo %d", id, n, p);
+                if (transmitir_mensagem(sock, &msg) != 0) {
+                    descartar_conexao_travada(p);
+                    sock = -1;
+                }
+            }
+            for (int j = k; j < k + n; j++) {
+                sockets[j] = sock;
+                sequencias[j] = msg.sequencia;
+                geracoes[j] = dsm_global->conexoes[p].geracao;
+            }
+        }
+    }
+    
+    // Receber os blocos, que chegam na ordem pedida em cada conexão
+    for (int p = 0; p < num_processos; p++) {
+        for (int k = inicio_dono[p]; k < inicio_dono[p + 1]; k++) {
+            int i = ordem[k];
+            // Pular blocos não enviados ou cuja conexão caiu durante a rodada,
+            // mesmo que a conexão nova tenha recebido o mesmo descritor
+            if (sockets[k] == -1 || dsm_global->conexoes[p].geracao != geracoes[k]) continue;
+            
+            Mensagem resposta;
+            resposta.dados = destinos[i];
+            if (receber_mensagem(sockets[k], &resposta) != 0 || resposta.sequencia != sequencias[k] ||
+                resposta.id_bloco != ids_blocos[i]) {
+                // O destino pode ter ficado pela metade: não vale mais como cópia
+                if (versoes) versoes[i] = 0;
+                descartar_conexao_travada(p);
+                continue;
+            }
+            
+            if (e_redirecionamento(&resposta, ids_blocos[i])) {
+                // O bloco migrou: buscado de novo individualmente abaixo, sem
+                // a cópia oferecida, sobre a qual caiu o payload
+                if (versoes) versoes[i] = 0;
+                seguir_redirecionamento(ids_blocos[i], &resposta, 0);
+                continue;
+            }
+            
+            if (e_nao_modificado(&resposta, ids_blocos[i], versoes ? versoes[i] : 0)) {
+                contar(REVALIDACOES);
+                resultados[i] = 0;
+                continue;
+            }
+            
+            if (e_resposta_delta(&resposta, ids_blocos[i], versoes ? versoes[i] : 0)) {
+                contar(RESPOSTAS_DELTA);
+                versoes[i] = resposta.versao;
+                resultados[i] = 0;
+                continue;
+            }
+            
+            if (resposta.tipo != MSG_RESPOSTA_BLOCO || resposta.tamanho_dados != dsm_global->tamanho_bloco) {
+                log_erro("    • ", "[P%d] Resposta inválida para bloco %d", id, ids_blocos[i]);
+                if (versoes) versoes[i] = 0;
+                continue;
+            }
+            
+            if (versoes) versoes[i] = resposta.versao;
+            resultados[i] = 0;
+            log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d recebido com sucesso do processo %d", id, ids_blocos[i], p);
+        }
+    }
+    
+    for (int p = num_processos - 1; p >= 0; p--) {
+        if (inicio_dono[p + 1] > inicio_dono[p]) pthread_mutex_unlock(&dsm_global->conexoes[p].mutex);
+    }
+    
+    // Blocos que falharam na rodada são buscados de novo individualmente, o
+    // que inclui reconectar a um par que tenha reiniciado e seguir blocos
+    // que migraram (inclusive para este processo)
+    int falhas = 0;
+    for (int i = 0; i < quantidade; i++) {
+        if (resultados[i] != 0) {
+            resultados[i] = requisitar_bloco_remoto(ids_blocos[i], destinos[i], versoes ? &versoes[i] : NULL);
+        }
+        if (resultados[i] != 0) {
+            falhas++;
+        }
+    }
+    
+    free(ordem);
+    free(pares_rede);
+    free(sequencias);
+    free(sockets);
+    free(geracoes);
+    return falhas;
+}
+
+// Milissegundos até o instante 'limite' (CLOCK_MONOTONIC), no mínimo 0
+static int milissegundos_ate(const struct timespec *limite) {
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    long ms = (limite->tv_sec - agora.tv_sec) * 1000 + (limite->tv_nsec - agora.tv_nsec) / 1000000;
+    return ms > 0 ? (int)ms : 0;
+}
+
+// Próximo índice i >= inicio cujo bloco deve ser invalidado em 'processo'
+static int proximo_bloco_do_processo(const uint64_t *copias, int quantidade, int inicio, int processo) {
+    while (inicio < quantidade && !(copias[inicio] & ((uint64_t)1 << processo))) {
+        inicio++;
+    }
+    return inicio;
+}
+
+// Prepara a mensagem que leva ao processo com cópia a escrita i: a
+// atualização da cópia, se atualizacoes[i].dados está preenchido, ou a
+// invalidação do bloco
+static void preparar_propagacao(Mensagem *msg, const int *ids_blocos, const AtualizacaoCopia *atualizacoes, int i) {
+    memset(msg, 0, sizeof(*msg));
+    if (atualizacoes && atualizacoes[i].dados) {
+        msg->tipo = MSG_ATUALIZAR_COPIA;
+        msg->id_bloco = ids_blocos[i] * dsm_global->tamanho_bloco + atualizacoes[i].offset;
+        msg->versao = atualizacoes[i].versao;
+        msg->tamanho_dados = atualizacoes[i].bytes;
+        msg->dados = (byte*)atualizacoes[i].dados;
+    } else {
+        msg->tipo = MSG_INVALIDAR_BLOCO;
+        msg->id_bloco = ids_blocos[i];
+    }
+}
+
+// Reenvia ao processo p, por uma conexão nova, uma mensagem da rodada de
+// invalidação e espera o ACK até 'limite'. Retorna 0 se ela foi confirmada.
+static int reenviar_propagacao(int p, Mensagem *msg, const struct timespec *limite) {
+    ConexaoPar *conexao = &dsm_global->conexoes[p];
+    int resultado = -1;
+    
+    pthread_mutex_lock(&conexao->mutex);
+    int sock = abrir_conexao_travada(p);
+    if (sock != -1) {
+        msg->sequencia = conexao->proxima_sequencia++;
+        int prontos = -1;
+        if (transmitir_mensagem(sock, msg) == 0) {
+            struct pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            do {
+                pfd.revents = 0;
+                prontos = poll(&pfd, 1, milissegundos_ate(limite));
+            } while (prontos < 0 && errno == EINTR);
+        }
+        
+        Mensagem ack;
+        ack.dados = NULL;
+        if (prontos > 0 && receber_mensagem(sock, &ack) == 0 && ack.tipo == MSG_ACK_INVALIDACAO &&
+            ack.sequencia == msg->sequencia && ack.id_bloco == msg->id_bloco) {
+            resultado = 0;
+        } else {
+            // Sem o ACK a tempo, a conexão ficaria dessincronizada
+            descartar_conexao_travada(p);
+        }
+    }
+    pthread_mutex_unlock(&conexao->mutex);
+    return resultado;
+}
+
+// Invalida cada bloco ids_blocos[i] nos processos do bitmap copias[i], ou
+// atualiza as cópias com a escrita atualizacoes[i] se ela traz os dados
+// (atualizacoes pode ser NULL), todos de uma vez. As mensagens são enviadas
+// a todos os pares antes de qualquer ACK ser lido e os ACKs são recolhidos
+// com poll() até ConfigDSM::timeout_ack_ms, então a escrita espera cerca de
+// uma ida e volta, independente do número de processos. Um par cuja conexão
+// falhou no meio da rodada recebe as mensagens pendentes de novo, uma a uma,
+// por uma conexão nova, dentro do mesmo prazo. Ao retornar, copias[i] tem
+// só os processos que podem ter ficado com a cópia antiga: os que não
+// confirmaram a mensagem i, exceto os que já estavam inalcançáveis (um
+// processo reiniciado não tem cache). Retorna o número de processos que
+// confirmaram todas as suas mensagens.
+int invalidar_blocos_remotos(const int *ids_blocos, uint64_t *copias, const AtualizacaoCopia *atualizacoes, int quantidade) {
+    int id = dsm_global->meu_id;
+    int num_processos = dsm_global->num_processos;
+    
+    // Processos envolvidos na rodada
+    uint64_t envolvidos = 0;
+    for (int i = 0; i < quantidade; i++) {
+        envolvidos |= copias[i];
+    }
+    envolvidos &= ~((uint64_t)1 << id);
+    
+    if (quantidade == 1) {
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Invalidando caches remotos para bloco %d", id, ids_blocos[0]);
+    } else {
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Invalidando caches remotos para %d blocos", id, quantidade);
+    }
+    
+    if (envolvidos == 0) {
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Nenhum processo tem cópia; invalidação desnecessária", id);
+        memset(copias, 0, quantidade * sizeof(uint64_t));
+        return 0;
+    }
+    
+    int sockets[MAX_PROCESSOS];              // -1 se o par não está (mais) na rodada
+    int conectado[MAX_PROCESSOS];            // Conexão aberta no início da rodada
+    int proximo[MAX_PROCESSOS];              // Índice do próximo bloco cujo ACK é esperado
+    uint32_t sequencia_esperada[MAX_PROCESSOS];
+    
+    // Travar as conexões em ordem crescente de processo, como em requisitar_blocos_remotos
+    for (int p = 0; p < num_processos; p++) {
+        if (envolvidos & ((uint64_t)1 << p)) pthread_mutex_lock(&dsm_global->conexoes[p].mutex);
+    }
+    
+    // Enviar todas as invalidações para todos os pares envolvidos
+    for (int p = 0; p < num_processos; p++) {
+        sockets[p] = -1;
+        conectado[p] = 0;
+        proximo[p] = quantidade;
+        if (!(envolvidos & ((uint64_t)1 << p))) continue;
+        
+        proximo[p] = proximo_bloco_do_processo(copias, quantidade, 0, p);
+        int sock = abrir_conexao_travada(p);
+        if (sock == -1) continue;
+        conectado[p] = 1;
+        sequencia_esperada[p] = dsm_global->conexoes[p].proxima_sequencia;
+        
+        for (int i = proximo[p]; i < quantidade; i = proximo_bloco_do_processo(copias, quantidade, i + 1, p)) {
+            Mensagem msg;
+            preparar_propagacao(&msg, ids_blocos, atualizacoes, i);
+            msg.sequencia = dsm_global->conexoes[p].proxima_sequencia++;
+            if (transmitir_mensagem(sock, &msg) != 0) {
+                descartar_conexao_travada(p);
+                sock = -1;
+                break;
+            }
+        }
+        sockets[p] = sock;
+    }
+    
+    // Recolher os ACKs de todos os pares até o prazo
+    struct timespec limite;
+    clock_gettime(CLOCK_MONOTONIC, &limite);
+    limite.tv_sec += dsm_global->config.timeout_ack_ms / 1000;
+    limite.tv_nsec += (long)(dsm_global->config.timeout_ack_ms % 1000) * 1000000;
+    if (limite.tv_nsec >= 1000000000) {
+        limite.tv_sec++;
+        limite.tv_nsec -= 1000000000;
+    }
+    
+    for (;;) {
+        struct pollfd fds[MAX_PROCESSOS];
+        int processos_fds[MAX_PROCESSOS];
+        int nfds = 0;
+        for (int p = 0; p < num_processos; p++) {
+            if (sockets[p] != -1 && proximo[p] < quantidade) {
+                fds[nfds].fd = sockets[p];
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                processos_fds[nfds] = p;
+                nfds++;
+            }
+        }
+        if (nfds == 0) break;
+        
+        int prontos = poll(fds, nfds, milissegundos_ate(&limite));
+        if (prontos < 0 && errno == EINTR) continue;
+        if (prontos <= 0) break;
+        
+        for (int f = 0; f < nfds; f++) {
+            if (fds[f].revents == 0) continue;
+            int p = processos_fds[f];
+            
+            Mensagem esperada;
+            preparar_propagacao(&esperada, ids_blocos, atualizacoes, proximo[p]);
+            Mensagem ack;
+            ack.dados = NULL;
+            if (receber_mensagem(sockets[p], &ack) != 0 || ack.tipo != MSG_ACK_INVALIDACAO ||
+                ack.sequencia != sequencia_esperada[p] || ack.id_bloco != esperada.id_bloco) {
+                log_erro("    • ", "[P%d] ACK inválido do processo %d", id, p);
+                descartar_conexao_travada(p);
+                sockets[p] = -1;
+                continue;
+            }
+            sequencia_esperada[p]++;
+            proximo[p] = proximo_bloco_do_processo(copias, quantidade, proximo[p] + 1, p);
+            contar(esperada.tipo == MSG_ATUALIZAR_COPIA ? ATUALIZACOES_ENVIADAS : INVALIDACOES_ENVIADAS);
+        }
+    }
+    
+    // Um ACK atrasado dessincronizaria a conexão: descartá-la
+    for (int p = 0; p < num_processos; p++) {
+        if (sockets[p] != -1 && proximo[p] < quantidade) {
+            log_erro("    • ", "[P%d] Tempo esgotado esperando ACK do processo %d", id, p);
+            descartar_conexao_travada(p);
+        }
+    }
+    
+    for (int p = num_processos - 1; p >= 0; p--) {
+        if (envolvidos & ((uint64_t)1 << p)) pthread_mutex_unlock(&dsm_global->conexoes[p].mutex);
+    }
+    
+    int sucesso = 0;
+    int tentativas = 0;
+    for (int p = 0; p < num_processos; p++) {
+        if (!(envolvidos & ((uint64_t)1 << p))) continue;
+        tentativas++;
+        
+        // Pares que estavam conectados mas falharam na rodada podem ter
+        // reiniciado: reenviar o que falta individualmente, até o prazo
+        if (conectado[p]) {
+            while (proximo[p] < quantidade && milissegundos_ate(&limite) > 0) {
+                Mensagem msg;
+                preparar_propagacao(&msg, ids_blocos, atualizacoes, proximo[p]);
+                if (reenviar_propagacao(p, &msg, &limite) != 0) break;
+                contar(msg.tipo == MSG_ATUALIZAR_COPIA ? ATUALIZACOES_ENVIADAS : INVALIDACOES_ENVIADAS);
+                proximo[p] = proximo_bloco_do_processo(copias, quantidade, proximo[p] + 1, p);
+            }
+        }
+        
+        if (proximo[p] == quantidade) {
+            sucesso++;
+        }
+    }
+    
+    // Sobram nos bitmaps as mensagens sem confirmação dos pares alcançados
+    for (int i = 0; i < quantidade; i++) {
+        uint64_t pendentes = 0;
+        for (int p = 0; p < num_processos; p++) {
+            if ((copias[i] & ((uint64_t)1 << p)) && conectado[p] && i >= proximo[p]) {
+                pendentes |= (uint64_t)1 << p;
+            }
+        }
+        copias[i] = pendentes;
+    }
+    
+    if (sucesso > 0) {
+        log_debug(COLOR_SUCCESS, "    • ", "[P%d] Invalidações enviadas para %d de %d processos com cópia", id, sucesso, tentativas);
+    } else {
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Nenhum processo disponível para invalidação (todos podem ter finalizado)", id);
+    }
+    return sucesso;
+}
+
+// Invalida as cópias de um bloco local registradas no diretório
+int invalidar_caches_remotos(int id_bloco) {
+    int idx_local = travar_bloco_local(id_bloco);
+    if (idx_local < 0) return -1;
+    
+    uint64_t assumidas = assumir_invalidacao(idx_local, retirar_compartilhadores(idx_local));
+    destravar_bloco_local(id_bloco);
+    uint64_t copias = assumidas;
+    int confirmados = invalidar_blocos_remotos(&id_bloco, &copias, NULL, 1);
+    concluir_invalidacao(id_bloco, assumidas, copias);
+    return confirmados;
+}
+
+// =============================================================================
+// PREFETCH
+// =============================================================================
+
+// Coloca um bloco na fila da thread de prefetch (mutex_prefetch travado).
+// Com a fila cheia o pedido é descartado: prefetch é apenas uma otimização.
+static void enfileirar_prefetch(int id_bloco) {
+    if (dsm_global->tamanho_fila_prefetch == TAMANHO_FILA_PREFETCH) return;
+    int fim = (dsm_global->inicio_fila_prefetch + dsm_global->tamanho_fila_prefetch) % TAMANHO_FILA_PREFETCH;
+    dsm_global->fila_prefetch[fim] = id_bloco;
+    dsm_global->tamanho_fila_prefetch++;
+}
+
+// Alimenta o detector com um acesso que precisou da rede: um miss ou o
+// primeiro uso de um bloco trazido pelo prefetch (assim um fluxo já coberto
+// continua avançando). Quando o mesmo passo se repete CONFIRMACOES_PREFETCH
+// vezes, os próximos 'profundidade_prefetch' blocos do padrão são pedidos
+// à thread de prefetch.
+static void registrar_acesso_prefetch(int id_bloco) {
+    int profundidade = dsm_global->config.profundidade_prefetch;
+    if (profundidade <= 0) return;
+    
+    pthread_mutex_lock(&dsm_global->mutex_prefetch);
+    dsm_global->relogio_prefetch++;
+    
+    FluxoPrefetch *fluxo = NULL;
+    
+    // 1. Fluxo cujo passo previa este bloco (ou acesso repetido ao último bloco)
+    for (int i = 0; i < NUM_FLUXOS_PREFETCH && !fluxo; i++) {
+        FluxoPrefetch *f = &dsm_global->fluxos_prefetch[i];
+        if (f->ultimo_bloco < 0) continue;
+        if (f->ultimo_bloco == id_bloco) {
+            f->uso = dsm_global->relogio_prefetch;
+            pthread_mutex_unlock(&dsm_global->mutex_prefetch);
+            return;
+        }
+        if (f->passo != 0 && f->ultimo_bloco + f->passo == id_bloco) {
+            fluxo = f;
+            fluxo->confirmacoes++;
+        }
+    }
+    
+    // 2. Fluxo próximo ainda sem padrão confirmado: adota o novo passo
+    for (int i = 0; i < NUM_FLUXOS_PREFETCH && !fluxo; i++) {
+        FluxoPrefetch *f = &dsm_global->fluxos_prefetch[i];
+        int passo = id_bloco - f->ultimo_bloco;
+        if (f->ultimo_bloco >= 0 && f->confirmacoes <= 1 && abs(passo) <= DISTANCIA_MAX_PASSO) {
+            fluxo = f;
+            fluxo->passo = passo;
+            fluxo->confirmacoes = 1;
+            fluxo->proximo_prefetch = id_bloco + passo;
+        }
+    }
+    
+    // 3. Novo fluxo no lugar do menos usado recentemente
+    if (!fluxo) {
+        fluxo = &dsm_global->fluxos_prefetch[0];
+        for (int i = 1; i < NUM_FLUXOS_PREFETCH; i++) {
+            if (dsm_global->fluxos_prefetch[i].uso < fluxo->uso) {
+                fluxo = &dsm_global->fluxos_prefetch[i];
+            }
+        }
+        fluxo->passo = 0;
+        fluxo->confirmacoes = 0;
+    }
+    
+    fluxo->ultimo_bloco = id_bloco;
+    fluxo->uso = dsm_global->relogio_prefetch;
+    
+    if (fluxo->confirmacoes >= CONFIRMACOES_PREFETCH) {
+        // Pedir os blocos do padrão até 'profundidade' passos à frente,
+        // sem repetir os que já foram pedidos por este fluxo
+        int passo = fluxo->passo;
+        int alvo = id_bloco + passo * profundidade;
+        int proximo = fluxo->proximo_prefetch;
+        if ((passo > 0 && proximo <= id_bloco) || (passo < 0 && proximo >= id_bloco)) {
+            proximo = id_bloco + passo;
+        }
+        int pedidos = 0;
+        for (int b = proximo; passo > 0 ? b <= alvo : b >= alvo; b += passo) {
+            if (b >= 0 && b < dsm_global->num_blocos) {
+                enfileirar_prefetch(b);
+                pedidos++;
+            }
+        }
+        fluxo->proximo_prefetch = alvo + passo;
+        if (pedidos > 0) {
+            pthread_cond_signal(&dsm_global->cond_prefetch);
+        }
+    }
+    
+    pthread_mutex_unlock(&dsm_global->mutex_prefetch);
+}
+
+// Traz para o cache os blocos pedidos pelo detector que ainda não estão lá
+static void carregar_blocos_prefetch(int *ids_blocos, int quantidade) {
+    int id = dsm_global->meu_id;
+    int faltantes[TAMANHO_FILA_PREFETCH];
+    BlocoCache *slots[TAMANHO_FILA_PREFETCH];
+    byte *destinos[TAMANHO_FILA_PREFETCH];
+    uint64_t versoes[TAMANHO_FILA_PREFETCH];
+    int resultados[TAMANHO_FILA_PREFETCH];
+    int num_faltantes = 0;
+    
+    // Ordenados, pedidos repetidos ficam adjacentes
+    qsort(ids_blocos, quantidade, sizeof(int), comparar_inteiros);
+    
+    for (int i = 0; i < quantidade; i++) {
+        int id_bloco = ids_blocos[i];
+        if ((i > 0 && ids_blocos[i - 1] == id_bloco) || calcular_dono_bloco(id_bloco) == dsm_global->meu_id) {
+            continue;
+        }
+        
+        // Só busca blocos sem cópia nem busca em andamento
+        BlocoCache *cache_bloco = obter_bloco_cache(id_bloco, 1);
+        if (!cache_bloco) continue;
+        pthread_mutex_lock(&cache_bloco->mutex);
+        int livre = cache_bloco->estado == CACHE_INVALIDO;
+        if (livre) {
+            // A cópia invalidada é oferecida ao dono para revalidação; até a
+            // resposta chegar os dados do slot não valem versão nenhuma
+            versoes[num_faltantes] = cache_bloco->versao;
+            cache_bloco->versao = 0;
+            cache_bloco->estado = CACHE_BUSCANDO;
+            cache_bloco->invalidado_na_busca = 0;
+        }
+        pthread_mutex_unlock(&cache_bloco->mutex);
+        if (!livre) {
+            liberar_bloco_cache(cache_bloco);
+            continue;
+        }
+        
+        faltantes[num_faltantes] = id_bloco;
+        slots[num_faltantes] = cache_bloco;
+        destinos[num_faltantes] = cache_bloco->dados;
+        num_faltantes++;
+    }
+    
+    if (num_faltantes == 0) return;
+    
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Prefetch de %d blocos a partir do bloco %d", id, num_faltantes, faltantes[0]);
+    requisitar_blocos_remotos(faltantes, destinos, versoes, resultados, num_faltantes);
+    
+    for (int i = 0; i < num_faltantes; i++) {
+        BlocoCache *cache_bloco = slots[i];
+        pthread_mutex_lock(&cache_bloco->mutex);
+        if (resultados[i] == 0) {
+            cache_bloco->versao = versoes[i];
+        }
+        if (resultados[i] == 0 && !cache_bloco->invalidado_na_busca) {
+            cache_bloco->estado = CACHE_COMPARTILHADO;
+            cache_bloco->prefetch = 1;
+            contar(PREFETCH_EMITIDOS);
+        } else {
+            if (resultados[i] == 0) {
+                contar(PREFETCH_DESPERDICADOS);
+            }
+            cache_bloco->estado = CACHE_INVALIDO;
+        }
+        pthread_cond_broadcast(&cache_bloco->cond);
+        pthread_mutex_unlock(&cache_bloco->mutex);
+        liberar_bloco_cache(cache_bloco);
+    }
+}
+
+// Consome a fila de prefetch em lotes, buscando cada lote com uma requisição por dono
+void* thread_prefetch(void* arg) {
+    (void)arg; // Suprimir warning de parâmetro não utilizado
+    int lote[TAMANHO_FILA_PREFETCH];
+    
+    for (;;) {
+        pthread_mutex_lock(&dsm_global->mutex_prefetch);
+        while (dsm_global->tamanho_fila_prefetch == 0 && dsm_global->prefetch_rodando) {
+            pthread_cond_wait(&dsm_global->cond_prefetch, &dsm_global->mutex_prefetch);
+        }
+        if (!dsm_global->prefetch_rodando) {
+            pthread_mutex_unlock(&dsm_global->mutex_prefetch);
+            break;
+        }
+        int quantidade = 0;
+        while (dsm_global->tamanho_fila_prefetch > 0) {
+            lote[quantidade++] = dsm_global->fila_prefetch[dsm_global->inicio_fila_prefetch];
+            dsm_global->inicio_fila_prefetch = (dsm_global->inicio_fila_prefetch + 1) % TAMANHO_FILA_PREFETCH;
+            dsm_global->tamanho_fila_prefetch--;
+        }
+        pthread_mutex_unlock(&dsm_global->mutex_prefetch);
+        
+        carregar_blocos_prefetch(lote, quantidade);
+    }
+    return NULL;
+}
+
+// =============================================================================
+// MIGRAÇÃO DE BLOCOS
+// =============================================================================
+
+// Descarta a cópia de um slot (mutex do slot travado). Buscas em andamento
+// e cópias modificadas não são esperadas: apenas marcadas para não voltarem
+// a CACHE_COMPARTILHADO.
+static void descartar_copia_travada(BlocoCache *cache_bloco) {
+    if (cache_bloco->estado == CACHE_BUSCANDO || cache_bloco->estado == CACHE_MODIFICADO) {
+        // Escritas em CACHE_MODIFICADO continuam visíveis localmente até o release
+        cache_bloco->invalidado_na_busca = 1;
+    } else {
+        if (cache_bloco->estado == CACHE_COMPARTILHADO && cache_bloco->prefetch) {
+            contar(PREFETCH_DESPERDICADOS);
+        }
+        cache_bloco->estado = CACHE_INVALIDO;
+    }
+    cache_bloco->prefetch = 0;
+}
+
+// Descarta a cópia do bloco no cache local
+static void invalidar_copia_no_cache(int id_bloco) {
+    BlocoCache *cache_bloco = obter_bloco_cache(id_bloco, 0);
+    if (!cache_bloco) {
+        return;
+    }
+    pthread_mutex_lock(&cache_bloco->mutex);
+    descartar_copia_travada(cache_bloco);
+    pthread_mutex_unlock(&cache_bloco->mutex);
+    liberar_bloco_cache(cache_bloco);
+}
+
+// Aplica na cópia do bloco no cache local a escrita que levou o dono à
+// 'versao'. Só uma cópia exatamente na versão anterior é atualizada; as
+// demais (atualizações fora de ordem, buscas em andamento) são descartadas
+// como em uma invalidação. Retorna 1 se a cópia ficou na versão nova.
+static int atualizar_copia_no_cache(int id_bloco, int offset, const byte *dados, int bytes, uint64_t versao) {
+    BlocoCache *cache_bloco = obter_bloco_cache(id_bloco, 0);
+    if (!cache_bloco) {
+        return 0;
+    }
+    int atualizada = 0;
+    pthread_mutex_lock(&cache_bloco->mutex);
+    if (cache_bloco->estado == CACHE_COMPARTILHADO && cache_bloco->versao == versao) {
+        atualizada = 1;
+    } else if (cache_bloco->estado == CACHE_COMPARTILHADO && versao > 1 && cache_bloco->versao == versao - 1) {
+        memcpy(cache_bloco->dados + offset, dados, bytes);
+        cache_bloco->versao = versao;
+        atualizada = 1;
+    } else {
+        descartar_copia_travada(cache_bloco);
+    }
+    pthread_mutex_unlock(&cache_bloco->mutex);
+    liberar_bloco_cache(cache_bloco);
+    return atualizada;
+}
+
+// Instala um bloco recebido por migração, com a versão que ele tinha no dono
+// anterior, em um índice livre da arena. Retorna 0 se o bloco foi instalado,
+// 1 se ele já é local nessa versão (MSG_MIGRAR_BLOCO reenviada depois de um
+// ACK perdido), -2 se já é local e foi escrito desde então e -1 se a arena
+// está cheia. Só com -1 o destino fica sem o bloco.
+static int instalar_bloco_migrado(int id_bloco, const byte *dados, uint64_t versao) {
+    pthread_mutex_lock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    if (dsm_global->indice_local[id_bloco] >= 0) {
+        uint64_t versao_local = __atomic_load_n(&dsm_global->versoes_dono[id_bloco], __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+        return versao_local == (versao ? versao : 1) ? 1 : -2;
+    }
+    
+    pthread_mutex_lock(&dsm_global->mutex_arena);
+    int idx_local = -1;
+    if (dsm_global->num_indices_livres > 0) {
+        idx_local = dsm_global->indices_livres[--dsm_global->num_indices_livres];
+        dsm_global->num_blocos_locais++;
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_arena);
+    if (idx_local < 0) {
+        pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+        return -1;
+    }
+    
+    // Um leitor atrasado do bloco que ocupava o índice percebe a troca pela versão
+    iniciar_escrita_bloco(idx_local);
+    memcpy(obter_bloco_local(idx_local), dados, dsm_global->tamanho_bloco);
+    __atomic_store_n(&dsm_global->versoes_dono[id_bloco], versao ? versao : 1, __ATOMIC_RELAXED);
+    dsm_global->versoes_no_historico[idx_local] = 0;
+    concluir_escrita_bloco(idx_local);
+    __atomic_store_n(&dsm_global->adaptacao[idx_local].releituras, 0, __ATOMIC_RELAXED);
+    dsm_global->adaptacao[idx_local].copias_invalidadas = 0;
+    dsm_global->adaptacao[idx_local].escritas_restantes = 0;
+    __atomic_store_n(&dsm_global->compartilhadores[idx_local], 0, __ATOMIC_SEQ_CST);
+    dsm_global->copias_em_invalidacao[idx_local] = 0;
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        __atomic_store_n(&dsm_global->acessos_bloco[idx_local * dsm_global->num_processos + p], 0, __ATOMIC_RELAXED);
+        dsm_global->invalidacoes_assumidas[idx_local * dsm_global->num_processos + p] = 0;
+    }
+    dsm_global->meus_blocos[idx_local] = id_bloco;
+    definir_indice_local(id_bloco, idx_local);
+    __atomic_store_n(&dsm_global->dono_do_bloco[id_bloco], dsm_global->meu_id, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    
+    // Uma cópia anterior no cache local não é mais usada e ficaria
+    // desatualizada se o bloco migrar de novo
+    invalidar_copia_no_cache(id_bloco);
+    contar(MIGRACOES_RECEBIDAS);
+    return 0;
+}
+
+// Avisa os demais processos (exceto o novo dono) de que o bloco migrou.
+// Quem perder o aviso ainda chega ao novo dono por redirecionamento.
+static void anunciar_dono(int id_bloco, int dono) {
+    uint32_t dono_rede = htonl((uint32_t)dono);
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        if (p == dsm_global->meu_id || p == dono) continue;
+        
+        Mensagem msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.tipo = MSG_ATUALIZAR_DONO;
+        msg.id_bloco = id_bloco;
+        msg.tamanho_dados = sizeof(uint32_t);
+        msg.dados = (byte*)&dono_rede;
+        trocar_mensagens(p, &msg, NULL);
+    }
+}
+
+// Transfere a posse de um bloco local para 'destino'. O bloco deixa de ser
+// local antes do envio: a partir daí leituras e escritas, inclusive as
+// deste processo, são redirecionadas ao destino, que as atende assim que
+// instala o bloco. As cópias registradas no diretório são invalidadas antes,
+// porque o diretório não acompanha o bloco. Se o destino recusar, o bloco
+// volta a ser local; sem nenhuma resposta, fica com o destino.
+int migrar_bloco(int id_bloco, int destino) {
+    int id = dsm_global->meu_id;
+    if (destino < 0 || destino >= dsm_global->num_processos || destino == id) {
+        return -1;
+    }
+    
+    int idx_local = travar_bloco_local(id_bloco);
+    if (idx_local < 0) {
+        return -1;
+    }
+    // Fora do índice, o conteúdo na arena não muda mais e o índice só volta
+    // à pilha de livres depois do ACK: o bloco é enviado direto de lá
+    byte *dados = obter_bloco_local(idx_local);
+    // O índice sai antes do diretório: quem se registrar depois da retirada
+    // já encontra o bloco fora do índice e não valida a leitura
+    definir_indice_local(id_bloco, -1);
+    // Inclui as cópias que escritas em andamento ainda estão invalidando:
+    // elas concluem depois da migração sem tocar mais no diretório
+    uint64_t copias = retirar_compartilhadores(idx_local) | dsm_global->copias_em_invalidacao[idx_local];
+    __atomic_store_n(&dsm_global->dono_do_bloco[id_bloco], destino, __ATOMIC_RELEASE);
+    
+    // Escritas adiadas do bloco são liberadas pela invalidação abaixo
+    pthread_mutex_lock(&dsm_global->mutex_sujos);
+    if (dsm_global->bloco_sujo[id_bloco]) {
+        dsm_global->bloco_sujo[id_bloco] = 0;
+        for (int i = 0; i < dsm_global->num_blocos_sujos; i++) {
+            if (dsm_global->blocos_sujos[i] == id_bloco) {
+                dsm_global->blocos_sujos[i] = dsm_global->blocos_sujos[--dsm_global->num_blocos_sujos];
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_sujos);
+    destravar_bloco_local(id_bloco);
+    
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Migrando bloco %d para o processo %d", id, id_bloco, destino);
+    invalidar_copia_no_cache(id_bloco);
+    invalidar_blocos_remotos(&id_bloco, &copias, NULL, 1);
+    
+    Mensagem msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_MIGRAR_BLOCO;
+    msg.id_bloco = id_bloco;
+    msg.tamanho_dados = dsm_global->tamanho_bloco;
+    msg.versao = __atomic_load_n(&dsm_global->versoes_dono[id_bloco], __ATOMIC_RELAXED);
+    msg.dados = dados;
+    
+    // Sem resposta, o destino pode ter instalado o bloco e perdido o ACK: a
+    // posse só volta com a recusa explícita, e o reenvio é idempotente
+    Mensagem resposta;
+    int entregue = 0;
+    int recusada = 0;
+    for (int tentativa = 0; tentativa < TENTATIVAS_MIGRACAO && !entregue && !recusada; tentativa++) {
+        if (tentativa > 0) {
+            usleep(ESPERA_MIGRACAO_MS * 1000);
+        }
+        resposta.dados = NULL;
+        if (trocar_mensagens(destino, &msg, &resposta) != 0 || resposta.id_bloco != id_bloco) {
+            continue;
+        }
+        entregue = (resposta.tipo == MSG_ACK_MIGRACAO || resposta.tipo == MSG_BLOCO_JA_INSTALADO);
+        // MSG_ERRO: migração inválida, também não instalada
+        recusada = (resposta.tipo == MSG_MIGRACAO_RECUSADA || resposta.tipo == MSG_ERRO);
+    }
+    
+    pthread_mutex_lock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    if (entregue) {
+        dsm_global->meus_blocos[idx_local] = -1;
+        pthread_mutex_lock(&dsm_global->mutex_arena);
+        dsm_global->indices_livres[dsm_global->num_indices_livres++] = idx_local;
+        dsm_global->num_blocos_locais--;
+        pthread_mutex_unlock(&dsm_global->mutex_arena);
+    } else if (recusada) {
+        // Nada alterou o índice enquanto o bloco estava fora: os dados continuam lá
+        definir_indice_local(id_bloco, idx_local);
+        __atomic_store_n(&dsm_global->dono_do_bloco[id_bloco], id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&dsm_global->travas_posse[id_bloco % NUM_TRAVAS_POSSE]);
+    
+    if (recusada) {
+        log_erro("    • ", "[P%d] Processo %d recusou o bloco %d; bloco mantido", id, destino, id_bloco);
+        return -1;
+    }
+    if (!entregue) {
+        // Retomar a posse poderia deixar o bloco com dois donos. O índice fica
+        // reservado com o conteúdo, e as requisições seguem para o destino.
+        log_erro("    • ", "[P%d] Processo %d não confirmou a migração do bloco %d; bloco fica com ele", 
+                   id, destino, id_bloco);
+        return -1;
+    }
+    
+    contar(MIGRACOES_ENVIADAS);
+    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d agora pertence ao processo %d", id, id_bloco, destino);
+    anunciar_dono(id_bloco, destino);
+    return 0;
+}
+
+// Uma rodada do rebalanceador: migra cada bloco local cujos acessos recentes
+// vêm em maioria de um único outro processo, desde que ele tenha feito pelo
+// menos ConfigDSM::limiar_migracao acessos. Os contadores são reduzidos à
+// metade, para que acessos antigos percam peso.
+static void rebalancear_blocos(void) {
+    int id = dsm_global->meu_id;
+    int candidatos[MAX_MIGRACOES_POR_RODADA];
+    int destinos[MAX_MIGRACOES_POR_RODADA];
+    int num_candidatos = 0;
+    
+    for (int idx_local = 0; idx_local < dsm_global->capacidade_arena; idx_local++) {
+        // Índices livres, ou de um bloco que está migrando, ficam de fora
+        int id_bloco = dsm_global->meus_blocos[idx_local];
+        if (id_bloco < 0 || obter_indice_local(id_bloco) != idx_local) continue;
+        
+        uint32_t *contadores = &dsm_global->acessos_bloco[idx_local * dsm_global->num_processos];
+        uint32_t total = 0;
+        uint32_t maior = 0;
+        int processo_maior = -1;
+        for (int p = 0; p < dsm_global->num_processos; p++) {
+            uint32_t acessos = __atomic_load_n(&contadores[p], __ATOMIC_RELAXED);
+            __atomic_store_n(&contadores[p], acessos / 2, __ATOMIC_RELAXED);
+            total += acessos;
+            if (p != id && acessos > maior) {
+                maior = acessos;
+                processo_maior = p;
+            }
+        }
+        
+        if (num_candidatos < MAX_MIGRACOES_POR_RODADA && processo_maior >= 0 &&
+            maior >= (uint32_t)dsm_global->config.limiar_migracao && maior * 2 > total) {
+            candidatos[num_candidatos] = id_bloco;
+            destinos[num_candidatos] = processo_maior;
+            num_candidatos++;
+        }
+    }
+    
+    for (int i = 0; i < num_candidatos; i++) {
+        migrar_bloco(candidatos[i], destinos[i]);
+    }
+}
+
+// Thread do rebalanceador: uma rodada a cada ConfigDSM::intervalo_migracao_ms
+void* thread_migracao(void* arg) {
+    (void)arg;
+    
+    pthread_mutex_lock(&dsm_global->mutex_migracao);
+    while (dsm_global->migracao_rodando) {
+        struct timespec limite;
+        clock_gettime(CLOCK_REALTIME, &limite);
+        limite.tv_sec += dsm_global->config.intervalo_migracao_ms / 1000;
+        limite.tv_nsec += (long)(dsm_global->config.intervalo_migracao_ms % 1000) * 1000000;
+        if (limite.tv_nsec >= 1000000000) {
+            limite.tv_sec++;
+            limite.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&dsm_global->cond_migracao, &dsm_global->mutex_migracao, &limite);
+        if (!dsm_global->migracao_rodando) break;
+        
+        pthread_mutex_unlock(&dsm_global->mutex_migracao);
+        rebalancear_blocos();
+        pthread_mutex_lock(&dsm_global->mutex_migracao);
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_migracao);
+    return NULL;
+}
+
+// =============================================================================
+// THREAD SERVIDORA
+// =============================================================================
+
+// Prepara 'resposta' como MSG_REDIRECIONAR para o dono conhecido do bloco;
+// 'dono_rede' guarda o payload
+static void preparar_redirecionamento(Mensagem *resposta, int id_bloco, uint32_t *dono_rede) {
+    *dono_rede = htonl((uint32_t)calcular_dono_bloco(id_bloco));
+    resposta->tipo = MSG_REDIRECIONAR;
+    resposta->tamanho_dados = sizeof(uint32_t);
+    resposta->dados = (byte*)dono_rede;
+}
+
+// Monta em 'destino' o payload de MSG_RESPOSTA_DELTA que leva uma cópia na
+// 'versao_cliente' à 'versao' atual do bloco local. Retorna o tamanho do
+// payload, ou -1 se o histórico não alcança a cópia ou se o bloco inteiro
+// sairia mais barato. Chamada dentro de uma leitura otimista: os trechos
+// lidos podem estar inconsistentes (ficam limitados ao bloco) e o resultado
+// só vale se a leitura for validada.
+static int montar_resposta_delta(int idx_local, uint64_t versao, uint64_t versao_cliente, byte *destino) {
+    int tamanho_bloco = dsm_global->tamanho_bloco;
+    uint64_t atraso = versao - versao_cliente;
+    int guardadas = dsm_global->versoes_no_historico[idx_local];
+    if (versao_cliente == 0 || atraso == 0 || guardadas > PROFUNDIDADE_DELTAS || atraso > (uint64_t)guardadas) {
+        return -1;
+    }
+    
+    // Trechos das versões posteriores à do cliente, ordenados pelo início
+    TrechoEscrito trechos[PROFUNDIDADE_DELTAS];
+    int num_trechos = 0;
+    for (uint64_t k = 0; k < atraso; k++) {
+        TrechoEscrito t = dsm_global->historico_escritas[idx_local * PROFUNDIDADE_DELTAS + (versao - k) % PROFUNDIDADE_DELTAS];
+        if (t.inicio < 0) t.inicio = 0;
+        if (t.fim > tamanho_bloco) t.fim = tamanho_bloco;
+        if (t.inicio >= t.fim) continue;
+        int j = num_trechos++;
+        while (j > 0 && trechos[j - 1].inicio > t.inicio) {
+            trechos[j] = trechos[j - 1];
+            j--;
+        }
+        trechos[j] = t;
+    }
+    
+    // Juntar trechos sobrepostos ou próximos
+    int juntos = 0;
+    for (int i = 0; i < num_trechos; i++) {
+        if (juntos > 0 && trechos[i].inicio <= trechos[juntos - 1].fim + FOLGA_JUNCAO_DELTA) {
+            if (trechos[i].fim > trechos[juntos - 1].fim) trechos[juntos - 1].fim = trechos[i].fim;
+        } else {
+            trechos[juntos++] = trechos[i];
+        }
+    }
+    if (juntos == 0) {
+        return -1;
+    }
+    
+    int tamanho = (int)((1 + 2 * juntos) * sizeof(uint32_t));
+    for (int i = 0; i < juntos; i++) {
+        tamanho += trechos[i].fim - trechos[i].inicio;
+    }
+    if (tamanho >= tamanho_bloco) {
+        return -1;
+    }
+    
+    uint32_t campo = htonl((uint32_t)juntos);
+    memcpy(destino, &campo, sizeof(campo));
+    byte *posicao = destino + (1 + 2 * juntos) * sizeof(uint32_t);
+    const byte *bloco = obter_bloco_local(idx_local);
+    for (int i = 0; i < juntos; i++) {
+        int bytes = trechos[i].fim - trechos[i].inicio;
+        uint32_t par[2] = { htonl((uint32_t)trechos[i].inicio), htonl((uint32_t)bytes) };
+        memcpy(destino + (1 + 2 * i) * sizeof(uint32_t), par, sizeof(par));
+        memcpy(posicao, bloco + trechos[i].inicio, bytes);
+        posicao += bytes;
+    }
+    return tamanho;
+}
+
+// Troca o payload de um MSG_RESPOSTA_BLOCO pela sua versão comprimida, se
+// ela economiza ao menos GANHO_MINIMO_COMPRESSAO bytes
+static void comprimir_resposta(Mensagem *resposta) {
+    int tamanho = resposta->tamanho_dados;
+    int comprimido = 0;
+    if (bloco_zerado(resposta->dados, tamanho)) {
+        resposta->flags = FLAG_BLOCO_ZERADO;
+    } else {
+        comprimido = comprimir_lz(resposta->dados, tamanho, buffer_compressao, tamanho - GANHO_MINIMO_COMPRESSAO);
+        if (comprimido < 0) return;
+        resposta->flags = FLAG_COMPRESSAO_LZ;
+        resposta->dados = buffer_compressao;
+    }
+    resposta->tamanho_dados = comprimido;
+    contar(RESPOSTAS_COMPRIMIDAS);
+    somar(BYTES_SEM_COMPRESSAO, (uint64_t)tamanho);
+    somar(BYTES_COMPRIMIDOS, (uint64_t)comprimido);
+}
+
+// Envia o conteúdo de um bloco próprio, MSG_NAO_MODIFICADO se o requisitante
+// já tem a versão atual ('versao_cliente'), MSG_RESPOSTA_DELTA se ele está
+// poucas versões atrás, MSG_REDIRECIONAR se o bloco migrou ou MSG_ERRO se o
+// ID é inválido. Com 'flags_requisicao' contendo FLAG_ACEITA_COMPRESSAO (e a
+// compressão ligada aqui), o bloco inteiro pode ir comprimido. Retorna -1
+// apenas se o envio falhou.
+static int responder_bloco(int socket_cliente, int id_bloco, uint64_t versao_cliente, int origem, uint32_t sequencia,
+                           int flags_requisicao) {
+    int id = dsm_global->meu_id;
+    
+    // Preparar resposta com os dados do bloco
+    Mensagem resposta;
+    memset(&resposta, 0, sizeof(resposta));
+    resposta.tipo = MSG_ERRO;
+    resposta.id_bloco = id_bloco;
+    resposta.sequencia = sequencia;
+    
+    // O bloco é copiado para o buffer da thread sem travar nada (seqlock),
+    // e a resposta sai de lá: escritas locais não esperam pelo envio e o
+    // processo remoto sempre recebe um retrato consistente
+    int remoto = origem >= 0 && origem < dsm_global->num_processos && origem != id;
+    uint32_t sequencia_seqlock;
+    uint64_t versao = 0;
+    int tamanho_delta = -1;
+    int idx_local;
+    do {
+        idx_local = iniciar_leitura_bloco(id_bloco, &sequencia_seqlock);
+        if (idx_local < 0) break;
+        if (remoto) {
+            registrar_compartilhador(idx_local, origem);
+        }
+        versao = __atomic_load_n(&dsm_global->versoes_dono[id_bloco], __ATOMIC_RELAXED);
+        tamanho_delta = -1;
+        if (versao != versao_cliente) {
+            tamanho_delta = montar_resposta_delta(idx_local, versao, versao_cliente, buffer_resposta_bloco);
+            if (tamanho_delta < 0) {
+                memcpy(buffer_resposta_bloco, obter_bloco_local(idx_local), dsm_global->tamanho_bloco);
+            }
+        }
+    } while (!validar_leitura_bloco(id_bloco, idx_local, sequencia_seqlock));
+    
+    uint32_t dono_rede;
+    if (idx_local >= 0) {
+        if (remoto) {
+            registrar_acesso_bloco(idx_local, origem);
+            // Quem oferece uma versão já teve cópia do bloco: no modo
+            // adaptativo, é uma cópia invalidada voltando
+            if (versao_cliente != 0 && versao != versao_cliente &&
+                __atomic_load_n(&dsm_global->protocolo_bloco[id_bloco], __ATOMIC_RELAXED) == PROTOCOLO_ADAPTATIVO) {
+                __atomic_add_fetch(&dsm_global->adaptacao[idx_local].releituras, 1, __ATOMIC_RELAXED);
+            }
+        }
+        resposta.versao = versao;
+        if (versao == versao_cliente) {
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d não mudou desde a versão %llu do cliente", id, id_bloco, (unsigned long long)versao);
+            resposta.tipo = MSG_NAO_MODIFICADO;
+        } else if (tamanho_delta >= 0) {
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Enviando ao cliente os trechos do bloco %d alterados desde a versão %llu (%d bytes)",
+                      id, id_bloco, (unsigned long long)versao_cliente, tamanho_delta);
+            resposta.tipo = MSG_RESPOSTA_DELTA;
+            resposta.tamanho_dados = tamanho_delta;
+            resposta.dados = buffer_resposta_bloco;
+        } else {
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Enviando bloco %d para cliente", id, id_bloco);
+            resposta.tipo = MSG_RESPOSTA_BLOCO;
+            resposta.tamanho_dados = dsm_global->tamanho_bloco;
+            resposta.dados = buffer_resposta_bloco;
+            if ((flags_requisicao & FLAG_ACEITA_COMPRESSAO) && buffer_compressao) {
+                comprimir_resposta(&resposta);
+            }
+        }
+    } else if (id_bloco >= 0 && id_bloco < dsm_global->num_blocos) {
+        preparar_redirecionamento(&resposta, id_bloco, &dono_rede);
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d não é mais meu; redirecionando ao processo %d", id, id_bloco, calcular_dono_bloco(id_bloco));
+    } else {
+        log_erro("    • ", "[P%d] Erro: requisição para bloco inválido %d", id, id_bloco);
+    }
+    
+    // Enviar resposta
+    if (transmitir_mensagem(socket_cliente, &resposta) != 0) {
+        return -1;
+    }
+    if (resposta.tipo == MSG_RESPOSTA_BLOCO) {
+        log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d enviado com sucesso", id, id_bloco);
+    }
+    return 0;
+}
+
+// Processa uma mensagem recebida e envia a resposta pelo mesmo socket.
+// Toda requisição recebe uma resposta, inclusive em caso de erro, para que o
+// cliente nunca fique bloqueado esperando na conexão persistente.
+static void tratar_mensagem(int socket_cliente, Mensagem *msg) {
+    int id = dsm_global->meu_id;
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Mensagem recebida: tipo=%d, bloco=%d", id, msg->tipo, msg->id_bloco);
+    
+    switch (msg->tipo) {
+        case MSG_REQUISICAO_BLOCO:
+            responder_bloco(socket_cliente, msg->id_bloco, msg->versao, msg->origem, msg->sequencia, msg->flags);
+            break;
+        
+        case MSG_REQUISICAO_MULTIPLA: {
+            // Payload: pares (ID de 32 bits, versão da cópia do cliente de 64
+            // bits) em ordem de rede. Os blocos são respondidos em sequência,
+            // um MSG_RESPOSTA_BLOCO, MSG_NAO_MODIFICADO ou MSG_ERRO por par,
+            // todos com a sequência da requisição
+            int quantidade = msg->tamanho_dados / TAMANHO_PAR_REQUISICAO;
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Enviando %d blocos para cliente", id, quantidade);
+            for (int i = 0; i < quantidade; i++) {
+                uint32_t par_rede[3];
+                memcpy(par_rede, msg->dados + i * TAMANHO_PAR_REQUISICAO, TAMANHO_PAR_REQUISICAO);
+                uint64_t versao_cliente = ((uint64_t)ntohl(par_rede[1]) << 32) | ntohl(par_rede[2]);
+                if (responder_bloco(socket_cliente, (int32_t)ntohl(par_rede[0]), versao_cliente,
+                                    msg->origem, msg->sequencia, msg->flags) != 0) {
+                    break;
+                }
+            }
+            break;
+        }
+        
+        case MSG_INVALIDAR_BLOCO: {
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Invalidando bloco %d no cache local", id, msg->id_bloco);
+            
+            // Blocos fora do cache não têm o que invalidar
+            invalidar_copia_no_cache(msg->id_bloco);
+            
+            contar(INVALIDACOES_RECEBIDAS);
+            
+            // Enviar ACK
+            Mensagem ack;
+            memset(&ack, 0, sizeof(ack));
+            ack.tipo = MSG_ACK_INVALIDACAO;
+            ack.id_bloco = msg->id_bloco;
+            ack.sequencia = msg->sequencia;
+            transmitir_mensagem(socket_cliente, &ack);
+            
+            log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d invalidado e ACK enviado", id, msg->id_bloco);
+            break;
+        }
+        
+        case MSG_ATUALIZAR_COPIA: {
+            // id_bloco leva a posição global do primeiro byte escrito; o
+            // payload, os dados. A confirmação é a mesma da invalidação
+            int posicao = msg->id_bloco;
+            int id_bloco = posicao / dsm_global->tamanho_bloco;
+            int offset = posicao % dsm_global->tamanho_bloco;
+            if (posicao < 0 || id_bloco >= dsm_global->num_blocos || msg->tamanho_dados <= 0 ||
+                msg->tamanho_dados > dsm_global->tamanho_bloco - offset) {
+                log_erro("    • ", "[P%d] Atualização inválida na posição %d (%d bytes)", id, posicao, msg->tamanho_dados);
+            } else if (atualizar_copia_no_cache(id_bloco, offset, msg->dados, msg->tamanho_dados, msg->versao)) {
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Cópia do bloco %d atualizada para a versão %llu", id, id_bloco, (unsigned long long)msg->versao);
+                contar(ATUALIZACOES_APLICADAS);
+            } else {
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Cópia do bloco %d não estava na versão anterior a %llu; descartada", id, id_bloco, (unsigned long long)msg->versao);
+                contar(INVALIDACOES_RECEBIDAS);
+            }
+            
+            Mensagem ack;
+            memset(&ack, 0, sizeof(ack));
+            ack.tipo = MSG_ACK_INVALIDACAO;
+            ack.id_bloco = msg->id_bloco;
+            ack.sequencia = msg->sequencia;
+            transmitir_mensagem(socket_cliente, &ack);
+            break;
+        }
+        
+        case MSG_ESCRITA_REMOTA: {
+            // id_bloco leva a posição global do primeiro byte; o payload, os dados
+            int posicao = msg->id_bloco;
+            int id_bloco = posicao / dsm_global->tamanho_bloco;
+            int offset = posicao % dsm_global->tamanho_bloco;
+            
+            Mensagem resposta;
+            memset(&resposta, 0, sizeof(resposta));
+            resposta.tipo = MSG_ERRO;
+            resposta.id_bloco = msg->id_bloco;
+            resposta.sequencia = msg->sequencia;
+            
+            uint32_t dono_rede;
+            uint32_t ack_rede[3];
+            uint64_t copias;
+            AtualizacaoCopia atualizacao;
+            if (posicao < 0 || id_bloco >= dsm_global->num_blocos || msg->tamanho_dados <= 0 ||
+                msg->tamanho_dados > dsm_global->tamanho_bloco - offset ||
+                msg->origem < 0 || msg->origem >= dsm_global->num_processos) {
+                log_erro("    • ", "[P%d] Escrita remota inválida na posição %d (%d bytes)", id, posicao, msg->tamanho_dados);
+                transmitir_mensagem(socket_cliente, &resposta);
+                break;
+            }
+            
+            EscritaConfirmada *ultima = &dsm_global->escritas_confirmadas[msg->origem];
+            pthread_mutex_lock(&ultima->mutex);
+            if (ultima->instancia == msg->versao && ultima->posicao == posicao &&
+                ultima->sequencia == msg->sequencia && ultima->bytes == msg->tamanho_dados) {
+                // Retransmissão de uma escrita já aplicada: a confirmação se
+                // perdeu. Se a conexão dela caiu, as cópias foram liberadas e
+                // voltam a ficar em invalidação até quem escreveu concluir
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Escrita do processo %d no bloco %d retransmitida; repetindo a confirmação", id, msg->origem, id_bloco);
+                int idx_local;
+                if (ultima->socket < 0 && (idx_local = travar_bloco_local(id_bloco)) >= 0) {
+                    ultima->copias = assumir_invalidacao(idx_local, ultima->copias);
+                    destravar_bloco_local(id_bloco);
+                }
+                resposta.tipo = MSG_ACK_ESCRITA;
+            } else if (aplicar_escrita_local(id_bloco, offset, msg->dados, msg->tamanho_dados, msg->origem, &copias, &atualizacao) == 0) {
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Escrita do processo %d aplicada no bloco %d", id, msg->origem, id_bloco);
+                
+                // A escrita já foi liberada por quem a enviou: as cópias
+                // do bloco vão na confirmação, com o protocolo a usar, e quem
+                // escreveu as invalida ou atualiza antes de retornar, em
+                // qualquer modo. Fazer isso aqui prenderia esta thread
+                // trabalhadora esperando os outros processos, e dois donos
+                // fazendo isso ao mesmo tempo travam (sempre, com uma
+                // trabalhadora por processo)
+                ultima->instancia = msg->versao;
+                ultima->sequencia = msg->sequencia;
+                ultima->posicao = posicao;
+                ultima->bytes = msg->tamanho_dados;
+                ultima->copias = copias;
+                ultima->versao = atualizacao.versao;
+                ultima->protocolo = atualizacao.dados ? PROTOCOLO_ATUALIZACAO : PROTOCOLO_INVALIDACAO;
+                resposta.tipo = MSG_ACK_ESCRITA;
+                contar(ESCRITAS_REMOTAS_RECEBIDAS);
+            } else {
+                preparar_redirecionamento(&resposta, id_bloco, &dono_rede);
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d não é mais meu; redirecionando escrita ao processo %d", id, id_bloco, calcular_dono_bloco(id_bloco));
+            }
+            
+            if (resposta.tipo == MSG_ACK_ESCRITA) {
+                ack_rede[0] = htonl((uint32_t)(ultima->copias >> 32));
+                ack_rede[1] = htonl((uint32_t)ultima->copias);
+                ack_rede[2] = htonl(ultima->protocolo);
+                resposta.versao = ultima->versao;
+                resposta.tamanho_dados = sizeof(ack_rede);
+                resposta.dados = (byte*)ack_rede;
+                if (transmitir_mensagem(socket_cliente, &resposta) == 0) {
+                    ultima->socket = socket_cliente;
+                } else {
+                    // Quem escreveu não vai invalidar as cópias; se retransmitir,
+                    // recebe a mesma confirmação
+                    ultima->socket = -1;
+                    concluir_invalidacao(id_bloco, ultima->copias, ultima->copias);
+                }
+            } else {
+                transmitir_mensagem(socket_cliente, &resposta);
+            }
+            pthread_mutex_unlock(&ultima->mutex);
+            break;
+        }
+        
+        case MSG_ESCRITA_CONCLUIDA: {
+            // Apenas um aviso: não há resposta
+            int posicao = msg->id_bloco;
+            uint32_t conclusao_rede[5];
+            if (posicao < 0 || posicao >= dsm_global->tamanho_memoria || msg->tamanho_dados != (int)sizeof(conclusao_rede) ||
+                msg->origem < 0 || msg->origem >= dsm_global->num_processos) {
+                log_erro("    • ", "[P%d] Conclusão de escrita inválida na posição %d", id, posicao);
+                break;
+            }
+            memcpy(conclusao_rede, msg->dados, sizeof(conclusao_rede));
+            uint64_t assumidas = ((uint64_t)ntohl(conclusao_rede[0]) << 32) | ntohl(conclusao_rede[1]);
+            uint64_t sem_ack = ((uint64_t)ntohl(conclusao_rede[2]) << 32) | ntohl(conclusao_rede[3]);
+            uint32_t instancia = ntohl(conclusao_rede[4]);
+            
+            EscritaConfirmada *ultima = &dsm_global->escritas_confirmadas[msg->origem];
+            pthread_mutex_lock(&ultima->mutex);
+            if (ultima->instancia == instancia && ultima->sequencia == msg->versao && ultima->posicao == posicao) {
+                // Se a conexão da confirmação caiu antes, encerrar_conexao_aceita
+                // já liberou as cópias: só as sem ACK voltam ao diretório
+                if (ultima->socket < 0) assumidas = 0;
+                ultima->socket = -1;
+            }
+            concluir_invalidacao(posicao / dsm_global->tamanho_bloco, assumidas, sem_ack);
+            pthread_mutex_unlock(&ultima->mutex);
+            log_debug(COLOR_DEFAULT, "    • ", "[P%d] Processo %d concluiu a escrita no bloco %d", id, msg->origem, posicao / dsm_global->tamanho_bloco);
+            break;
+        }
+        
+        case MSG_MIGRAR_BLOCO: {
+            Mensagem resposta;
+            memset(&resposta, 0, sizeof(resposta));
+            resposta.tipo = MSG_ERRO;
+            resposta.id_bloco = msg->id_bloco;
+            resposta.sequencia = msg->sequencia;
+            
+            if (msg->id_bloco < 0 || msg->id_bloco >= dsm_global->num_blocos || msg->tamanho_dados != dsm_global->tamanho_bloco) {
+                log_erro("    • ", "[P%d] Migração inválida do bloco %d", id, msg->id_bloco);
+            } else {
+                int instalacao = instalar_bloco_migrado(msg->id_bloco, msg->dados, msg->versao);
+                if (instalacao == 0) {
+                    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d migrado do processo %d", id, msg->id_bloco, msg->origem);
+                    resposta.tipo = MSG_ACK_MIGRACAO;
+                } else if (instalacao == 1) {
+                    // O ACK anterior se perdeu: confirmar de novo, sem reinstalar
+                    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Migração repetida do bloco %d; já instalado", id, msg->id_bloco);
+                    resposta.tipo = MSG_ACK_MIGRACAO;
+                } else if (instalacao == -2) {
+                    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Migração repetida do bloco %d; já instalado e escrito desde então", id, msg->id_bloco);
+                    resposta.tipo = MSG_BLOCO_JA_INSTALADO;
+                    resposta.versao = __atomic_load_n(&dsm_global->versoes_dono[msg->id_bloco], __ATOMIC_RELAXED);
+                } else {
+                    log_erro("    • ", "[P%d] Sem espaço na arena para o bloco %d; migração recusada", id, msg->id_bloco);
+                    resposta.tipo = MSG_MIGRACAO_RECUSADA;
+                }
+            }
+            transmitir_mensagem(socket_cliente, &resposta);
+            break;
+        }
+        
+        case MSG_ATUALIZAR_DONO: {
+            // Apenas um aviso: não há resposta
+            if (msg->tamanho_dados == (int)sizeof(uint32_t)) {
+                uint32_t dono_rede;
+                memcpy(&dono_rede, msg->dados, sizeof(uint32_t));
+                atualizar_dono_conhecido(msg->id_bloco, (int32_t)ntohl(dono_rede));
+            }
+            break;
+        }
+        
+        default: {
+            log_erro("    • ", "[P%d] Tipo de mensagem desconhecido: %d", id, msg->tipo);
+            Mensagem erro;
+            memset(&erro, 0, sizeof(erro));
+            erro.tipo = MSG_ERRO;
+            erro.id_bloco = msg->id_bloco;
+            erro.sequencia = msg->sequencia;
+            transmitir_mensagem(socket_cliente, &erro);
+            break;
+        }
+    }
+}
+
+// Remove a conexão do epoll e do registro de conexões aceitas e fecha o
+// socket. Uma escrita remota confirmada por ela e ainda não concluída volta
+// a ter as cópias no diretório: quem escreveu pode ter caído antes de
+// invalidá-las
+static void encerrar_conexao_aceita(int socket_cliente) {
+    epoll_ctl(dsm_global->epoll_fd, EPOLL_CTL_DEL, socket_cliente, NULL);
+    
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        EscritaConfirmada *ultima = &dsm_global->escritas_confirmadas[p];
+        pthread_mutex_lock(&ultima->mutex);
+        if (ultima->socket == socket_cliente) {
+            ultima->socket = -1;
+            concluir_invalidacao(ultima->posicao / dsm_global->tamanho_bloco, ultima->copias, ultima->copias);
+        }
+        pthread_mutex_unlock(&ultima->mutex);
+    }
+    
+    pthread_mutex_lock(&dsm_global->mutex_conexoes);
+    for (int i = 0; i < MAX_CONEXOES_ACEITAS; i++) {
+        if (dsm_global->sockets_aceitos[i] == socket_cliente) {
+            dsm_global->sockets_aceitos[i] = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_conexoes);
+    
+    close(socket_cliente);
+}
+
+// (Re)arma a conexão no epoll. EPOLLONESHOT garante que apenas uma thread
+// trabalhadora atende a conexão por vez, preservando a ordem das mensagens.
+static int armar_conexao(int socket_cliente, int operacao) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = socket_cliente;
+    return epoll_ctl(dsm_global->epoll_fd, operacao, socket_cliente, &ev);
+}
+
+// Aceita todas as conexões pendentes no socket servidor (não bloqueante)
+static void aceitar_conexoes(void) {
+    int id = dsm_global->meu_id;
+    
+    for (;;) {
+        struct sockaddr_in addr_cliente;
+        socklen_t len_addr = sizeof(addr_cliente);
+        int socket_cliente = accept(dsm_global->socket_servidor, 
+                                  (struct sockaddr*)&addr_cliente, &len_addr);
+        if (socket_cliente == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && dsm_global->servidor_rodando) {
+                log_erro("    • ", "[P%d] Erro ao aceitar conexão: %s", id, strerror(errno));
+            }
+            return;
+        }
+        
+        int opt = 1;
+        setsockopt(socket_cliente, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        
+        // Registrar a conexão
+        pthread_mutex_lock(&dsm_global->mutex_conexoes);
+        int slot = -1;
+        for (int i = 0; i < MAX_CONEXOES_ACEITAS; i++) {
+            if (dsm_global->sockets_aceitos[i] == -1) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot >= 0) {
+            dsm_global->sockets_aceitos[slot] = socket_cliente;
+        }
+        pthread_mutex_unlock(&dsm_global->mutex_conexoes);
+        
+        if (slot < 0) {
+            log_erro("    • ", "[P%d] Limite de conexões atingido, conexão recusada", id);
+            close(socket_cliente);
+            continue;
+        }
+        
+        if (armar_conexao(socket_cliente, EPOLL_CTL_ADD) == -1) {
+            log_erro("    • ", "[P%d] Erro ao registrar conexão no epoll: %s", id, strerror(errno));
+            encerrar_conexao_aceita(socket_cliente);
+            continue;
+        }
+        
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Nova conexão aceita", id);
+    }
+}
+
+static void enfileirar_conexao(int socket_cliente) {
+    pthread_mutex_lock(&dsm_global->mutex_fila);
+    int fim = (dsm_global->inicio_fila + dsm_global->tamanho_fila) % MAX_CONEXOES_ACEITAS;
+    dsm_global->fila_prontos[fim] = socket_cliente;
+    dsm_global->tamanho_fila++;
+    pthread_cond_signal(&dsm_global->cond_fila);
+    pthread_mutex_unlock(&dsm_global->mutex_fila);
+}
+
+// Retorna a próxima conexão com mensagem pendente, ou -1 quando o servidor parou
+static int desenfileirar_conexao(void) {
+    int socket_cliente = -1;
+    pthread_mutex_lock(&dsm_global->mutex_fila);
+    while (dsm_global->tamanho_fila == 0 && dsm_global->servidor_rodando) {
+        pthread_cond_wait(&dsm_global->cond_fila, &dsm_global->mutex_fila);
+    }
+    if (dsm_global->servidor_rodando) {
+        socket_cliente = dsm_global->fila_prontos[dsm_global->inicio_fila];
+        dsm_global->inicio_fila = (dsm_global->inicio_fila + 1) % MAX_CONEXOES_ACEITAS;
+        dsm_global->tamanho_fila--;
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_fila);
+    return socket_cliente;
+}
+
+// Atende uma mensagem por vez das conexões entregues pelo loop de eventos
+void* thread_trabalhadora(void* arg) {
+    (void)arg; // Suprimir warning de parâmetro não utilizado
+    
+    // Buffers de payload e de resposta da thread, com capacidade para um bloco
+    byte *payload = (byte*)malloc(dsm_global->tamanho_bloco);
+    buffer_resposta_bloco = (byte*)malloc(dsm_global->tamanho_bloco);
+    if (dsm_global->config.compressao) {
+        buffer_compressao = (byte*)malloc(dsm_global->tamanho_bloco);
+    }
+    if (!payload || !buffer_resposta_bloco || (dsm_global->config.compressao && !buffer_compressao)) {
+        log_erro("    • ", "[P%d] Erro ao alocar buffer da thread trabalhadora", dsm_global->meu_id);
+        free(payload);
+        free(buffer_resposta_bloco);
+        free(buffer_compressao);
+        return NULL;
+    }
     
-    va_end(args);
-    fflush(stdout);
-}
-
-void imprimir_estatisticas(int id) {
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache hits: %d", id, cache_hits);
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache misses: %d", id, cache_misses);
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidações enviadas: %d", id, invalidacoes_enviadas);
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidações recebidas: %d", id, invalidacoes_recebidas);
-    float taxa = (cache_hits + cache_misses) > 0 ? 
-                 (cache_hits * 100.0) / (cache_hits + cache_misses) : 0.0;
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Taxa de acerto do cache: %.2f%%", id, taxa);
+    Mensagem msg;
+    int socket_cliente;
+    while ((socket_cliente = desenfileirar_conexao()) != -1) {
+        msg.dados = payload;
+        if (receber_mensagem(socket_cliente, &msg) == 0) {
+            tratar_mensagem(socket_cliente, &msg);
+            if (armar_conexao(socket_cliente, EPOLL_CTL_MOD) == 0) {
+                continue;
+            }
+        }
+        encerrar_conexao_aceita(socket_cliente);
+    }
+    free(payload);
+    free(buffer_resposta_bloco);
+    free(buffer_compressao);
+    return NULL;
 }
 
-void imprimir_estado_cache(void) {
+// Loop de eventos: aceita conexões e entrega as que têm mensagem pendente
+// às threads trabalhadoras
+void* thread_servidora(void* arg) {
+    (void)arg; // Suprimir warning de parâmetro não utilizado
     int id = dsm_global->meu_id;
-    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] ESTADO DO CACHE", id);
-    int blocos_validos = 0;
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
-        if (dsm_global->meu_cache[i].valido) {
-            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d: VÁLIDO", id, i);
-            blocos_validos++;
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Thread servidora iniciada (%d threads trabalhadoras)", 
+               id, dsm_global->num_threads_trabalhadoras);
+    
+    struct epoll_event eventos[64];
+    while (dsm_global->servidor_rodando) {
+        int n = epoll_wait(dsm_global->epoll_fd, eventos, 64, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            log_erro("    • ", "[P%d] Erro no epoll_wait: %s", id, strerror(errno));
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            int fd = eventos[i].data.fd;
+            if (fd == dsm_global->evento_parada) {
+                continue;
+            } else if (fd == dsm_global->socket_servidor) {
+                aceitar_conexoes();
+            } else {
+                enfileirar_conexao(fd);
+            }
         }
     }
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Total de blocos em cache: %d", id, blocos_validos);
+    
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Thread servidora finalizada", id);
+    return NULL;
 }
 
 // =============================================================================
-// FUNÇÕES AUXILIARES
+// INICIALIZAÇÃO E LIMPEZA
 // =============================================================================
 
-int calcular_dono_bloco(int id_bloco) {
-    // Distribuição por módulo: bloco i pertence ao processo (i % num_processos)
-    return id_bloco % dsm_global->num_processos;
+// Mistura de bits do MurmurHash3 (fmix32): espalha IDs consecutivos pelo anel
+static uint32_t misturar_hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
 }
 
-int e_meu_bloco(int id_bloco) {
-    return calcular_dono_bloco(id_bloco) == dsm_global->meu_id;
+// Ponto do anel do hashing consistente
+typedef struct {
+    uint32_t hash;
+    int processo;
+} PontoAnel;
+
+static int comparar_pontos_anel(const void *a, const void *b) {
+    const PontoAnel *x = (const PontoAnel*)a;
+    const PontoAnel *y = (const PontoAnel*)b;
+    if (x->hash != y->hash) return (x->hash > y->hash) - (x->hash < y->hash);
+    return (x->processo > y->processo) - (x->processo < y->processo);
 }
 
-BlocoCache* obter_bloco_cache(int id_bloco) {
-    if (id_bloco < 0 || id_bloco >= K_NUM_BLOCOS) {
-        return NULL;
+// Hashing consistente: cada processo ocupa NOS_VIRTUAIS_HASH pontos do anel
+// e cada bloco pertence ao primeiro ponto a partir do seu hash. Incluir um
+// processo move apenas os blocos que caem nos pontos dele.
+static int distribuir_por_hash(int num_processos) {
+    int num_pontos = num_processos * NOS_VIRTUAIS_HASH;
+    PontoAnel *anel = (PontoAnel*)malloc(num_pontos * sizeof(PontoAnel));
+    if (!anel) {
+        return -1;
+    }
+    for (int p = 0; p < num_processos; p++) {
+        for (int v = 0; v < NOS_VIRTUAIS_HASH; v++) {
+            anel[p * NOS_VIRTUAIS_HASH + v].hash = misturar_hash(((uint32_t)p << 16) ^ (uint32_t)v ^ 0x9e3779b9U);
+            anel[p * NOS_VIRTUAIS_HASH + v].processo = p;
+        }
+    }
+    qsort(anel, num_pontos, sizeof(PontoAnel), comparar_pontos_anel);
+    
+    for (int i = 0; i < dsm_global->num_blocos; i++) {
+        uint32_t hash = misturar_hash((uint32_t)i);
+        int inicio = 0;
+        int fim = num_pontos;
+        while (inicio < fim) {
+            int meio = (inicio + fim) / 2;
+            if (anel[meio].hash < hash) {
+                inicio = meio + 1;
+            } else {
+                fim = meio;
+            }
+        }
+        dsm_global->dono_do_bloco[i] = anel[inicio % num_pontos].processo;
     }
-    return &dsm_global->meu_cache[id_bloco];
+    
+    free(anel);
+    return 0;
 }
 
-// =============================================================================
-// COMUNICAÇÃO DE REDE
-// =============================================================================
-
-int enviar_mensagem(int id_processo_destino, Mensagem *msg) {
+// Lê o mapa explícito de donos. Cada linha tem "primeiro ultimo processo"
+// (ou "bloco processo"); linhas vazias e o que vem depois de '#' são
+// ignorados. Todo bloco precisa ter exatamente um dono.
+static int carregar_mapa_distribuicao(const char *arquivo, int num_processos) {
     int id = dsm_global->meu_id;
-    if (id_processo_destino < 0 || id_processo_destino >= dsm_global->num_processos) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] ID de processo destino inválido: %d", id, id_processo_destino);
+    if (arquivo[0] == '\0') {
+        log_erro("    • ", "[P%d] DISTRIBUICAO_MAPA exige ConfigDSM::arquivo_distribuicao", id);
         return -1;
     }
     
-    if (id_processo_destino == dsm_global->meu_id) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Tentativa de enviar mensagem para si mesmo", id);
+    FILE *entrada = fopen(arquivo, "r");
+    if (!entrada) {
+        log_erro("    • ", "[P%d] Erro ao abrir mapa de distribuição %s: %s", id, arquivo, strerror(errno));
         return -1;
     }
     
-    InfoProcesso *destino = &dsm_global->processos[id_processo_destino];
-    
-    // Criar socket cliente
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao criar socket cliente: %s", id, strerror(errno));
-        return -1;
+    for (int i = 0; i < dsm_global->num_blocos; i++) {
+        dsm_global->dono_do_bloco[i] = -1;
     }
     
-    // Configurar endereço do destino
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(destino->porta);
-    inet_pton(AF_INET, destino->ip, &addr.sin_addr);
-    
-    // Conectar
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        if (errno == ECONNREFUSED) {
-            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Processo %d não está disponível (provavelmente finalizado)", id, id_processo_destino);
-        } else {
-            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao conectar com processo %d (%s:%d): %s", 
-                       id, id_processo_destino, destino->ip, destino->porta, strerror(errno));
+    char linha[256];
+    int num_linha = 0;
+    int resultado = 0;
+    while (resultado == 0 && fgets(linha, sizeof(linha), entrada)) {
+        num_linha++;
+        char *comentario = strchr(linha, '#');
+        if (comentario) *comentario = '\0';
+        
+        // Texto depois dos números, ou no lugar deles, invalida a linha
+        int primeiro, ultimo, processo;
+        char resto[2];
+        int campos = sscanf(linha, "%d %d %d %1s", &primeiro, &ultimo, &processo, resto);
+        if (campos == EOF) continue;
+        if (campos == 2 && sscanf(linha, "%d %d %1s", &primeiro, &ultimo, resto) == 2) {
+            processo = ultimo;
+            ultimo = primeiro;
+        } else if (campos != 3) {
+            primeiro = -1;
+        }
+        
+        if (primeiro < 0 || ultimo < primeiro || ultimo >= dsm_global->num_blocos || processo < 0 || processo >= num_processos) {
+            log_erro("    • ", "[P%d] Linha %d inválida no mapa de distribuição %s", id, num_linha, arquivo);
+            resultado = -1;
+            break;
+        }
+        for (int i = primeiro; i <= ultimo; i++) {
+            if (dsm_global->dono_do_bloco[i] != -1) {
+                log_erro("    • ", "[P%d] Bloco %d com mais de um dono no mapa %s (linha %d)", id, i, arquivo, num_linha);
+                resultado = -1;
+                break;
+            }
+            dsm_global->dono_do_bloco[i] = processo;
         }
-        close(sock);
-        return -1;
     }
+    fclose(entrada);
     
-    // Enviar mensagem
-    ssize_t bytes_enviados = send(sock, msg, sizeof(Mensagem), 0);
-    if (bytes_enviados != sizeof(Mensagem)) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao enviar mensagem completa para processo %d", id, id_processo_destino);
-        close(sock);
-        return -1;
+    for (int i = 0; resultado == 0 && i < dsm_global->num_blocos; i++) {
+        if (dsm_global->dono_do_bloco[i] == -1) {
+            log_erro("    • ", "[P%d] Bloco %d sem dono no mapa %s", id, i, arquivo);
+            resultado = -1;
+        }
     }
-    
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Mensagem tipo %d enviada para processo %d (bloco %d)", 
-               id, msg->tipo, id_processo_destino, msg->id_bloco);
-    
-    close(sock);
-    return 0;
+    return resultado;
 }
 
-int receber_mensagem(int socket_cliente, Mensagem *msg) {
-    int id = (dsm_global != NULL) ? dsm_global->meu_id : -1;
-    ssize_t bytes_recebidos = recv(socket_cliente, msg, sizeof(Mensagem), MSG_WAITALL);
-    if (bytes_recebidos != sizeof(Mensagem)) {
-        if (bytes_recebidos == 0) {
-            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cliente desconectou", id);
-        } else {
-            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao receber mensagem: %s", id, strerror(errno));
-        }
-        return -1;
+// Preenche dono_do_bloco segundo ConfigDSM::distribuicao
+static int calcular_distribuicao(const ConfigDSM *config, int num_processos) {
+    switch (config->distribuicao) {
+        case DISTRIBUICAO_MODULO:
+            for (int i = 0; i < dsm_global->num_blocos; i++) {
+                dsm_global->dono_do_bloco[i] = i % num_processos;
+            }
+            return 0;
+        
+        case DISTRIBUICAO_FAIXAS:
+            // As primeiras K % N faixas têm um bloco a mais
+            for (int i = 0; i < dsm_global->num_blocos; i++) {
+                dsm_global->dono_do_bloco[i] = (int)((long)i * num_processos / dsm_global->num_blocos);
+            }
+            return 0;
+        
+        case DISTRIBUICAO_HASH:
+            return distribuir_por_hash(num_processos);
+        
+        case DISTRIBUICAO_MAPA:
+            return carregar_mapa_distribuicao(config->arquivo_distribuicao, num_processos);
     }
-    return 0;
+    
+    log_erro("    • ", "[P%d] Política de distribuição desconhecida: %d", dsm_global->meu_id, config->distribuicao);
+    return -1;
 }
 
-// =============================================================================
-// OPERAÇÕES COM BLOCOS REMOTOS
-// =============================================================================
-
-int requisitar_bloco_remoto(int id_bloco, byte *dados_recebidos) {
+// Aloca a arena dos blocos locais com mmap (zerada e alinhada a página),
+// aplicando as opções MEMORIA_* pedidas. Opções não suportadas pelo sistema
+// geram aviso, mas não impedem a inicialização.
+static int alocar_arena_local(size_t tamanho, int opcoes) {
     int id = dsm_global->meu_id;
-    int dono = calcular_dono_bloco(id_bloco);
-    if (dono == dsm_global->meu_id) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: tentativa de requisitar bloco próprio %d", id, id_bloco);
-        return -1;
-    }
+    byte *arena = MAP_FAILED;
     
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Requisitando bloco %d do processo %d", id, id_bloco, dono);
-    
-    InfoProcesso *destino = &dsm_global->processos[dono];
-    
-    // Criar socket cliente
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao criar socket para requisição: %s", id, strerror(errno));
-        return -1;
+    if (tamanho == 0) {
+        tamanho = dsm_global->tamanho_bloco;
     }
     
-    // Configurar endereço do destino
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(destino->porta);
-    inet_pton(AF_INET, destino->ip, &addr.sin_addr);
+    if (opcoes & MEMORIA_HUGETLB) {
+        size_t tamanho_enorme = (tamanho + TAMANHO_PAGINA_ENORME - 1) / TAMANHO_PAGINA_ENORME * TAMANHO_PAGINA_ENORME;
+        arena = mmap(NULL, tamanho_enorme, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED) {
+            tamanho = tamanho_enorme;
+            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Arena local em páginas enormes (MAP_HUGETLB)", id);
+        } else {
+            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] MAP_HUGETLB indisponível (%s), usando páginas normais", id, strerror(errno));
+        }
+    }
     
-    // Conectar
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Falha ao conectar com processo %d: %s", id, dono, strerror(errno));
-        close(sock);
-        return -1;
+    if (arena == MAP_FAILED) {
+        arena = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED) {
+            log_erro("    • ", "[P%d] Erro ao mapear arena local: %s", id, strerror(errno));
+            return -1;
+        }
+#ifdef MADV_HUGEPAGE
+        if ((opcoes & (MEMORIA_THP | MEMORIA_HUGETLB)) && madvise(arena, tamanho, MADV_HUGEPAGE) != 0) {
+            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Transparent huge pages indisponíveis: %s", id, strerror(errno));
+        }
+#endif
     }
     
-    // Preparar e enviar mensagem de requisição
-    Mensagem msg;
-    memset(&msg, 0, sizeof(msg));
-    msg.tipo = MSG_REQUISICAO_BLOCO;
-    msg.id_bloco = id_bloco;
+    dsm_global->minha_memoria_local = arena;
+    dsm_global->tamanho_arena = tamanho;
     
-    if (send(sock, &msg, sizeof(msg), 0) != sizeof(msg)) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao enviar requisição do bloco %d", id, id_bloco);
-        close(sock);
-        return -1;
+    if (opcoes & MEMORIA_NUMA_LOCAL) {
+#ifdef SYS_mbind
+        if (syscall(SYS_mbind, arena, tamanho, MPOL_LOCAL, NULL, 0UL, 0U) != 0) {
+            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] mbind(MPOL_LOCAL) falhou: %s", id, strerror(errno));
+        }
+#endif
+        // Tocar cada página agora, a partir desta thread, para que sejam
+        // alocadas no nó local e o primeiro acesso não pague a falta de página
+        long tamanho_pagina = sysconf(_SC_PAGESIZE);
+        for (size_t i = 0; i < tamanho; i += (size_t)tamanho_pagina) {
+            arena[i] = 0;
+        }
     }
     
-    // Receber resposta
-    Mensagem resposta;
-    if (recv(sock, &resposta, sizeof(resposta), MSG_WAITALL) != sizeof(resposta)) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao receber resposta do bloco %d", id, id_bloco);
-        close(sock);
-        return -1;
+    if ((opcoes & MEMORIA_MLOCK) && mlock(arena, tamanho) != 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] mlock da arena local falhou: %s", id, strerror(errno));
     }
     
-    close(sock);
+    return 0;
+}
+
+void dsm_config_padrao(ConfigDSM *config) {
+    memset(config, 0, sizeof(ConfigDSM));
+    config->num_blocos = K_NUM_BLOCOS;
+    config->tamanho_bloco = T_TAMANHO_BLOCO;
+    config->num_threads_servidor = THREADS_SERVIDOR_PADRAO;
+    config->backlog_listen = BACKLOG_LISTEN_PADRAO;
+    config->opcoes_memoria = OPCOES_MEMORIA_PADRAO;
+    config->profundidade_prefetch = PROFUNDIDADE_PREFETCH_PADRAO;
+    config->memoria_cache = MEMORIA_CACHE_PADRAO;
+    config->politica_cache = POLITICA_CACHE_PADRAO;
+    config->timeout_ack_ms = TIMEOUT_ACK_PADRAO_MS;
+    config->modo_consistencia = MODO_CONSISTENCIA_PADRAO;
+    config->protocolo = PROTOCOLO_PADRAO;
+    config->compressao = COMPRESSAO_PADRAO;
+    config->intervalo_migracao_ms = INTERVALO_MIGRACAO_PADRAO_MS;
+    config->limiar_migracao = LIMIAR_MIGRACAO_PADRAO;
+    config->distribuicao = DISTRIBUICAO_PADRAO;
+    config->nivel_log = NIVEL_LOG_PADRAO;
+}
+
+// Lê um número com sufixo opcional K, M ou G (potências de 1024), como em
+// "tamanho_bloco = 64K". Retorna -1 se sobrar texto ou o valor passar de INT_MAX.
+static int ler_tamanho(const char *valor, long long *resultado) {
+    char *fim;
+    errno = 0;
+    long long numero = strtoll(valor, &fim, 10);
+    if (fim == valor || errno != 0 || numero < 0) return -1;
     
-    // Verificar se a resposta é válida
-    if (resposta.tipo != MSG_RESPOSTA_BLOCO || resposta.id_bloco != id_bloco) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Resposta inválida para bloco %d", id, id_bloco);
-        return -1;
+    switch (toupper((unsigned char)*fim)) {
+        case 'K': numero *= 1024LL; fim++; break;
+        case 'M': numero *= 1024LL * 1024; fim++; break;
+        case 'G': numero *= 1024LL * 1024 * 1024; fim++; break;
+        default: break;
     }
+    if (toupper((unsigned char)*fim) == 'B') fim++;
+    if (*fim != '\0' || numero > INT_MAX) return -1;
     
-    // Copiar dados recebidos
-    memcpy(dados_recebidos, resposta.dados, T_TAMANHO_BLOCO);
-    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d recebido com sucesso do processo %d", id, id_bloco, dono);
-    
+    *resultado = numero;
     return 0;
 }
 
-int invalidar_caches_remotos(int id_bloco) {
-    int id = dsm_global->meu_id;
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidando caches remotos para bloco %d", id, id_bloco);
-    
-    Mensagem msg;
-    memset(&msg, 0, sizeof(msg));
-    msg.tipo = MSG_INVALIDAR_BLOCO;
-    msg.id_bloco = id_bloco;
+// Lê opcoes_memoria: um número ou nomes separados por '|' ou ','
+// (hugetlb, thp, mlock, numa)
+static int ler_opcoes_memoria(char *valor, int *opcoes) {
+    long long numero;
+    if (ler_tamanho(valor, &numero) == 0) {
+        *opcoes = (int)numero;
+        return 0;
+    }
     
-    int sucesso = 0;
-    int tentativas = 0;
-    for (int i = 0; i < dsm_global->num_processos; i++) {
-        if (i == dsm_global->meu_id) continue;
+    int resultado = 0;
+    char *contexto;
+    for (char *nome = strtok_r(valor, "|,", &contexto); nome; nome = strtok_r(NULL, "|,", &contexto)) {
+        while (isspace((unsigned char)*nome)) nome++;
+        size_t n = strlen(nome);
+        while (n > 0 && isspace((unsigned char)nome[n - 1])) nome[--n] = '\0';
         
-        tentativas++;
-        if (enviar_mensagem(i, &msg) == 0) {
-            sucesso++;
-            invalidacoes_enviadas++;
-        }
+        if (strcmp(nome, "hugetlb") == 0) resultado |= MEMORIA_HUGETLB;
+        else if (strcmp(nome, "thp") == 0) resultado |= MEMORIA_THP;
+        else if (strcmp(nome, "mlock") == 0) resultado |= MEMORIA_MLOCK;
+        else if (strcmp(nome, "numa") == 0) resultado |= MEMORIA_NUMA_LOCAL;
+        else if (strcmp(nome, "nenhuma") != 0) return -1;
     }
+    *opcoes = resultado;
+    return 0;
+}
+
+// Aplica uma linha "chave = valor" do arquivo de configuração
+static int aplicar_opcao_config(const char *chave, char *valor, ConfigDSM *config) {
+    long long numero = 0;
+    int numerico = ler_tamanho(valor, &numero) == 0;
     
-    if (sucesso > 0) {
-        log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Invalidações enviadas para %d de %d processos", id, sucesso, tentativas);
+    if (strcmp(chave, "num_blocos") == 0 && numerico) {
+        config->num_blocos = (int)numero;
+    } else if (strcmp(chave, "tamanho_bloco") == 0 && numerico) {
+        config->tamanho_bloco = (int)numero;
+    } else if (strcmp(chave, "num_threads_servidor") == 0 && numerico) {
+        config->num_threads_servidor = (int)numero;
+    } else if (strcmp(chave, "backlog_listen") == 0 && numerico) {
+        config->backlog_listen = (int)numero;
+    } else if (strcmp(chave, "opcoes_memoria") == 0) {
+        return ler_opcoes_memoria(valor, &config->opcoes_memoria);
+    } else if (strcmp(chave, "profundidade_prefetch") == 0 && numerico) {
+        config->profundidade_prefetch = (int)numero;
+    } else if (strcmp(chave, "memoria_cache") == 0 && numerico) {
+        config->memoria_cache = (size_t)numero;
+    } else if (strcmp(chave, "politica_cache") == 0) {
+        if (strcmp(valor, "lru") == 0) config->politica_cache = POLITICA_LRU;
+        else if (strcmp(valor, "clock") == 0) config->politica_cache = POLITICA_CLOCK;
+        else return -1;
+    } else if (strcmp(chave, "timeout_ack_ms") == 0 && numerico) {
+        config->timeout_ack_ms = (int)numero;
+    } else if (strcmp(chave, "modo_consistencia") == 0) {
+        if (strcmp(valor, "estrita") == 0) config->modo_consistencia = CONSISTENCIA_ESTRITA;
+        else if (strcmp(valor, "release") == 0) config->modo_consistencia = CONSISTENCIA_RELEASE;
+        else return -1;
+    } else if (strcmp(chave, "protocolo") == 0) {
+        if (strcmp(valor, "invalidacao") == 0) config->protocolo = PROTOCOLO_INVALIDACAO;
+        else if (strcmp(valor, "atualizacao") == 0) config->protocolo = PROTOCOLO_ATUALIZACAO;
+        else if (strcmp(valor, "adaptativo") == 0) config->protocolo = PROTOCOLO_ADAPTATIVO;
+        else return -1;
+    } else if (strcmp(chave, "compressao") == 0 && numerico) {
+        config->compressao = numero != 0;
+    } else if (strcmp(chave, "intervalo_migracao_ms") == 0 && numerico) {
+        config->intervalo_migracao_ms = (int)numero;
+    } else if (strcmp(chave, "limiar_migracao") == 0 && numerico) {
+        config->limiar_migracao = (int)numero;
+    } else if (strcmp(chave, "distribuicao") == 0) {
+        if (strcmp(valor, "modulo") == 0) config->distribuicao = DISTRIBUICAO_MODULO;
+        else if (strcmp(valor, "faixas") == 0) config->distribuicao = DISTRIBUICAO_FAIXAS;
+        else if (strcmp(valor, "hash") == 0) config->distribuicao = DISTRIBUICAO_HASH;
+        else if (strcmp(valor, "mapa") == 0) config->distribuicao = DISTRIBUICAO_MAPA;
+        else return -1;
+    } else if (strcmp(chave, "nivel_log") == 0) {
+        if (strcmp(valor, "debug") == 0) config->nivel_log = NIVEL_LOG_DEBUG;
+        else if (strcmp(valor, "info") == 0) config->nivel_log = NIVEL_LOG_INFO;
+        else if (strcmp(valor, "erro") == 0) config->nivel_log = NIVEL_LOG_ERRO;
+        else if (strcmp(valor, "nenhum") == 0) config->nivel_log = NIVEL_LOG_NENHUM;
+        else return -1;
+    } else if (strcmp(chave, "log_assincrono") == 0 && numerico) {
+        config->log_assincrono = numero != 0;
+    } else if (strcmp(chave, "arquivo_distribuicao") == 0) {
+        if (strlen(valor) >= sizeof(config->arquivo_distribuicao)) return -1;
+        strcpy(config->arquivo_distribuicao, valor);
     } else {
-        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Nenhum processo disponível para invalidação (todos podem ter finalizado)", id);
+        return -1;
     }
-    return sucesso;
+    return 0;
 }
 
-// =============================================================================
-// THREAD SERVIDORA
-// =============================================================================
-
-void* thread_servidora(void* arg) {
-    (void)arg; // Suprimir warning de parâmetro não utilizado
-    int id = dsm_global->meu_id;
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Thread servidora iniciada", id);
-    
-    // Configurar thread para ser cancelável
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
+// Lê um arquivo de configuração com linhas "chave = valor", em que as chaves
+// são os nomes dos campos de ConfigDSM. Linhas vazias e o que vem depois de
+// '#' são ignorados. Só as chaves presentes são alteradas: o chamador
+// preenche os padrões antes (dsm_config_padrao). Retorna -1 ao primeiro erro.
+int dsm_carregar_config(const char *arquivo, ConfigDSM *config) {
+    FILE *entrada = fopen(arquivo, "r");
+    if (!entrada) {
+        log_erro("    • ", "[P?] Erro ao abrir configuração %s: %s", arquivo, strerror(errno));
+        return -1;
+    }
     
-    while (dsm_global->servidor_rodando) {
-        struct sockaddr_in addr_cliente;
-        socklen_t len_addr = sizeof(addr_cliente);
+    char linha[512];
+    int num_linha = 0;
+    int resultado = 0;
+    while (resultado == 0 && fgets(linha, sizeof(linha), entrada)) {
+        num_linha++;
+        char *comentario = strchr(linha, '#');
+        if (comentario) *comentario = '\0';
         
-        // Aceitar conexão
-        int socket_cliente = accept(dsm_global->socket_servidor, 
-                                  (struct sockaddr*)&addr_cliente, &len_addr);
+        char chave[64];
+        char valor[TAMANHO_MAX_CAMINHO];
+        int campos = sscanf(linha, " %63[^= \t] = %255[^\r\n]", chave, valor);
+        if (campos <= 0) continue;  // Linha vazia
         
-        if (socket_cliente == -1) {
-            if (dsm_global->servidor_rodando) {
-                log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao aceitar conexão: %s", id, strerror(errno));
-            }
-            continue;
+        if (campos == 2) {
+            size_t n = strlen(valor);
+            while (n > 0 && isspace((unsigned char)valor[n - 1])) valor[--n] = '\0';
         }
-        
-        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Nova conexão aceita", id);
-        
-        // Receber mensagem
-        Mensagem msg;
-        if (receber_mensagem(socket_cliente, &msg) == 0) {
-            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Mensagem recebida: tipo=%d, bloco=%d", id, msg.tipo, msg.id_bloco);
-            
-            switch (msg.tipo) {
-                case MSG_REQUISICAO_BLOCO: {
-                    // Verificar se tenho o bloco
-                    if (e_meu_bloco(msg.id_bloco)) {
-                        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Enviando bloco %d para cliente", id, msg.id_bloco);
-                        
-                        // Preparar resposta com os dados do bloco
-                        Mensagem resposta;
-                        memset(&resposta, 0, sizeof(resposta));
-                        resposta.tipo = MSG_RESPOSTA_BLOCO;
-                        resposta.id_bloco = msg.id_bloco;
-                        resposta.tamanho_dados = T_TAMANHO_BLOCO;
-                        
-                        // Encontrar o bloco na memória local
-                        int idx_local = -1;
-                        for (int i = 0; i < dsm_global->num_blocos_locais; i++) {
-                            if (dsm_global->meus_blocos[i] == msg.id_bloco) {
-                                idx_local = i;
-                                break;
-                            }
-                        }
-                        
-                        if (idx_local >= 0) {
-                            memcpy(resposta.dados, dsm_global->minha_memoria_local[idx_local], 
-                                   T_TAMANHO_BLOCO);
-                            
-                            // Enviar resposta
-                            send(socket_cliente, &resposta, sizeof(resposta), 0);
-                            log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d enviado com sucesso", id, msg.id_bloco);
-                        } else {
-                            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: bloco %d não encontrado na memória local", id, msg.id_bloco);
-                        }
-                    } else {
-                        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: requisição para bloco %d que não me pertence", id, msg.id_bloco);
-                    }
-                    break;
-                }
-                
-                case MSG_INVALIDAR_BLOCO: {
-                    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Invalidando bloco %d no cache local", id, msg.id_bloco);
-                    
-                    pthread_mutex_lock(&dsm_global->meu_cache[msg.id_bloco].mutex);
-                    dsm_global->meu_cache[msg.id_bloco].valido = 0;
-                    pthread_mutex_unlock(&dsm_global->meu_cache[msg.id_bloco].mutex);
-                    
-                    invalidacoes_recebidas++;
-                    
-                    // Enviar ACK
-                    Mensagem ack;
-                    memset(&ack, 0, sizeof(ack));
-                    ack.tipo = MSG_ACK_INVALIDACAO;
-                    ack.id_bloco = msg.id_bloco;
-                    send(socket_cliente, &ack, sizeof(ack), 0);
-                    
-                    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d invalidado e ACK enviado", id, msg.id_bloco);
-                    break;
-                }
-                
-                default:
-                    log_padronizado(COLOR_ERROR, "    • ", "[P%d] Tipo de mensagem desconhecido: %d", id, msg.tipo);
-                    break;
-            }
+        if (campos != 2 || aplicar_opcao_config(chave, valor, config) != 0) {
+            log_erro("    • ", "[P?] %s:%d: opção inválida '%s'", arquivo, num_linha, chave);
+            resultado = -1;
         }
-        
-        close(socket_cliente);
     }
     
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Thread servidora finalizada", id);
-    return NULL;
+    fclose(entrada);
+    return resultado;
 }
 
-// =============================================================================
-// INICIALIZAÇÃO E LIMPEZA
-// =============================================================================
+// Confere a geometria pedida antes de qualquer alocação: o bitmap do
+// diretório limita os processos a MAX_PROCESSOS e as posições globais são
+// int, então a memória compartilhada inteira precisa caber em INT_MAX bytes.
+static int validar_geometria(int meu_id, int num_processos, const ConfigDSM *config) {
+    if (num_processos < 1 || num_processos > MAX_PROCESSOS) {
+        log_erro("    • ", "[P%d] Número de processos deve estar entre 1 e %d (recebido %d)",
+                       meu_id, MAX_PROCESSOS, num_processos);
+        return -1;
+    }
+    if (meu_id < 0 || meu_id >= num_processos) {
+        log_erro("    • ", "[P%d] ID de processo deve estar entre 0 e %d", meu_id, num_processos - 1);
+        return -1;
+    }
+    if (config->num_blocos < 1 || config->tamanho_bloco < TAMANHO_MIN_BLOCO) {
+        log_erro("    • ", "[P%d] Geometria inválida: %d blocos de %d bytes (mínimo: 1 bloco de %d bytes)",
+                       meu_id, config->num_blocos, config->tamanho_bloco, TAMANHO_MIN_BLOCO);
+        return -1;
+    }
+    if ((long long)config->num_blocos * config->tamanho_bloco > INT_MAX) {
+        log_erro("    • ", "[P%d] Memória compartilhada de %d blocos de %d bytes passa de %d bytes",
+                       meu_id, config->num_blocos, config->tamanho_bloco, INT_MAX);
+        return -1;
+    }
+    return 0;
+}
 
 int dsm_init(int meu_id, InfoProcesso processos[], int num_processos) {
+    ConfigDSM config;
+    dsm_config_padrao(&config);
+    return dsm_init_config(meu_id, processos, num_processos, &config);
+}
+
+int dsm_init_config(int meu_id, InfoProcesso processos[], int num_processos, const ConfigDSM *config) {
     if (dsm_global != NULL) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Sistema DSM já inicializado", meu_id);
+        log_erro("    • ", "[P%d] Sistema DSM já inicializado", meu_id);
         return -1;
     }
     
+    if (validar_geometria(meu_id, num_processos, config) != 0) {
+        return -1;
+    }
+    dsm_definir_nivel_log(config->nivel_log);
+    
     // Alocar estrutura principal
     dsm_global = (SistemaDSM*)malloc(sizeof(SistemaDSM));
     if (!dsm_global) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao alocar memória para sistema DSM", meu_id);
+        log_erro("    • ", "[P%d] Erro ao alocar memória para sistema DSM", meu_id);
         return -1;
     }
     
     memset(dsm_global, 0, sizeof(SistemaDSM));
     dsm_global->meu_id = meu_id;
     dsm_global->num_processos = num_processos;
+    // Um processo que reinicia recomeça as sequências: a instância é outra
+    uint64_t semente = agora_ns() ^ ((uint64_t)getpid() << 32);
+    dsm_global->instancia = (uint32_t)(semente ^ (semente >> 32));
+    if (!dsm_global->instancia) dsm_global->instancia = 1;
+    dsm_global->num_blocos = config->num_blocos;
+    dsm_global->tamanho_bloco = config->tamanho_bloco;
+    dsm_global->tamanho_memoria = config->num_blocos * config->tamanho_bloco;
     dsm_global->servidor_rodando = 1;
+    dsm_global->config = *config;
+    dsm_global->epoll_fd = -1;
+    dsm_global->evento_parada = -1;
+    
+    // Estruturas dimensionadas pela geometria
+    dsm_global->processos = (InfoProcesso*)malloc(num_processos * sizeof(InfoProcesso));
+    dsm_global->conexoes = (ConexaoPar*)calloc(num_processos, sizeof(ConexaoPar));
+    dsm_global->escritas_confirmadas = (EscritaConfirmada*)calloc(num_processos, sizeof(EscritaConfirmada));
+    dsm_global->dono_do_bloco = (int*)malloc(config->num_blocos * sizeof(int));
+    dsm_global->indice_local = (int*)malloc(config->num_blocos * sizeof(int));
+    if (!dsm_global->processos || !dsm_global->conexoes || !dsm_global->escritas_confirmadas ||
+        !dsm_global->dono_do_bloco || !dsm_global->indice_local) {
+        log_erro("    • ", "[P%d] Erro ao alocar memória para sistema DSM", meu_id);
+        free(dsm_global->processos);
+        free(dsm_global->conexoes);
+        free(dsm_global->escritas_confirmadas);
+        free(dsm_global->dono_do_bloco);
+        free(dsm_global->indice_local);
+        free(dsm_global);
+        dsm_global = NULL;
+        return -1;
+    }
+    
+    // A partir daqui, dsm_cleanup esvazia e para o log assíncrono
+    if (config->log_assincrono && dsm_iniciar_log_assincrono() != 0) {
+        dsm_global->config.log_assincrono = 0;
+    }
+    
+    // Inicializar pool de conexões, registro de conexões aceitas e fila de trabalho
+    for (int i = 0; i < num_processos; i++) {
+        dsm_global->conexoes[i].socket = -1;
+        dsm_global->conexoes[i].geracao = 0;
+        pthread_mutex_init(&dsm_global->conexoes[i].mutex, NULL);
+        dsm_global->escritas_confirmadas[i].posicao = -1;
+        dsm_global->escritas_confirmadas[i].socket = -1;
+        pthread_mutex_init(&dsm_global->escritas_confirmadas[i].mutex, NULL);
+    }
+    for (int i = 0; i < MAX_CONEXOES_ACEITAS; i++) {
+        dsm_global->sockets_aceitos[i] = -1;
+    }
+    pthread_mutex_init(&dsm_global->mutex_conexoes, NULL);
+    pthread_mutex_init(&dsm_global->mutex_fila, NULL);
+    pthread_cond_init(&dsm_global->cond_fila, NULL);
     
     // Copiar informações dos processos
     for (int i = 0; i < num_processos; i++) {
         dsm_global->processos[i] = processos[i];
     }
     
+    for (int i = 0; i < NUM_TRAVAS_POSSE; i++) {
+        pthread_mutex_init(&dsm_global->travas_posse[i], NULL);
+    }
+    pthread_mutex_init(&dsm_global->mutex_arena, NULL);
+    
     // Inicializar mapeamento de donos dos blocos
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
-        dsm_global->dono_do_bloco[i] = calcular_dono_bloco(i);
+    if (calcular_distribuicao(config, num_processos) != 0) {
+        log_erro("    • ", "[P%d] Erro ao calcular a distribuição dos blocos", meu_id);
+        dsm_cleanup();
+        return -1;
     }
     
     // Calcular quantos blocos este processo possui
     dsm_global->num_blocos_locais = 0;
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
+    for (int i = 0; i < dsm_global->num_blocos; i++) {
         if (e_meu_bloco(i)) {
             dsm_global->num_blocos_locais++;
         }
     }
     
-    // Alocar memória local
-    dsm_global->minha_memoria_local = (byte**)malloc(dsm_global->num_blocos_locais * sizeof(byte*));
-    dsm_global->meus_blocos = (int*)malloc(dsm_global->num_blocos_locais * sizeof(int));
+    // A arena reserva folga para blocos recebidos por migração, calculada
+    // sobre a parte média de cada processo para que mesmo quem começa com
+    // poucos blocos (mapa explícito) possa recebê-los
+    dsm_global->capacidade_arena = dsm_global->num_blocos_locais;
+    if (config->intervalo_migracao_ms > 0) {
+        int parte_media = (dsm_global->num_blocos + num_processos - 1) / num_processos;
+        dsm_global->capacidade_arena = (dsm_global->num_blocos_locais > parte_media ?
+                                        dsm_global->num_blocos_locais : parte_media) * FATOR_FOLGA_ARENA;
+        if (dsm_global->capacidade_arena > dsm_global->num_blocos) {
+            dsm_global->capacidade_arena = dsm_global->num_blocos;
+        }
+    }
     
-    if (!dsm_global->minha_memoria_local || !dsm_global->meus_blocos) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao alocar memória local", meu_id);
+    // Alocar memória local: todos os blocos próprios em uma única arena
+    int capacidade = dsm_global->capacidade_arena > 0 ? dsm_global->capacidade_arena : 1;
+    dsm_global->meus_blocos = (int*)malloc(capacidade * sizeof(int));
+    dsm_global->indices_livres = (int*)malloc(capacidade * sizeof(int));
+    dsm_global->compartilhadores = (uint64_t*)calloc(capacidade, sizeof(uint64_t));
+    dsm_global->copias_em_invalidacao = (uint64_t*)calloc(capacidade, sizeof(uint64_t));
+    dsm_global->invalidacoes_assumidas = (uint32_t*)calloc((size_t)capacidade * num_processos, sizeof(uint32_t));
+    dsm_global->seqlock_blocos = (uint32_t*)calloc(capacidade, sizeof(uint32_t));
+    dsm_global->acessos_bloco = (uint32_t*)calloc((size_t)capacidade * num_processos, sizeof(uint32_t));
+    dsm_global->versoes_dono = (uint64_t*)malloc(dsm_global->num_blocos * sizeof(uint64_t));
+    dsm_global->historico_escritas = (TrechoEscrito*)calloc((size_t)capacidade * PROFUNDIDADE_DELTAS, sizeof(TrechoEscrito));
+    dsm_global->versoes_no_historico = (int*)calloc(capacidade, sizeof(int));
+    dsm_global->protocolo_bloco = (byte*)malloc(dsm_global->num_blocos);
+    dsm_global->adaptacao = (AdaptacaoBloco*)calloc(capacidade, sizeof(AdaptacaoBloco));
+    dsm_global->bloco_sujo = (byte*)calloc(dsm_global->num_blocos, sizeof(byte));
+    dsm_global->blocos_sujos = (int*)malloc(dsm_global->num_blocos * sizeof(int));
+    pthread_mutex_init(&dsm_global->mutex_sujos, NULL);
+    
+    if (!dsm_global->meus_blocos || !dsm_global->indices_livres || !dsm_global->compartilhadores || !dsm_global->seqlock_blocos ||
+        !dsm_global->copias_em_invalidacao || !dsm_global->invalidacoes_assumidas ||
+        !dsm_global->acessos_bloco || !dsm_global->versoes_dono || !dsm_global->historico_escritas || !dsm_global->versoes_no_historico ||
+        !dsm_global->protocolo_bloco || !dsm_global->adaptacao || !dsm_global->bloco_sujo || !dsm_global->blocos_sujos ||
+        alocar_arena_local((size_t)dsm_global->capacidade_arena * dsm_global->tamanho_bloco, config->opcoes_memoria) != 0) {
+        log_erro("    • ", "[P%d] Erro ao alocar memória local", meu_id);
         dsm_cleanup();
         return -1;
     }
     
-    // Alocar e inicializar blocos locais
+    // Todos os blocos começam com o protocolo da configuração
+    ProtocoloCoerencia protocolo = config->protocolo;
+    if (protocolo != PROTOCOLO_INVALIDACAO && protocolo != PROTOCOLO_ATUALIZACAO && protocolo != PROTOCOLO_ADAPTATIVO) {
+        protocolo = PROTOCOLO_PADRAO;
+    }
+    memset(dsm_global->protocolo_bloco, protocolo, dsm_global->num_blocos);
+    
+    // Registrar os blocos locais na ordem em que ocupam a arena; o restante
+    // da arena fica na pilha de índices livres
     int idx_local = 0;
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
+    for (int i = 0; i < dsm_global->num_blocos; i++) {
+        dsm_global->indice_local[i] = -1;
+        dsm_global->versoes_dono[i] = 1;
         if (e_meu_bloco(i)) {
-            dsm_global->minha_memoria_local[idx_local] = (byte*)calloc(T_TAMANHO_BLOCO, sizeof(byte));
-            if (!dsm_global->minha_memoria_local[idx_local]) {
-                log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao alocar bloco local %d", meu_id, i);
-                dsm_cleanup();
-                return -1;
-            }
             dsm_global->meus_blocos[idx_local] = i;
+            dsm_global->indice_local[i] = idx_local;
             idx_local++;
         }
     }
+    dsm_global->num_indices_livres = 0;
+    for (int i = dsm_global->capacidade_arena - 1; i >= idx_local; i--) {
+        dsm_global->meus_blocos[i] = -1;
+        dsm_global->indices_livres[dsm_global->num_indices_livres++] = i;
+    }
     
-    // Inicializar cache
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
-        dsm_global->meu_cache[i].id_bloco = i;
-        dsm_global->meu_cache[i].valido = 0;
-        pthread_mutex_init(&dsm_global->meu_cache[i].mutex, NULL);
+    // Inicializar cache de blocos remotos
+    pthread_mutex_init(&dsm_global->mutex_cache, NULL);
+    if (alocar_cache(config->memoria_cache) != 0) {
+        log_erro("    • ", "[P%d] Erro ao alocar cache de blocos remotos", meu_id);
+        dsm_cleanup();
+        return -1;
+    }
+    dsm_global->slots_modificados = (BlocoCache**)malloc(dsm_global->capacidade_cache * sizeof(BlocoCache*));
+    if (!dsm_global->slots_modificados) {
+        log_erro("    • ", "[P%d] Erro ao alocar cache de blocos remotos", meu_id);
+        dsm_cleanup();
+        return -1;
     }
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache de blocos remotos: %d slots (%s)", meu_id, dsm_global->capacidade_cache,
+                   config->politica_cache == POLITICA_CLOCK ? "CLOCK" : "LRU");
     
-    // Inicializar mutex global
-    pthread_mutex_init(&dsm_global->mutex_global, NULL);
+    // Inicializar detector e fila de prefetch
+    for (int i = 0; i < NUM_FLUXOS_PREFETCH; i++) {
+        dsm_global->fluxos_prefetch[i].ultimo_bloco = -1;
+    }
+    pthread_mutex_init(&dsm_global->mutex_prefetch, NULL);
+    pthread_cond_init(&dsm_global->cond_prefetch, NULL);
+    pthread_mutex_init(&dsm_global->mutex_migracao, NULL);
+    pthread_cond_init(&dsm_global->cond_migracao, NULL);
     
     // Criar socket servidor
     dsm_global->socket_servidor = socket(AF_INET, SOCK_STREAM, 0);
     if (dsm_global->socket_servidor == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao criar socket servidor: %s", meu_id, strerror(errno));
+        log_erro("    • ", "[P%d] Erro ao criar socket servidor: %s", meu_id, strerror(errno));
         dsm_cleanup();
         return -1;
     }
@@ -452,25 +3780,100 @@ int dsm_init(int meu_id, InfoProcesso processos[], int num_processos) {
     
     // Bind
     if (bind(dsm_global->socket_servidor, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao fazer bind na porta %d: %s", meu_id, processos[meu_id].porta, strerror(errno));
+        log_erro("    • ", "[P%d] Erro ao fazer bind na porta %d: %s", meu_id, processos[meu_id].porta, strerror(errno));
         dsm_cleanup();
         return -1;
     }
     
     // Listen
-    if (listen(dsm_global->socket_servidor, 10) == -1) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao fazer listen: %s", meu_id, strerror(errno));
+    if (listen(dsm_global->socket_servidor, config->backlog_listen) == -1) {
+        log_erro("    • ", "[P%d] Erro ao fazer listen: %s", meu_id, strerror(errno));
+        dsm_cleanup();
+        return -1;
+    }
+    
+    // O loop de eventos aceita conexões até esvaziar a fila, sem bloquear
+    fcntl(dsm_global->socket_servidor, F_SETFL, fcntl(dsm_global->socket_servidor, F_GETFL) | O_NONBLOCK);
+    
+    // Criar epoll com o socket servidor e o evento de parada
+    dsm_global->epoll_fd = epoll_create1(0);
+    dsm_global->evento_parada = eventfd(0, 0);
+    if (dsm_global->epoll_fd == -1 || dsm_global->evento_parada == -1) {
+        log_erro("    • ", "[P%d] Erro ao criar epoll: %s", meu_id, strerror(errno));
+        dsm_cleanup();
+        return -1;
+    }
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = dsm_global->socket_servidor;
+    epoll_ctl(dsm_global->epoll_fd, EPOLL_CTL_ADD, dsm_global->socket_servidor, &ev);
+    ev.data.fd = dsm_global->evento_parada;
+    epoll_ctl(dsm_global->epoll_fd, EPOLL_CTL_ADD, dsm_global->evento_parada, &ev);
+    
+    // Criar pool de threads trabalhadoras
+    int num_threads = config->num_threads_servidor;
+    if (num_threads <= 0) {
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (num_threads <= 0) num_threads = 1;
+    }
+    dsm_global->threads_trabalhadoras = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    if (!dsm_global->threads_trabalhadoras) {
+        log_erro("    • ", "[P%d] Erro ao alocar threads trabalhadoras", meu_id);
         dsm_cleanup();
         return -1;
     }
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&dsm_global->threads_trabalhadoras[i], NULL, thread_trabalhadora, NULL) != 0) {
+            log_erro("    • ", "[P%d] Erro ao criar thread trabalhadora", meu_id);
+            dsm_cleanup();
+            return -1;
+        }
+        dsm_global->num_threads_trabalhadoras++;
+    }
     
     // Criar thread servidora
     if (pthread_create(&dsm_global->thread_servidor, NULL, thread_servidora, NULL) != 0) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro ao criar thread servidora", meu_id);
+        log_erro("    • ", "[P%d] Erro ao criar thread servidora", meu_id);
         dsm_cleanup();
         return -1;
     }
     
+    // Abrir conexões persistentes com os pares; os que ainda não estiverem no
+    // ar são conectados sob demanda na primeira mensagem
+    int conectados = 0;
+    for (int i = 0; i < num_processos; i++) {
+        if (i == meu_id) continue;
+        dsm_global->conexoes[i].socket = conectar_processo(i);
+        if (dsm_global->conexoes[i].socket != -1) {
+            conectados++;
+        }
+    }
+    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Conexões persistentes abertas com %d de %d processos", meu_id, conectados, num_processos - 1);
+    
+    // Criar thread de prefetch
+    if (config->profundidade_prefetch > 0) {
+        dsm_global->prefetch_rodando = 1;
+        if (pthread_create(&dsm_global->thread_prefetch, NULL, thread_prefetch, NULL) != 0) {
+            log_erro("    • ", "[P%d] Erro ao criar thread de prefetch", meu_id);
+            dsm_global->prefetch_rodando = 0;
+            dsm_cleanup();
+            return -1;
+        }
+    }
+    
+    // Criar thread do rebalanceador de blocos
+    if (config->intervalo_migracao_ms > 0) {
+        dsm_global->migracao_rodando = 1;
+        if (pthread_create(&dsm_global->thread_migracao, NULL, thread_migracao, NULL) != 0) {
+            log_erro("    • ", "[P%d] Erro ao criar thread de migração", meu_id);
+            dsm_global->migracao_rodando = 0;
+            dsm_cleanup();
+            return -1;
+        }
+    }
+    
     log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Sistema DSM inicializado com sucesso", meu_id);
     log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processo possui %d blocos", meu_id, dsm_global->num_blocos_locais);
     log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Servidor escutando na porta %d", meu_id, processos[meu_id].porta);
@@ -482,51 +3885,142 @@ int dsm_cleanup(void) {
     if (!dsm_global) return 0;
     
     int id = dsm_global->meu_id;
+    int log_assincrono = dsm_global->config.log_assincrono;
     log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Finalizando sistema DSM", id);
     
+    // Parar o rebalanceador antes de qualquer outra coisa: uma migração em
+    // andamento termina antes do join
+    if (dsm_global->migracao_rodando) {
+        pthread_mutex_lock(&dsm_global->mutex_migracao);
+        dsm_global->migracao_rodando = 0;
+        pthread_cond_signal(&dsm_global->cond_migracao);
+        pthread_mutex_unlock(&dsm_global->mutex_migracao);
+        pthread_join(dsm_global->thread_migracao, NULL);
+    }
+    pthread_mutex_destroy(&dsm_global->mutex_migracao);
+    pthread_cond_destroy(&dsm_global->cond_migracao);
+    
+    // Escritas ainda não liberadas não podem deixar cópias desatualizadas
+    if (dsm_global->num_blocos_sujos > 0 || dsm_global->num_slots_modificados > 0) {
+        dsm_flush();
+    }
+    
+    // Parar thread de prefetch (usa as conexões de saída, fechadas adiante)
+    if (dsm_global->prefetch_rodando) {
+        pthread_mutex_lock(&dsm_global->mutex_prefetch);
+        dsm_global->prefetch_rodando = 0;
+        pthread_cond_signal(&dsm_global->cond_prefetch);
+        pthread_mutex_unlock(&dsm_global->mutex_prefetch);
+        pthread_join(dsm_global->thread_prefetch, NULL);
+    }
+    pthread_mutex_destroy(&dsm_global->mutex_prefetch);
+    pthread_cond_destroy(&dsm_global->cond_prefetch);
+    
     // Parar servidor
     dsm_global->servidor_rodando = 0;
     
-    // Fechar socket servidor
+    // Acordar o loop de eventos e esperar thread servidora terminar
+    if (dsm_global->evento_parada != -1) {
+        uint64_t um = 1;
+        if (write(dsm_global->evento_parada, &um, sizeof(um)) != sizeof(um)) {
+            log_erro("    • ", "[P%d] Erro ao sinalizar parada do servidor", id);
+        }
+    }
+    if (dsm_global->thread_servidor != 0) {
+        pthread_join(dsm_global->thread_servidor, NULL);
+    }
+    
+    // Acordar e esperar as threads trabalhadoras
+    pthread_mutex_lock(&dsm_global->mutex_fila);
+    pthread_cond_broadcast(&dsm_global->cond_fila);
+    pthread_mutex_unlock(&dsm_global->mutex_fila);
+    for (int i = 0; i < dsm_global->num_threads_trabalhadoras; i++) {
+        pthread_join(dsm_global->threads_trabalhadoras[i], NULL);
+    }
+    free(dsm_global->threads_trabalhadoras);
+    pthread_mutex_destroy(&dsm_global->mutex_fila);
+    pthread_cond_destroy(&dsm_global->cond_fila);
+    
+    // Fechar conexões aceitas, epoll e socket servidor
+    for (int i = 0; i < MAX_CONEXOES_ACEITAS; i++) {
+        if (dsm_global->sockets_aceitos[i] != -1) {
+            close(dsm_global->sockets_aceitos[i]);
+        }
+    }
+    pthread_mutex_destroy(&dsm_global->mutex_conexoes);
+    if (dsm_global->epoll_fd != -1) {
+        close(dsm_global->epoll_fd);
+    }
+    if (dsm_global->evento_parada != -1) {
+        close(dsm_global->evento_parada);
+    }
     if (dsm_global->socket_servidor != 0) {
         close(dsm_global->socket_servidor);
     }
     
-    // Esperar thread servidora terminar
-    if (dsm_global->thread_servidor != 0) {
-        // Tentar cancelar a thread se ela estiver bloqueada em accept()
-        pthread_cancel(dsm_global->thread_servidor);
-        pthread_join(dsm_global->thread_servidor, NULL);
+    // Fechar pool de conexões de saída
+    for (int i = 0; i < dsm_global->num_processos; i++) {
+        if (dsm_global->conexoes[i].socket != -1) {
+            close(dsm_global->conexoes[i].socket);
+        }
+        pthread_mutex_destroy(&dsm_global->conexoes[i].mutex);
+        pthread_mutex_destroy(&dsm_global->escritas_confirmadas[i].mutex);
     }
     
     // Liberar memória local
     if (dsm_global->minha_memoria_local) {
-        for (int i = 0; i < dsm_global->num_blocos_locais; i++) {
-            if (dsm_global->minha_memoria_local[i]) {
-                free(dsm_global->minha_memoria_local[i]);
-            }
-        }
-        free(dsm_global->minha_memoria_local);
+        munmap(dsm_global->minha_memoria_local, dsm_global->tamanho_arena);
     }
     
     // Liberar array de blocos
     if (dsm_global->meus_blocos) {
         free(dsm_global->meus_blocos);
     }
-    
-    // Destruir mutexes do cache
-    for (int i = 0; i < K_NUM_BLOCOS; i++) {
-        pthread_mutex_destroy(&dsm_global->meu_cache[i].mutex);
+    free(dsm_global->indices_livres);
+    pthread_mutex_destroy(&dsm_global->mutex_arena);
+    for (int i = 0; i < NUM_TRAVAS_POSSE; i++) {
+        pthread_mutex_destroy(&dsm_global->travas_posse[i]);
     }
+    free(dsm_global->compartilhadores);
+    free(dsm_global->copias_em_invalidacao);
+    free(dsm_global->invalidacoes_assumidas);
+    free(dsm_global->seqlock_blocos);
+    free(dsm_global->versoes_dono);
+    free(dsm_global->historico_escritas);
+    free(dsm_global->versoes_no_historico);
+    free(dsm_global->protocolo_bloco);
+    free(dsm_global->adaptacao);
+    free(dsm_global->bloco_sujo);
+    free(dsm_global->blocos_sujos);
+    free(dsm_global->slots_modificados);
+    pthread_mutex_destroy(&dsm_global->mutex_sujos);
     
-    // Destruir mutex global
-    pthread_mutex_destroy(&dsm_global->mutex_global);
+    // Liberar cache de blocos remotos
+    for (int i = 0; i < dsm_global->capacidade_cache; i++) {
+        pthread_mutex_destroy(&dsm_global->slots_cache[i].mutex);
+        pthread_cond_destroy(&dsm_global->slots_cache[i].cond);
+    }
+    if (dsm_global->memoria_cache) {
+        munmap(dsm_global->memoria_cache, (size_t)dsm_global->capacidade_cache * dsm_global->tamanho_bloco);
+    }
+    free(dsm_global->slots_cache);
+    free(dsm_global->indice_cache);
+    pthread_mutex_destroy(&dsm_global->mutex_cache);
     
-    // Liberar estrutura principal
+    // Liberar estruturas dimensionadas pela geometria e a estrutura principal
+    free(dsm_global->processos);
+    free(dsm_global->conexoes);
+    free(dsm_global->escritas_confirmadas);
+    free(dsm_global->dono_do_bloco);
+    free(dsm_global->indice_local);
+    free(dsm_global->acessos_bloco);
     free(dsm_global);
     dsm_global = NULL;
     
     log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Sistema DSM finalizado", id);
+    if (log_assincrono) {
+        dsm_parar_log_assincrono();
+    }
     return 0;
 }
 
@@ -534,151 +4028,810 @@ int dsm_cleanup(void) {
 // API PÚBLICA
 // =============================================================================
 
+// Trecho de um acesso [posicao, posicao + tamanho) que cai no bloco id_bloco:
+// offset dentro do bloco, deslocamento correspondente no buffer do chamador e
+// número de bytes
+static void calcular_trecho(int posicao, int tamanho, int id_bloco, 
+                            int *offset, int *deslocamento, int *bytes) {
+    int inicio_bloco = id_bloco * dsm_global->tamanho_bloco;
+    int inicio = posicao > inicio_bloco ? posicao : inicio_bloco;
+    int fim = posicao + tamanho < inicio_bloco + dsm_global->tamanho_bloco ? posicao + tamanho : inicio_bloco + dsm_global->tamanho_bloco;
+    *offset = inicio - inicio_bloco;
+    *deslocamento = inicio - posicao;
+    *bytes = fim - inicio;
+}
+
+// Copia, para cada faixa que toca o bloco, o trecho correspondente do bloco
+// para o buffer da faixa (buffers == NULL apenas carrega o bloco no cache)
+static void copiar_trechos(int id_bloco, const byte *dados_bloco, const int *posicoes, 
+                           byte **buffers, const int *tamanhos, int num_faixas) {
+    if (!buffers) return;
+    
+    int inicio_bloco = id_bloco * dsm_global->tamanho_bloco;
+    for (int f = 0; f < num_faixas; f++) {
+        if (posicoes[f] >= inicio_bloco + dsm_global->tamanho_bloco || posicoes[f] + tamanhos[f] <= inicio_bloco) continue;
+        
+        int offset, deslocamento, bytes;
+        calcular_trecho(posicoes[f], tamanhos[f], id_bloco, &offset, &deslocamento, &bytes);
+        memcpy(buffers[f] + deslocamento, dados_bloco + offset, bytes);
+    }
+}
+
+// Número de blocos a partir do qual ler_faixas() aloca os vetores de busca no heap
+#define MAX_BLOCOS_PILHA 16
+
+// Lê um conjunto de faixas (já validadas). Os blocos cobertos são visitados
+// uma única vez, em ordem crescente: blocos locais e hits de cache são
+// copiados direto, e todos os blocos remotos ausentes são buscados juntos,
+// em paralelo entre donos, por requisitar_blocos_remotos.
+//
+// Nenhum mutex do cache fica travado durante a rede: o bloco buscado fica em
+// CACHE_BUSCANDO, e outros leitores esperam essa busca em vez de repeti-la.
+// Se uma invalidação chegar durante a busca, o resultado não é marcado como
+// válido e o bloco é buscado de novo (até MAX_TENTATIVAS_BUSCA vezes).
+// Um slot invalidado guarda a versão dos seus dados, e o dono só reenvia o
+// bloco se ele mudou desde então.
+// Blocos que não cabem no cache (todos os slots fixados por outras buscas)
+// são lidos por um buffer temporário, sem passar pelo cache.
+static int ler_faixas(const int *posicoes, byte **buffers, const int *tamanhos, int num_faixas) {
+    int id = dsm_global->meu_id;
+    
+    // Blocos cobertos pelas faixas, ordenados e sem repetição
+    int num_blocos = 0;
+    for (int f = 0; f < num_faixas; f++) {
+        num_blocos += (posicoes[f] + tamanhos[f] - 1) / dsm_global->tamanho_bloco - posicoes[f] / dsm_global->tamanho_bloco + 1;
+    }
+    
+    int pilha_blocos[MAX_BLOCOS_PILHA];
+    int pilha_ids[MAX_BLOCOS_PILHA];
+    int pilha_aguardando[MAX_BLOCOS_PILHA];
+    BlocoCache *pilha_slots[MAX_BLOCOS_PILHA];
+    byte *pilha_destinos[MAX_BLOCOS_PILHA];
+    uint64_t pilha_versoes[MAX_BLOCOS_PILHA];
+    int pilha_resultados[MAX_BLOCOS_PILHA];
+    int *blocos = pilha_blocos;
+    int *faltantes = pilha_ids;
+    int *aguardando = pilha_aguardando;
+    BlocoCache **slots = pilha_slots;
+    byte **destinos = pilha_destinos;
+    uint64_t *versoes = pilha_versoes;
+    int *resultados = pilha_resultados;
+    if (num_blocos > MAX_BLOCOS_PILHA) {
+        blocos = (int*)malloc(num_blocos * sizeof(int));
+        faltantes = (int*)malloc(num_blocos * sizeof(int));
+        aguardando = (int*)malloc(num_blocos * sizeof(int));
+        slots = (BlocoCache**)malloc(num_blocos * sizeof(BlocoCache*));
+        destinos = (byte**)malloc(num_blocos * sizeof(byte*));
+        versoes = (uint64_t*)malloc(num_blocos * sizeof(uint64_t));
+        resultados = (int*)malloc(num_blocos * sizeof(int));
+        if (!blocos || !faltantes || !aguardando || !slots || !destinos || !versoes || !resultados) {
+            log_erro("    • ", "[P%d] Erro ao alocar memória para leitura", id);
+            free(blocos);
+            free(faltantes);
+            free(aguardando);
+            free(slots);
+            free(destinos);
+            free(versoes);
+            free(resultados);
+            return -1;
+        }
+    }
+    
+    num_blocos = 0;
+    for (int f = 0; f < num_faixas; f++) {
+        int ultimo = (posicoes[f] + tamanhos[f] - 1) / dsm_global->tamanho_bloco;
+        for (int id_bloco = posicoes[f] / dsm_global->tamanho_bloco; id_bloco <= ultimo; id_bloco++) {
+            blocos[num_blocos++] = id_bloco;
+        }
+    }
+    if (num_faixas > 1) {
+        qsort(blocos, num_blocos, sizeof(int), comparar_inteiros);
+        int unicos = 0;
+        for (int i = 0; i < num_blocos; i++) {
+            if (unicos == 0 || blocos[unicos - 1] != blocos[i]) {
+                blocos[unicos++] = blocos[i];
+            }
+        }
+        num_blocos = unicos;
+    }
+    
+    int erro = 0;
+    
+    // Blocos locais são copiados direto; os remotos ficam em 'blocos'
+    int num_pendentes = 0;
+    for (int b = 0; b < num_blocos; b++) {
+        int id_bloco = blocos[b];
+        
+        // Bloco é meu - ler da memória local (se ele migrou desde a consulta
+        // ao dono, é lido como remoto)
+        uint64_t inicio = agora_ns();
+        uint32_t versao;
+        int idx_local;
+        do {
+            idx_local = iniciar_leitura_bloco(id_bloco, &versao);
+            if (idx_local < 0) break;
+            copiar_trechos(id_bloco, obter_bloco_local(idx_local), posicoes, buffers, tamanhos, num_faixas);
+        } while (!validar_leitura_bloco(id_bloco, idx_local, versao));
+        if (idx_local < 0) {
+            blocos[num_pendentes++] = id_bloco;
+            continue;
+        }
+        
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Lendo bloco local %d", id, id_bloco);
+        registrar_acesso_bloco(idx_local, dsm_global->meu_id);
+        registrar_latencia(LATENCIA_LEITURA_LOCAL, agora_ns() - inicio);
+    }
+    
+    // Blocos remotos - usar cache
+    for (int tentativa = 1; num_pendentes > 0 && !erro; tentativa++) {
+        int num_faltantes = 0;
+        int num_aguardando = 0;
+        
+        for (int b = 0; b < num_pendentes; b++) {
+            int id_bloco = blocos[b];
+            uint64_t inicio = agora_ns();
+            BlocoCache *cache_bloco = obter_bloco_cache(id_bloco, 1);
+            
+            if (!cache_bloco) {
+                // Cache cheio de buscas em andamento: ler sem passar pelo cache
+                byte *temporario = (byte*)malloc(dsm_global->tamanho_bloco);
+                if (!temporario) {
+                    log_erro("    • ", "[P%d] Erro ao alocar memória para leitura", id);
+                    erro = 1;
+                    break;
+                }
+                contar(CACHE_MISSES);
+                faltantes[num_faltantes] = id_bloco;
+                slots[num_faltantes] = NULL;
+                destinos[num_faltantes] = temporario;
+                versoes[num_faltantes] = 0;
+                num_faltantes++;
+                continue;
+            }
+            
+            pthread_mutex_lock(&cache_bloco->mutex);
+            
+            if (cache_bloco->estado == CACHE_COMPARTILHADO || cache_bloco->estado == CACHE_MODIFICADO) {
+                // Cache hit
+                log_debug(COLOR_SUCCESS, "    • ", "[P%d] Cache hit para bloco %d", id, id_bloco);
+                copiar_trechos(id_bloco, cache_bloco->dados, posicoes, buffers, tamanhos, num_faixas);
+                contar(CACHE_HITS);
+                int era_prefetch = cache_bloco->prefetch;
+                if (era_prefetch) {
+                    cache_bloco->prefetch = 0;
+                    contar(PREFETCH_ACERTOS);
+                }
+                pthread_mutex_unlock(&cache_bloco->mutex);
+                liberar_bloco_cache(cache_bloco);
+                registrar_latencia(LATENCIA_CACHE_HIT, agora_ns() - inicio);
+                if (era_prefetch) {
+                    registrar_acesso_prefetch(id_bloco);
+                }
+            } else if (cache_bloco->estado == CACHE_BUSCANDO) {
+                // Outra thread já está buscando o bloco: esperar por ela
+                pthread_mutex_unlock(&cache_bloco->mutex);
+                liberar_bloco_cache(cache_bloco);
+                aguardando[num_aguardando++] = id_bloco;
+            } else {
+                // Cache miss: esta leitura assume a busca (o slot fica fixado
+                // até o fim) e oferece ao dono a versão da cópia invalidada
+                versoes[num_faltantes] = cache_bloco->versao;
+                cache_bloco->versao = 0;
+                cache_bloco->estado = CACHE_BUSCANDO;
+                cache_bloco->invalidado_na_busca = 0;
+                pthread_mutex_unlock(&cache_bloco->mutex);
+                log_debug(COLOR_DEFAULT, "    • ", "[P%d] Cache miss para bloco %d", id, id_bloco);
+                contar(CACHE_MISSES);
+                registrar_acesso_prefetch(id_bloco);
+                faltantes[num_faltantes] = id_bloco;
+                slots[num_faltantes] = cache_bloco;
+                destinos[num_faltantes] = cache_bloco->dados;
+                num_faltantes++;
+            }
+        }
+        
+        if (num_faltantes > 0) {
+            // Requisitar os blocos ausentes dos seus donos, em paralelo
+            // (após um erro local, os slots já assumidos são apenas devolvidos)
+            if (erro) {
+                for (int i = 0; i < num_faltantes; i++) resultados[i] = -1;
+            } else {
+                uint64_t inicio = agora_ns();
+                requisitar_blocos_remotos(faltantes, destinos, versoes, resultados, num_faltantes);
+                uint64_t duracao = agora_ns() - inicio;
+                for (int i = 0; i < num_faltantes; i++) {
+                    if (resultados[i] == 0) registrar_latencia(LATENCIA_BUSCA_REMOTA, duracao);
+                }
+            }
+            
+            for (int i = 0; i < num_faltantes; i++) {
+                int id_bloco = faltantes[i];
+                BlocoCache *cache_bloco = slots[i];
+                
+                if (!cache_bloco) {
+                    if (resultados[i] == 0) {
+                        copiar_trechos(id_bloco, destinos[i], posicoes, buffers, tamanhos, num_faixas);
+                    } else {
+                        log_erro("    • ", "[P%d] Falha ao requisitar bloco remoto %d", id, id_bloco);
+                        erro = 1;
+                    }
+                    free(destinos[i]);
+                    continue;
+                }
+                
+                pthread_mutex_lock(&cache_bloco->mutex);
+                if (resultados[i] == 0) {
+                    cache_bloco->versao = versoes[i];
+                }
+                if (resultados[i] != 0) {
+                    log_erro("    • ", "[P%d] Falha ao requisitar bloco remoto %d", id, id_bloco);
+                    cache_bloco->estado = CACHE_INVALIDO;
+                    erro = 1;
+                } else if (!cache_bloco->invalidado_na_busca) {
+                    // Dados reais recebidos e já copiados para cache_bloco->dados
+                    cache_bloco->estado = CACHE_COMPARTILHADO;
+                    copiar_trechos(id_bloco, cache_bloco->dados, posicoes, buffers, tamanhos, num_faixas);
+                    log_debug(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d carregado no cache", id, id_bloco);
+                } else if (tentativa < MAX_TENTATIVAS_BUSCA) {
+                    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d invalidado durante a busca; buscando novamente", id, id_bloco);
+                    cache_bloco->estado = CACHE_INVALIDO;
+                    aguardando[num_aguardando++] = id_bloco;
+                } else {
+                    // A leitura foi concorrente com as escritas: usa o resultado,
+                    // mas não o mantém no cache
+                    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Bloco %d invalidado durante a busca; resultado descartado do cache", id, id_bloco);
+                    cache_bloco->estado = CACHE_INVALIDO;
+                    copiar_trechos(id_bloco, cache_bloco->dados, posicoes, buffers, tamanhos, num_faixas);
+                }
+                pthread_cond_broadcast(&cache_bloco->cond);
+                pthread_mutex_unlock(&cache_bloco->mutex);
+                liberar_bloco_cache(cache_bloco);
+            }
+        }
+        
+        // Esperar as buscas de outras threads (sem nenhuma busca própria
+        // pendente) e revisitar esses blocos na próxima rodada
+        for (int i = 0; i < num_aguardando && !erro; i++) {
+            BlocoCache *cache_bloco = obter_bloco_cache(aguardando[i], 0);
+            if (!cache_bloco) continue;
+            pthread_mutex_lock(&cache_bloco->mutex);
+            while (cache_bloco->estado == CACHE_BUSCANDO) {
+                pthread_cond_wait(&cache_bloco->cond, &cache_bloco->mutex);
+            }
+            pthread_mutex_unlock(&cache_bloco->mutex);
+            liberar_bloco_cache(cache_bloco);
+        }
+        
+        qsort(aguardando, num_aguardando, sizeof(int), comparar_inteiros);
+        memcpy(blocos, aguardando, num_aguardando * sizeof(int));
+        num_pendentes = num_aguardando;
+    }
+    
+    if (blocos != pilha_blocos) {
+        free(blocos);
+        free(faltantes);
+        free(aguardando);
+        free(slots);
+        free(destinos);
+        free(versoes);
+        free(resultados);
+    }
+    
+    return erro ? -1 : 0;
+}
+
 int le(int posicao, byte *buffer, int tamanho) {
     if (!dsm_global) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P?] Sistema DSM não inicializado");
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
         return -1;
     }
     
     int id = dsm_global->meu_id;
     if (!buffer || tamanho <= 0 || posicao < 0) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Parâmetros inválidos para leitura", id);
+        log_erro("    • ", "[P%d] Parâmetros inválidos para leitura", id);
         return -1;
     }
     
-    if (posicao + tamanho > TAMANHO_MEMORIA_TOTAL) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Leitura fora dos limites da memória", id);
+    if (tamanho > dsm_global->tamanho_memoria - posicao) {
+        log_erro("    • ", "[P%d] Leitura fora dos limites da memória", id);
         return -1;
     }
     
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Lendo %d bytes da posição %d", id, tamanho, posicao);
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Lendo %d bytes da posição %d", id, tamanho, posicao);
     
-    // Calcular bloco e offset
-    int id_bloco = posicao / T_TAMANHO_BLOCO;
-    int offset = posicao % T_TAMANHO_BLOCO;
+    if (ler_faixas(&posicao, &buffer, &tamanho, 1) != 0) {
+        return -1;
+    }
+    
+    log_debug(COLOR_SUCCESS, "    • ", "[P%d] Leitura bem-sucedida", id);
+    return 0;
+}
+
+// Lê várias faixas de uma vez: os blocos remotos ausentes de todas elas são
+// pedidos em uma única requisição por dono
+int le_vetor(const int *posicoes, byte **buffers, const int *tamanhos, int quantidade) {
+    if (!dsm_global) {
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
+        return -1;
+    }
     
-    // Verificar se não ultrapassa o limite do bloco
-    if (offset + tamanho > T_TAMANHO_BLOCO) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Leitura atravessa limite de bloco - não suportado nesta implementação", id);
+    int id = dsm_global->meu_id;
+    if (!posicoes || !buffers || !tamanhos || quantidade <= 0) {
+        log_erro("    • ", "[P%d] Parâmetros inválidos para leitura vetorial", id);
         return -1;
     }
     
-    int dono = calcular_dono_bloco(id_bloco);
+    for (int f = 0; f < quantidade; f++) {
+        if (!buffers[f] || tamanhos[f] <= 0 || posicoes[f] < 0 || tamanhos[f] > dsm_global->tamanho_memoria - posicoes[f]) {
+            log_erro("    • ", "[P%d] Faixa %d inválida para leitura vetorial", id, f);
+            return -1;
+        }
+    }
+    
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Lendo %d faixas", id, quantidade);
     
-    if (dono == dsm_global->meu_id) {
-        // Bloco é meu - ler da memória local
-        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Lendo bloco local %d", id, id_bloco);
-        
-        // Encontrar índice na memória local
-        int idx_local = -1;
-        for (int i = 0; i < dsm_global->num_blocos_locais; i++) {
-            if (dsm_global->meus_blocos[i] == id_bloco) {
-                idx_local = i;
+    if (ler_faixas(posicoes, buffers, tamanhos, quantidade) != 0) {
+        return -1;
+    }
+    
+    log_debug(COLOR_SUCCESS, "    • ", "[P%d] Leitura vetorial bem-sucedida", id);
+    return 0;
+}
+
+// Carrega no cache os blocos remotos da faixa, sem copiar dados para o chamador
+int dsm_prefetch(int posicao, int tamanho) {
+    if (!dsm_global) {
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
+        return -1;
+    }
+    
+    int id = dsm_global->meu_id;
+    if (tamanho <= 0 || posicao < 0 || tamanho > dsm_global->tamanho_memoria - posicao) {
+        log_erro("    • ", "[P%d] Parâmetros inválidos para prefetch", id);
+        return -1;
+    }
+    
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Prefetch de %d bytes da posição %d", id, tamanho, posicao);
+    return ler_faixas(&posicao, NULL, &tamanho, 1);
+}
+
+// Envia uma escrita no bloco de outro processo ao dono (write-through) e
+// espera a confirmação. O dono aplica os dados e devolve as cópias do bloco
+// registradas até então, que este processo invalida ou atualiza, conforme o
+// protocolo indicado pelo dono (inclusive a própria), antes de retornar, e
+// avisa o dono com MSG_ESCRITA_CONCLUIDA.
+static int escrever_no_dono(int posicao, const byte *dados, int bytes) {
+    int id = dsm_global->meu_id;
+    int id_bloco = posicao / dsm_global->tamanho_bloco;
+    int resultado = -1;
+    
+    // A resposta pode trazer até um bloco de payload
+    byte *payload = (byte*)malloc(dsm_global->tamanho_bloco);
+    if (!payload) {
+        return -1;
+    }
+    
+    for (int salto = 0; salto < MAX_REDIRECIONAMENTOS; salto++) {
+        int dono = calcular_dono_bloco(id_bloco);
+        if (dono == dsm_global->meu_id) {
+            // O bloco migrou para este processo
+            uint64_t copias;
+            AtualizacaoCopia atualizacao;
+            if (aplicar_escrita_local(id_bloco, posicao % dsm_global->tamanho_bloco, dados, bytes, id, &copias, &atualizacao) == 0) {
+                uint64_t assumidas = copias;
+                invalidar_blocos_remotos(&id_bloco, &copias, &atualizacao, 1);
+                concluir_invalidacao(id_bloco, assumidas, copias);
+                resultado = 0;
                 break;
             }
+            continue;
         }
         
-        if (idx_local >= 0) {
-            memcpy(buffer, &dsm_global->minha_memoria_local[idx_local][offset], tamanho);
-            log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Leitura local bem-sucedida", id);
-            return 0;
+        log_debug(COLOR_DEFAULT, "    • ", "[P%d] Enviando escrita de %d bytes no bloco %d ao processo %d", id, bytes, id_bloco, dono);
+        
+        Mensagem msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.tipo = MSG_ESCRITA_REMOTA;
+        msg.id_bloco = posicao;
+        msg.versao = dsm_global->instancia;
+        msg.tamanho_dados = bytes;
+        msg.dados = (byte*)dados;
+        
+        Mensagem resposta;
+        resposta.dados = payload;
+        if (trocar_mensagens(dono, &msg, &resposta) != 0) {
+            break;
+        }
+        
+        if (resposta.tipo == MSG_REDIRECIONAR && resposta.tamanho_dados == (int)sizeof(uint32_t)) {
+            seguir_redirecionamento(id_bloco, &resposta, salto);
+            continue;
+        }
+        
+        if (resposta.tipo != MSG_ACK_ESCRITA || resposta.tamanho_dados != 3 * (int)sizeof(uint32_t)) {
+            break;
+        }
+        
+        // O dono devolve as cópias do bloco e o protocolo a usar. A cópia
+        // deste processo é tratada sempre: ela pode ter saído do diretório
+        // por outra escrita cuja invalidação ainda não chegou
+        uint32_t ack_rede[3];
+        memcpy(ack_rede, resposta.dados, sizeof(ack_rede));
+        uint64_t copias = ((uint64_t)ntohl(ack_rede[0]) << 32) | ntohl(ack_rede[1]);
+        AtualizacaoCopia atualizacao;
+        atualizacao.offset = posicao % dsm_global->tamanho_bloco;
+        atualizacao.bytes = bytes;
+        atualizacao.dados = ntohl(ack_rede[2]) == PROTOCOLO_ATUALIZACAO ? dados : NULL;
+        atualizacao.versao = resposta.versao;
+        if (atualizacao.dados) {
+            atualizar_copia_no_cache(id_bloco, atualizacao.offset, dados, bytes, atualizacao.versao);
         } else {
-            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: bloco local %d não encontrado", id, id_bloco);
-            return -1;
+            invalidar_copia_no_cache(id_bloco);
         }
-    } else {
-        // Bloco é remoto - usar cache
-        BlocoCache *cache_bloco = obter_bloco_cache(id_bloco);
+        uint64_t assumidas = copias;
+        invalidar_blocos_remotos(&id_bloco, &copias, &atualizacao, 1);
+        
+        // O dono mantém as cópias em invalidação até este aviso: uma escrita
+        // concorrente no bloco também as trata e não retorna antes. As sem
+        // ACK voltam ao diretório dele
+        uint32_t conclusao_rede[5];
+        conclusao_rede[0] = htonl((uint32_t)(assumidas >> 32));
+        conclusao_rede[1] = htonl((uint32_t)assumidas);
+        conclusao_rede[2] = htonl((uint32_t)(copias >> 32));
+        conclusao_rede[3] = htonl((uint32_t)copias);
+        conclusao_rede[4] = htonl(dsm_global->instancia);
+        Mensagem conclusao;
+        memset(&conclusao, 0, sizeof(conclusao));
+        conclusao.tipo = MSG_ESCRITA_CONCLUIDA;
+        conclusao.id_bloco = posicao;
+        conclusao.versao = msg.sequencia;
+        conclusao.tamanho_dados = sizeof(conclusao_rede);
+        conclusao.dados = (byte*)conclusao_rede;
+        trocar_mensagens(dono, &conclusao, NULL);
+        
+        contar(ESCRITAS_REMOTAS_ENVIADAS);
+        log_debug(COLOR_SUCCESS, "    • ", "[P%d] Escrita remota confirmada pelo processo %d (bloco %d)", id, dono, id_bloco);
+        resultado = 0;
+        break;
+    }
+    
+    free(payload);
+    if (resultado != 0) {
+        log_erro("    • ", "[P%d] Falha na escrita remota do bloco %d", id, id_bloco);
+    }
+    return resultado;
+}
+
+// Modo CONSISTENCIA_RELEASE: aplica a escrita na cópia do bloco no cache,
+// que passa a CACHE_MODIFICADO (fixada) e é devolvida ao dono no próximo
+// release. Escritas contíguas ou sobrepostas ao trecho já modificado são
+// combinadas; um bloco ainda não presente é buscado antes. Retorna -1 se a
+// escrita deve ir direto ao dono: trecho separado do já modificado (a cópia
+// local também recebe os dados) ou cache sem slot disponível.
+static int escrever_no_cache(int id_bloco, int offset, const byte *dados, int bytes) {
+    for (int tentativa = 0; tentativa < MAX_TENTATIVAS_BUSCA; tentativa++) {
+        BlocoCache *cache_bloco = obter_bloco_cache(id_bloco, 1);
+        if (!cache_bloco) return -1;
         
         pthread_mutex_lock(&cache_bloco->mutex);
+        while (cache_bloco->estado == CACHE_BUSCANDO) {
+            pthread_cond_wait(&cache_bloco->cond, &cache_bloco->mutex);
+        }
         
-        if (cache_bloco->valido) {
-            // Cache hit
-            log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Cache hit para bloco %d", id, id_bloco);
-            memcpy(buffer, &cache_bloco->dados[offset], tamanho);
-            cache_hits++;
-        } else {
-            // Cache miss
-            log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Cache miss para bloco %d", id, id_bloco);
-            cache_misses++;
-            
-            // Requisitar bloco do dono
-            if (requisitar_bloco_remoto(id_bloco, cache_bloco->dados) == 0) {
-                // Dados reais recebidos e já copiados para cache_bloco->dados
-                cache_bloco->valido = 1;
-                
-                memcpy(buffer, &cache_bloco->dados[offset], tamanho);
-                log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Bloco %d carregado no cache e leitura realizada", id, id_bloco);
-            } else {
-                pthread_mutex_unlock(&cache_bloco->mutex);
-                log_padronizado(COLOR_ERROR, "    • ", "[P%d] Falha ao requisitar bloco remoto %d", id, id_bloco);
-                return -1;
+        if (cache_bloco->estado == CACHE_MODIFICADO) {
+            memcpy(cache_bloco->dados + offset, dados, bytes);
+            int separado = offset > cache_bloco->fim_sujo || offset + bytes < cache_bloco->inicio_sujo;
+            if (!separado) {
+                if (offset < cache_bloco->inicio_sujo) cache_bloco->inicio_sujo = offset;
+                if (offset + bytes > cache_bloco->fim_sujo) cache_bloco->fim_sujo = offset + bytes;
             }
+            pthread_mutex_unlock(&cache_bloco->mutex);
+            liberar_bloco_cache(cache_bloco);
+            if (separado) return -1;
+            
+            contar(ESCRITAS_ADIADAS);
+            return 0;
+        }
+        
+        if (cache_bloco->estado == CACHE_COMPARTILHADO) {
+            memcpy(cache_bloco->dados + offset, dados, bytes);
+            cache_bloco->estado = CACHE_MODIFICADO;
+            cache_bloco->versao = 0;
+            cache_bloco->inicio_sujo = offset;
+            cache_bloco->fim_sujo = offset + bytes;
+            cache_bloco->invalidado_na_busca = 0;
+            cache_bloco->prefetch = 0;
+            pthread_mutex_unlock(&cache_bloco->mutex);
+            
+            // A fixação obtida acima fica com o slot até o release
+            pthread_mutex_lock(&dsm_global->mutex_sujos);
+            dsm_global->slots_modificados[dsm_global->num_slots_modificados++] = cache_bloco;
+            pthread_mutex_unlock(&dsm_global->mutex_sujos);
+            contar(ESCRITAS_ADIADAS);
+            return 0;
         }
         
+        // CACHE_INVALIDO: trazer o bloco antes de escrever nele
         pthread_mutex_unlock(&cache_bloco->mutex);
-        return 0;
+        liberar_bloco_cache(cache_bloco);
+        
+        int posicao_bloco = id_bloco * dsm_global->tamanho_bloco;
+        int tamanho_bloco = dsm_global->tamanho_bloco;
+        if (ler_faixas(&posicao_bloco, NULL, &tamanho_bloco, 1) != 0) return -1;
     }
+    return -1;
+}
+
+// Devolve ao dono o trecho escrito de um slot em CACHE_MODIFICADO. Durante
+// o envio o slot fica em CACHE_BUSCANDO, e leitores e escritores esperam.
+static int devolver_bloco_modificado(BlocoCache *cache_bloco) {
+    pthread_mutex_lock(&cache_bloco->mutex);
+    int id_bloco = cache_bloco->id_bloco;
+    int inicio = cache_bloco->inicio_sujo;
+    int fim = cache_bloco->fim_sujo;
+    cache_bloco->estado = CACHE_BUSCANDO;
+    pthread_mutex_unlock(&cache_bloco->mutex);
+    
+    // Ninguém altera os dados enquanto o slot está em CACHE_BUSCANDO
+    int resultado = escrever_no_dono(id_bloco * dsm_global->tamanho_bloco + inicio, cache_bloco->dados + inicio, fim - inicio);
+    
+    pthread_mutex_lock(&cache_bloco->mutex);
+    cache_bloco->estado = (resultado == 0 && !cache_bloco->invalidado_na_busca) ? CACHE_COMPARTILHADO : CACHE_INVALIDO;
+    pthread_cond_broadcast(&cache_bloco->cond);
+    pthread_mutex_unlock(&cache_bloco->mutex);
+    liberar_bloco_cache(cache_bloco);
+    return resultado;
 }
 
 int escreve(int posicao, byte *buffer, int tamanho) {
     if (!dsm_global) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P?] Sistema DSM não inicializado");
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
         return -1;
     }
     
     int id = dsm_global->meu_id;
     if (!buffer || tamanho <= 0 || posicao < 0) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Parâmetros inválidos para escrita", id);
+        log_erro("    • ", "[P%d] Parâmetros inválidos para escrita", id);
         return -1;
     }
     
-    if (posicao + tamanho > TAMANHO_MEMORIA_TOTAL) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Escrita fora dos limites da memória", id);
+    if (tamanho > dsm_global->tamanho_memoria - posicao) {
+        log_erro("    • ", "[P%d] Escrita fora dos limites da memória", id);
         return -1;
     }
     
-    log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Escrevendo %d bytes na posição %d", id, tamanho, posicao);
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Escrevendo %d bytes na posição %d", id, tamanho, posicao);
+    uint64_t inicio = agora_ns();
     
-    // Calcular bloco e offset
-    int id_bloco = posicao / T_TAMANHO_BLOCO;
-    int offset = posicao % T_TAMANHO_BLOCO;
+    // Blocos cobertos pelo acesso
+    int primeiro_bloco = posicao / dsm_global->tamanho_bloco;
+    int ultimo_bloco = (posicao + tamanho - 1) / dsm_global->tamanho_bloco;
+    int release = dsm_global->config.modo_consistencia == CONSISTENCIA_RELEASE;
     
-    // Verificar se não ultrapassa o limite do bloco
-    if (offset + tamanho > T_TAMANHO_BLOCO) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Escrita atravessa limite de bloco - não suportado nesta implementação", id);
-        return -1;
+    int num_blocos = ultimo_bloco - primeiro_bloco + 1;
+    int pilha_ids[MAX_BLOCOS_PILHA];
+    uint64_t pilha_copias[MAX_BLOCOS_PILHA];
+    uint64_t pilha_assumidas[MAX_BLOCOS_PILHA];
+    AtualizacaoCopia pilha_atualizacoes[MAX_BLOCOS_PILHA];
+    int *ids_blocos = pilha_ids;
+    uint64_t *copias = pilha_copias;
+    uint64_t *assumidas = pilha_assumidas;
+    AtualizacaoCopia *atualizacoes = pilha_atualizacoes;
+    if (num_blocos > MAX_BLOCOS_PILHA) {
+        ids_blocos = (int*)malloc(num_blocos * sizeof(int));
+        copias = (uint64_t*)malloc(num_blocos * sizeof(uint64_t));
+        assumidas = (uint64_t*)malloc(num_blocos * sizeof(uint64_t));
+        atualizacoes = (AtualizacaoCopia*)malloc(num_blocos * sizeof(AtualizacaoCopia));
+        if (!ids_blocos || !copias || !assumidas || !atualizacoes) {
+            log_erro("    • ", "[P%d] Erro ao alocar memória para escrita", id);
+            free(ids_blocos);
+            free(copias);
+            free(assumidas);
+            free(atualizacoes);
+            return -1;
+        }
+    }
+    
+    int num_locais = 0;
+    int erro = 0;
+    
+    for (int id_bloco = primeiro_bloco; id_bloco <= ultimo_bloco; id_bloco++) {
+        int offset, deslocamento, bytes;
+        calcular_trecho(posicao, tamanho, id_bloco, &offset, &deslocamento, &bytes);
+        
+        // Realizar a escrita na memória local. Consistência de liberação:
+        // as cópias remotas são invalidadas em lote no próximo dsm_release;
+        // modo estrito: os processos que receberam o bloco antes desta
+        // escrita são invalidados ou atualizados abaixo
+        if (calcular_dono_bloco(id_bloco) == dsm_global->meu_id &&
+            aplicar_escrita_local(id_bloco, offset, buffer + deslocamento, bytes, dsm_global->meu_id,
+                                  release ? NULL : &copias[num_locais], release ? NULL : &atualizacoes[num_locais]) == 0) {
+            if (release) {
+                log_debug(COLOR_SUCCESS, "    • ", "[P%d] Escrita local realizada no bloco %d (invalidação adiada)", id, id_bloco);
+            } else {
+                log_debug(COLOR_SUCCESS, "    • ", "[P%d] Escrita local realizada no bloco %d", id, id_bloco);
+                assumidas[num_locais] = copias[num_locais];
+                ids_blocos[num_locais++] = id_bloco;
+            }
+            continue;
+        }
+        
+        // Bloco de outro processo (ou que acabou de migrar): combinado no
+        // cache até o release, ou enviado direto ao dono
+        if (release && escrever_no_cache(id_bloco, offset, buffer + deslocamento, bytes) == 0) {
+            log_debug(COLOR_SUCCESS, "    • ", "[P%d] Escrita no bloco remoto %d mantida no cache até o release", id, id_bloco);
+            continue;
+        }
+        if (escrever_no_dono(id_bloco * dsm_global->tamanho_bloco + offset, buffer + deslocamento, bytes) != 0) {
+            erro = 1;
+        }
+    }
+    
+    // Invalidar ou atualizar as cópias remotas: retorna após os ACKs. As
+    // cópias sem confirmação voltam ao diretório e a próxima escrita as alcança
+    if (num_locais > 0) {
+        invalidar_blocos_remotos(ids_blocos, copias, atualizacoes, num_locais);
+        for (int i = 0; i < num_locais; i++) {
+            concluir_invalidacao(ids_blocos[i], assumidas[i], copias[i]);
+        }
     }
     
-    int dono = calcular_dono_bloco(id_bloco);
+    if (ids_blocos != pilha_ids) {
+        free(ids_blocos);
+        free(copias);
+        free(assumidas);
+        free(atualizacoes);
+    }
     
-    if (dono != dsm_global->meu_id) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: Tentativa de escrita em bloco %d que pertence ao processo %d", 
-                   id, id_bloco, dono);
+    if (erro) {
+        log_erro("    • ", "[P%d] Escrita não aplicada em todos os blocos", id);
         return -1;
     }
+    registrar_latencia(LATENCIA_ESCRITA, agora_ns() - inicio);
+    log_debug(COLOR_SUCCESS, "    • ", "[P%d] Escrita bem-sucedida", id);
+    return 0;
+}
+
+// Devolve aos donos todos os slots em CACHE_MODIFICADO
+static int devolver_blocos_modificados(void) {
+    pthread_mutex_lock(&dsm_global->mutex_sujos);
+    int quantidade = dsm_global->num_slots_modificados;
+    BlocoCache **slots = NULL;
+    if (quantidade > 0) {
+        slots = (BlocoCache**)malloc(quantidade * sizeof(BlocoCache*));
+        if (!slots) {
+            pthread_mutex_unlock(&dsm_global->mutex_sujos);
+            log_erro("    • ", "[P%d] Erro ao alocar memória para flush", dsm_global->meu_id);
+            return -1;
+        }
+        memcpy(slots, dsm_global->slots_modificados, quantidade * sizeof(BlocoCache*));
+        dsm_global->num_slots_modificados = 0;
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_sujos);
     
-    // Encontrar índice na memória local
-    int idx_local = -1;
-    for (int i = 0; i < dsm_global->num_blocos_locais; i++) {
-        if (dsm_global->meus_blocos[i] == id_bloco) {
-            idx_local = i;
-            break;
+    int resultado = 0;
+    for (int i = 0; i < quantidade; i++) {
+        if (devolver_bloco_modificado(slots[i]) != 0) {
+            resultado = -1;
         }
     }
+    free(slots);
+    return resultado;
+}
+
+// Torna visíveis as escritas feitas desde o último flush (modo
+// CONSISTENCIA_RELEASE): devolve aos donos os blocos remotos modificados no
+// cache e invalida, em uma única rodada, as cópias remotas dos blocos locais
+// escritos. Retorna depois das confirmações, como um escreve no modo estrito.
+int dsm_flush(void) {
+    if (!dsm_global) {
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
+        return -1;
+    }
     
-    if (idx_local < 0) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Erro: bloco local %d não encontrado", id, id_bloco);
+    int id = dsm_global->meu_id;
+    
+    // Retirar a lista; escritas a partir daqui entram no próximo flush
+    pthread_mutex_lock(&dsm_global->mutex_sujos);
+    int quantidade = dsm_global->num_blocos_sujos;
+    int *ids_blocos = NULL;
+    if (quantidade > 0) {
+        ids_blocos = (int*)malloc(quantidade * sizeof(int));
+        if (!ids_blocos) {
+            pthread_mutex_unlock(&dsm_global->mutex_sujos);
+            log_erro("    • ", "[P%d] Erro ao alocar memória para flush", id);
+            return -1;
+        }
+        memcpy(ids_blocos, dsm_global->blocos_sujos, quantidade * sizeof(int));
+        for (int i = 0; i < quantidade; i++) {
+            dsm_global->bloco_sujo[ids_blocos[i]] = 0;
+        }
+        dsm_global->num_blocos_sujos = 0;
+    }
+    pthread_mutex_unlock(&dsm_global->mutex_sujos);
+    
+    int resultado = devolver_blocos_modificados();
+    if (quantidade == 0) return resultado;
+    
+    // Cópias a invalidar por bloco e, na segunda metade, as assumidas
+    uint64_t *copias = (uint64_t*)malloc(2 * quantidade * sizeof(uint64_t));
+    if (!copias) {
+        // Devolver os blocos à lista para o próximo flush
+        pthread_mutex_lock(&dsm_global->mutex_sujos);
+        for (int i = 0; i < quantidade; i++) {
+            if (!dsm_global->bloco_sujo[ids_blocos[i]]) {
+                dsm_global->bloco_sujo[ids_blocos[i]] = 1;
+                dsm_global->blocos_sujos[dsm_global->num_blocos_sujos++] = ids_blocos[i];
+            }
+        }
+        pthread_mutex_unlock(&dsm_global->mutex_sujos);
+        free(ids_blocos);
+        log_erro("    • ", "[P%d] Erro ao alocar memória para flush", id);
         return -1;
     }
+    uint64_t *assumidas = copias + quantidade;
+    for (int i = 0; i < quantidade; i++) {
+        // Um bloco que migrou desde a escrita já teve as cópias invalidadas
+        int idx_local = travar_bloco_local(ids_blocos[i]);
+        copias[i] = 0;
+        if (idx_local >= 0) {
+            copias[i] = assumir_invalidacao(idx_local, retirar_compartilhadores(idx_local));
+            destravar_bloco_local(ids_blocos[i]);
+        }
+        assumidas[i] = copias[i];
+    }
     
-    // Realizar a escrita na memória local
-    memcpy(&dsm_global->minha_memoria_local[idx_local][offset], buffer, tamanho);
-    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Escrita local realizada no bloco %d", id, id_bloco);
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Liberando %d blocos escritos", id, quantidade);
+    invalidar_blocos_remotos(ids_blocos, copias, NULL, quantidade);
+    for (int i = 0; i < quantidade; i++) {
+        concluir_invalidacao(ids_blocos[i], assumidas[i], copias[i]);
+    }
+    
+    free(ids_blocos);
+    free(copias);
+    return resultado;
+}
+
+// Início de uma seção de consistência de liberação. As invalidações são
+// enviadas (e confirmadas) no release de quem escreveu, então cópias
+// desatualizadas já foram descartadas quando o acquire correspondente
+// acontece: resta apenas impedir que leituras sejam antecipadas
+int dsm_acquire(void) {
+    if (!dsm_global) {
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
+        return -1;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return 0;
+}
+
+// Fim de uma seção: torna visíveis aos outros processos todas as escritas feitas nela
+int dsm_release(void) {
+    return dsm_flush();
+}
+
+// Define o protocolo de coerência dos blocos que cobrem a faixa. Vale o
+// protocolo registrado no dono do bloco, então todos os processos devem
+// fazer a mesma chamada (a posse pode migrar). Escritas já em andamento
+// terminam com o protocolo anterior.
+int dsm_definir_protocolo(int posicao, int tamanho, ProtocoloCoerencia protocolo) {
+    if (!dsm_global) {
+        log_erro("    • ", "[P?] Sistema DSM não inicializado");
+        return -1;
+    }
     
-    // Invalidar caches remotos (protocolo Write-Invalidate)
-    invalidar_caches_remotos(id_bloco);
+    int id = dsm_global->meu_id;
+    if (tamanho <= 0 || posicao < 0 || tamanho > dsm_global->tamanho_memoria - posicao ||
+        (protocolo != PROTOCOLO_INVALIDACAO && protocolo != PROTOCOLO_ATUALIZACAO && protocolo != PROTOCOLO_ADAPTATIVO)) {
+        log_erro("    • ", "[P%d] Parâmetros inválidos para definir o protocolo", id);
+        return -1;
+    }
     
-    log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Escrita bem-sucedida", id);
+    int primeiro_bloco = posicao / dsm_global->tamanho_bloco;
+    int ultimo_bloco = (posicao + tamanho - 1) / dsm_global->tamanho_bloco;
+    for (int id_bloco = primeiro_bloco; id_bloco <= ultimo_bloco; id_bloco++) {
+        __atomic_store_n(&dsm_global->protocolo_bloco[id_bloco], (byte)protocolo, __ATOMIC_RELAXED);
+    }
+    log_debug(COLOR_DEFAULT, "    • ", "[P%d] Blocos %d a %d com protocolo %d", id, primeiro_bloco, ultimo_bloco, protocolo);
     return 0;
-} 
\ No newline at end of file
+}
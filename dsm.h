@@ -10,23 +10,118 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <time.h>
 
-// Configurações do sistema DSM
+// Geometria padrão do sistema DSM (ajustável em ConfigDSM::num_blocos e
+// ConfigDSM::tamanho_bloco; o número de processos é passado ao dsm_init)
 #define K_NUM_BLOCOS 1024
 #define T_TAMANHO_BLOCO 4096  // 4KB por bloco
-#define N_NUM_PROCESSOS 4
-#define TAMANHO_MEMORIA_TOTAL (K_NUM_BLOCOS * T_TAMANHO_BLOCO)
+#define N_NUM_PROCESSOS 4     // Processos usados pelos programas de teste
+
+// Limites da geometria. O diretório de cópias guarda os processos de cada
+// bloco em um bitmap de 64 bits, e posições globais são int (K * T <= INT_MAX)
+#define MAX_PROCESSOS 64
+#define TAMANHO_MIN_BLOCO 64
+#define TAMANHO_MAX_CAMINHO 256
+
+// Máximo de conexões de entrada atendidas simultaneamente pelo servidor
+#define MAX_CONEXOES_ACEITAS 1024
+
+// Opções de alocação da arena de blocos locais (ConfigDSM::opcoes_memoria)
+#define MEMORIA_HUGETLB    0x1  // Páginas enormes explícitas (MAP_HUGETLB), com fallback para páginas normais
+#define MEMORIA_THP        0x2  // Sugere transparent huge pages (madvise MADV_HUGEPAGE)
+#define MEMORIA_MLOCK      0x4  // Trava a arena na memória física (mlock)
+#define MEMORIA_NUMA_LOCAL 0x8  // Aloca as páginas no nó NUMA local e as pré-carrega
+#define TAMANHO_PAGINA_ENORME (2 * 1024 * 1024)
+
+// Valores padrão de configuração (ver dsm_config_padrao)
+#define THREADS_SERVIDOR_PADRAO 0   // 0 = uma thread trabalhadora por núcleo
+#define BACKLOG_LISTEN_PADRAO SOMAXCONN
+#define OPCOES_MEMORIA_PADRAO MEMORIA_THP
+#define PROFUNDIDADE_PREFETCH_PADRAO 4   // Blocos buscados adiante de um padrão detectado (0 desliga)
+#define MEMORIA_CACHE_PADRAO (4 * 1024 * 1024)  // Orçamento do cache de blocos remotos, em bytes
+#define POLITICA_CACHE_PADRAO POLITICA_LRU
+#define MODO_CONSISTENCIA_PADRAO CONSISTENCIA_ESTRITA
+#define PROTOCOLO_PADRAO PROTOCOLO_INVALIDACAO
+#define COMPRESSAO_PADRAO 0  // Respostas com o bloco inteiro sem compressão
+#define TIMEOUT_ACK_PADRAO_MS 2000  // Espera máxima pelos ACKs de uma rodada de invalidações
+#define INTERVALO_MIGRACAO_PADRAO_MS 0  // Período do rebalanceador de blocos (0 desliga a migração)
+#define LIMIAR_MIGRACAO_PADRAO 64          // Acessos de um mesmo processo que justificam migrar o bloco
+#define DISTRIBUICAO_PADRAO DISTRIBUICAO_MODULO
+#define NOS_VIRTUAIS_HASH 64  // Pontos de cada processo no anel do hashing consistente
+#define NIVEL_LOG_PADRAO NIVEL_LOG_INFO  // Logs de depuração dos caminhos quentes desligados
+
+// Migração de blocos
+#define NUM_TRAVAS_POSSE 64            // Travas da posse dos blocos locais (bloco b usa b % NUM_TRAVAS_POSSE)
+#define FATOR_FOLGA_ARENA 2            // A arena comporta este múltiplo dos blocos iniciais, para receber blocos migrados
+#define MAX_MIGRACOES_POR_RODADA 16
+#define MAX_REDIRECIONAMENTOS 32       // Saltos seguidos por uma requisição antes de desistir
+#define ESPERA_REDIRECIONAMENTO_US 200 // Espera por salto quando dois processos apontam um para o outro
+#define TENTATIVAS_MIGRACAO 4          // Envios de MSG_MIGRAR_BLOCO sem resposta antes de desistir
+#define ESPERA_MIGRACAO_MS 100         // Pausa entre os reenvios de MSG_MIGRAR_BLOCO
+
+// Respostas delta: trechos escritos nas últimas versões de cada bloco local
+#define PROFUNDIDADE_DELTAS 8          // Versões guardadas; uma cópia mais atrasada recebe o bloco inteiro
+#define FOLGA_JUNCAO_DELTA 8           // Trechos separados por até esta distância vão juntos (cada trecho custa 8 bytes)
+
+// Protocolo adaptativo (PROTOCOLO_ADAPTATIVO)
+#define JANELA_ATUALIZACAO_ADAPTATIVA 16  // Escritas propagadas por atualização antes de uma nova medição por invalidação
+
+// Compressão das respostas com o bloco inteiro (ConfigDSM::compressao)
+#define BITS_HASH_COMPRESSAO 12        // Posições candidatas a casamento guardadas pelo compressor LZ
+#define CASAMENTO_MINIMO_LZ 4          // Casamentos menores vão como literais
+#define DISTANCIA_MAX_LZ 65535         // Deslocamentos de 16 bits
+#define GANHO_MINIMO_COMPRESSAO 64     // Bytes economizados abaixo dos quais o bloco vai sem compressão
+
+// Detector de padrões do prefetch
+#define NUM_FLUXOS_PREFETCH 8          // Fluxos de acesso acompanhados simultaneamente
+#define DISTANCIA_MAX_PASSO 64         // Maior passo (em blocos) considerado um padrão
+#define CONFIRMACOES_PREFETCH 2        // Repetições do passo antes de disparar o prefetch
+#define TAMANHO_FILA_PREFETCH 256
+
+// Log assíncrono: anel sem travas esvaziado por uma thread de fundo
+#define CAPACIDADE_ANEL_LOG 1024       // Linhas pendentes (potência de 2); com o anel cheio a linha é descartada
+#define TAMANHO_LINHA_LOG 256          // Linhas maiores são truncadas
+#define ESPERA_ANEL_LOG_US 1000        // Pausa da thread de log com o anel vazio
+
+// Estatísticas: contadores e histogramas divididos em fragmentos por thread
+#define NUM_FRAGMENTOS_ESTATISTICAS 32    // Threads além disso compartilham fragmentos (contagem continua atômica)
+#define NUM_TIPOS_MENSAGEM 32             // Entradas por TipoMensagem nas contagens de rede
+#define BITS_SUBBALDES_LATENCIA 4         // 16 baldes por potência de 2: erro relativo de até 1/16
+#define NUM_BALDES_LATENCIA ((65 - BITS_SUBBALDES_LATENCIA) << BITS_SUBBALDES_LATENCIA)
 
 // Tipos de mensagem para comunicação
 typedef enum {
-    MSG_REQUISICAO_BLOCO = 1,
-    MSG_RESPOSTA_BLOCO = 2,
+    MSG_REQUISICAO_BLOCO = 1,     // versao: versão da cópia que o requisitante ainda tem (0 = nenhuma)
+    MSG_RESPOSTA_BLOCO = 2,       // versao: versão do conteúdo enviado
     MSG_INVALIDAR_BLOCO = 3,
-    MSG_ACK_INVALIDACAO = 4
+    MSG_ACK_INVALIDACAO = 4,
+    MSG_ERRO = 5,
+    MSG_REQUISICAO_MULTIPLA = 6,  // Pares (bloco, versão); respondida com um MSG_RESPOSTA_BLOCO ou MSG_NAO_MODIFICADO por bloco
+    MSG_ESCRITA_REMOTA = 7,       // Escrita no bloco de outro processo: id_bloco leva a posição global do primeiro byte; versao: instância de quem escreve
+    MSG_ACK_ESCRITA = 8,          // Escrita aplicada pelo dono; payload: máscara de 64 bits das cópias e protocolo (32 bits, 1 = atualizá-las); versao: a gerada
+    MSG_MIGRAR_BLOCO = 9,         // Transfere a posse do bloco; payload: conteúdo do bloco, versao: sua versão
+    MSG_ACK_MIGRACAO = 10,        // Bloco migrado instalado pelo novo dono
+    MSG_ATUALIZAR_DONO = 11,      // Aviso de novo dono (payload: processo, 32 bits); não tem resposta
+    MSG_REDIRECIONAR = 12,        // Resposta de quem não é mais dono (payload: dono conhecido, 32 bits)
+    MSG_NAO_MODIFICADO = 13,      // A cópia do requisitante continua atual; sem payload
+    MSG_RESPOSTA_DELTA = 14,      // Só os trechos alterados desde a versão do requisitante; versao: a nova
+    MSG_ATUALIZAR_COPIA = 15,     // Escrita propagada a uma cópia (id_bloco = posição global; versao: a gerada); confirmada com MSG_ACK_INVALIDACAO
+    MSG_MIGRACAO_RECUSADA = 16,   // Resposta a MSG_MIGRAR_BLOCO: arena cheia, o destino não tem o bloco e a posse volta ao remetente
+    MSG_BLOCO_JA_INSTALADO = 17,  // Resposta a MSG_MIGRAR_BLOCO repetida: o destino já é dono do bloco, escrito desde a instalação (versao: a atual)
+    MSG_ESCRITA_CONCLUIDA = 18    // Cópias de uma escrita remota já tratadas (id_bloco = posição global, versao: sequência da escrita); payload: máscaras de 64 bits das cópias recebidas e das sem ACK, e a instância (32 bits); não tem resposta
 } TipoMensagem;
 
+// Flags do cabeçalho (Mensagem::flags)
+#define FLAG_ACEITA_COMPRESSAO 0x01  // Requisição: as respostas com o bloco inteiro podem vir comprimidas
+#define FLAG_BLOCO_ZERADO 0x02       // Resposta: bloco todo em zero, sem payload
+#define FLAG_COMPRESSAO_LZ 0x04      // Resposta: payload no formato LZ de comprimir_lz
+
 // Tipo para representar um byte
 typedef uint8_t byte;
 
@@ -47,20 +142,214 @@ typedef enum {
     LOG_ERROR = 3
 } TipoLog;
 
-// Estrutura para um bloco no cache
+// Níveis de log: só saem as linhas de nível >= ao limiar em uso
+// (dsm_definir_nivel_log ou ConfigDSM::nivel_log)
+typedef enum {
+    NIVEL_LOG_DEBUG = 0,   // Rastreamento dos caminhos quentes (log_debug)
+    NIVEL_LOG_INFO = 1,    // log_padronizado
+    NIVEL_LOG_ERRO = 2,    // log_erro
+    NIVEL_LOG_NENHUM = 3
+} NivelLog;
+
+// Limiar em uso, consultado antes de formatar qualquer linha
+extern int nivel_log_minimo;
+
+// Log de erro: nível ERRO, na cor de erro
+#define log_erro(prefixo, ...) log_nivel(NIVEL_LOG_ERRO, COLOR_ERROR, prefixo, __VA_ARGS__)
+
+// Log de depuração dos caminhos quentes (le, escreve, mensagens). Os
+// argumentos só são avaliados se o nível estiver ativo; compilar com
+// -DDSM_SEM_LOG_DEBUG remove as chamadas por completo.
+#ifdef DSM_SEM_LOG_DEBUG
+#define log_debug(cor, prefixo, ...) \
+    do { if (0) log_nivel(NIVEL_LOG_DEBUG, cor, prefixo, __VA_ARGS__); } while (0)
+#else
+#define log_debug(cor, prefixo, ...) \
+    do { \
+        if (__atomic_load_n(&nivel_log_minimo, __ATOMIC_RELAXED) <= NIVEL_LOG_DEBUG) \
+            log_nivel(NIVEL_LOG_DEBUG, cor, prefixo, __VA_ARGS__); \
+    } while (0)
+#endif
+
+// Estados de um bloco no cache (protocolo MSI)
+typedef enum {
+    CACHE_INVALIDO = 0,       // I: sem cópia local
+    CACHE_BUSCANDO = 1,       // Transitório: busca ou devolução ao dono em andamento; outros esperam em 'cond'
+    CACHE_COMPARTILHADO = 2,  // S: cópia idêntica à do dono, que registra este processo no diretório
+    CACHE_MODIFICADO = 3      // M: escritas locais ainda não enviadas ao dono (apenas CONSISTENCIA_RELEASE)
+} EstadoCache;
+
+// Modos de consistência (ConfigDSM::modo_consistencia)
+typedef enum {
+    CONSISTENCIA_ESTRITA = 0,  // Cada escreve invalida as cópias remotas antes de retornar
+    CONSISTENCIA_RELEASE = 1   // Escritas marcam blocos sujos; invalidações saem em lote no dsm_release
+} ModoConsistencia;
+
+// Protocolo de coerência de um bloco (ConfigDSM::protocolo, dsm_definir_protocolo).
+// Vale o do dono; no modo de liberação, os blocos sujos são sempre invalidados no release.
+typedef enum {
+    PROTOCOLO_INVALIDACAO = 0,  // Write-invalidate: cada escrita invalida as cópias
+    PROTOCOLO_ATUALIZACAO = 1,  // Write-update: os bytes escritos são enviados às cópias, que continuam válidas
+    PROTOCOLO_ADAPTATIVO = 2    // Passa a atualizar enquanto a maioria das cópias invalidadas volta a ser lida
+} ProtocoloCoerencia;
+
+// Políticas de substituição do cache de blocos remotos
+typedef enum {
+    POLITICA_LRU = 0,    // Lista duplamente encadeada; vítima é o slot usado há mais tempo
+    POLITICA_CLOCK = 1   // Bit de referência e ponteiro circular (segunda chance)
+} PoliticaCache;
+
+// Distribuição inicial dos blocos entre os processos (ConfigDSM::distribuicao).
+// Todos os processos precisam usar a mesma política (e o mesmo mapa).
+typedef enum {
+    DISTRIBUICAO_MODULO = 0,  // Bloco i no processo i % num_processos
+    DISTRIBUICAO_FAIXAS = 1,  // Faixas contíguas: varreduras de uma faixa vão a um único dono
+    DISTRIBUICAO_HASH = 2,    // Hashing consistente (anel com NOS_VIRTUAIS_HASH pontos por processo)
+    DISTRIBUICAO_MAPA = 3     // Mapa explícito lido de ConfigDSM::arquivo_distribuicao
+} PoliticaDistribuicao;
+
+// Latências medidas pelos histogramas (EstatisticasDSM::latencias)
+typedef enum {
+    LATENCIA_LEITURA_LOCAL = 0,  // Cópia de um bloco próprio, por bloco
+    LATENCIA_CACHE_HIT = 1,      // Cópia de um bloco presente no cache, por bloco
+    LATENCIA_BUSCA_REMOTA = 2,   // Busca de blocos ausentes nos donos, por bloco buscado
+    LATENCIA_ESCRITA = 3,        // escreve completo, incluindo a rodada de invalidações
+    NUM_LATENCIAS = 4
+} TipoLatencia;
+
+// Histograma de latências com baldes log-lineares (ver registrar_no_histograma)
 typedef struct {
-    int id_bloco;
-    int valido;  // 1 se válido, 0 se inválido
-    byte dados[T_TAMANHO_BLOCO];
-    pthread_mutex_t mutex;  // Para sincronização
+    uint64_t amostras;
+    uint64_t soma_ns;
+    uint64_t minimo_ns;  // 0 = sem amostras
+    uint64_t maximo_ns;
+    uint64_t baldes[NUM_BALDES_LATENCIA];
+} HistogramaLatencia;
+
+// Resumo de um histograma de latências (valores em nanossegundos; os
+// percentis são o limite superior do balde e têm erro relativo de até 1/16)
+typedef struct {
+    uint64_t amostras;
+    uint64_t minimo_ns;
+    uint64_t maximo_ns;
+    double media_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+} ResumoLatencia;
+
+// Estatísticas do processo, somadas de todos os fragmentos (dsm_get_stats)
+typedef struct {
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t invalidacoes_enviadas;
+    uint64_t invalidacoes_recebidas;
+    uint64_t substituicoes_cache;
+    uint64_t escritas_adiadas;
+    uint64_t escritas_remotas_enviadas;
+    uint64_t escritas_remotas_recebidas;
+    uint64_t migracoes_enviadas;
+    uint64_t migracoes_recebidas;
+    uint64_t redirecionamentos;
+    uint64_t revalidacoes;          // Buscas respondidas com MSG_NAO_MODIFICADO (cópia reaproveitada)
+    uint64_t escritas_sem_efeito;   // Escritas de bytes iguais aos do bloco: sem nova versão nem invalidação
+    uint64_t respostas_delta;       // Buscas respondidas com MSG_RESPOSTA_DELTA (só os trechos alterados)
+    uint64_t atualizacoes_enviadas;   // Cópias remotas atualizadas (ou descartadas) no lugar de invalidadas
+    uint64_t atualizacoes_aplicadas;  // Atualizações recebidas que mantiveram a cópia local válida
+    uint64_t respostas_comprimidas;   // Blocos enviados comprimidos (inclusive os zerados)
+    uint64_t bytes_sem_compressao;    // Tamanho original desses blocos
+    uint64_t bytes_comprimidos;       // Payload efetivamente enviado por eles
+    uint64_t prefetch_emitidos;
+    uint64_t prefetch_acertos;
+    uint64_t prefetch_desperdicados;
+    uint64_t logs_descartados;
+    
+    // Tráfego por TipoMensagem (índice = tipo), cabeçalho incluído
+    uint64_t mensagens_enviadas[NUM_TIPOS_MENSAGEM];
+    uint64_t bytes_enviados[NUM_TIPOS_MENSAGEM];
+    uint64_t mensagens_recebidas[NUM_TIPOS_MENSAGEM];
+    uint64_t bytes_recebidos[NUM_TIPOS_MENSAGEM];
+    
+    ResumoLatencia latencias[NUM_LATENCIAS];
+} EstatisticasDSM;
+
+// Vezes que uma leitura rebusca um bloco invalidado durante a própria busca
+#define MAX_TENTATIVAS_BUSCA 3
+
+// Estrutura para um slot do cache. id_bloco e os campos de substituição são
+// protegidos por SistemaDSM::mutex_cache; os demais, pelo mutex do slot.
+// fixacoes só cresce com mutex_cache travado e é liberada atomicamente, sem
+// ele. Um slot fixado (fixacoes > 0) nunca é reaproveitado.
+typedef struct {
+    int id_bloco;  // -1 se o slot está livre
+    EstadoCache estado;
+    int invalidado_na_busca;  // Invalidação recebida em CACHE_BUSCANDO ou CACHE_MODIFICADO: a cópia não volta a CACHE_COMPARTILHADO
+    int inicio_sujo;  // Trecho [inicio_sujo, fim_sujo) escrito em CACHE_MODIFICADO
+    int fim_sujo;
+    int prefetch;  // 1 se carregado pelo prefetch e ainda não lido
+    uint64_t versao;  // Versão do dono a que 'dados' corresponde, mesmo após a invalidação (0 = desconhecida)
+    byte *dados;   // tamanho_bloco bytes em SistemaDSM::memoria_cache; escrito sem o mutex apenas por quem colocou o bloco em CACHE_BUSCANDO
+    pthread_mutex_t mutex;  // Protege estado e flags; nunca fica travado durante a rede
+    pthread_cond_t cond;    // Sinaliza o fim de uma busca
+    
+    int fixacoes;         // Referências obtidas com obter_bloco_cache e ainda não liberadas
+    int proximo_hash;     // Próximo slot na mesma posição do índice (-1 = fim)
+    int anterior_lru;     // Vizinhos na lista LRU (ou na lista de livres)
+    int proximo_lru;
+    int referenciado;     // Bit de referência da política CLOCK
 } BlocoCache;
 
-// Estrutura para mensagens de rede
+// Formato de rede: cabeçalho fixo de 24 bytes em ordem de rede (big-endian)
+//   flags (8 bits) | tipo (8 bits) | origem (16 bits) | id_bloco (32 bits)
+//   tamanho_dados (32 bits) | sequencia (32 bits) | versao (64 bits)
+// seguido do payload apenas quando tamanho_dados > 0
+// O maior payload é um bloco (SistemaDSM::tamanho_bloco bytes), e uma
+// requisição múltipla leva até tamanho_bloco / TAMANHO_PAR_REQUISICAO pares
+// (bloco de 32 bits, versão de 64 bits)
+// MSG_RESPOSTA_DELTA: número de trechos (32 bits), os trechos como pares
+// início | tamanho (32 bits cada) e, em seguida, os bytes de cada trecho
+// na mesma ordem; sempre menor que um bloco
+// FLAG_COMPRESSAO_LZ: sequências no estilo LZ4, cada uma com um byte de
+// comprimentos (literais nos 4 bits altos, casamento - 4 nos baixos; 15 =
+// continua em bytes de extensão somados até um byte < 255), os literais, o
+// deslocamento do casamento (16 bits, little-endian) e a extensão do
+// casamento; a última sequência só tem literais. Sempre menor que um bloco
+#define TAMANHO_CABECALHO 24
+#define TAMANHO_PAR_REQUISICAO 12
+
+// Trecho [inicio, fim) de um bloco alterado por uma escrita
+typedef struct {
+    int inicio;
+    int fim;
+} TrechoEscrito;
+
+// Escrita a propagar às cópias de um bloco (PROTOCOLO_ATUALIZACAO). A cópia
+// só é atualizada se estiver na versão anterior a 'versao'; senão é invalidada.
+typedef struct {
+    int offset;
+    int bytes;
+    const byte *dados;  // NULL: invalidar as cópias
+    uint64_t versao;    // Versão gerada pela escrita
+} AtualizacaoCopia;
+
+// Estado do protocolo adaptativo de um bloco local, mantido pelo dono
+typedef struct {
+    uint32_t releituras;      // Buscas de cópias invalidadas (versão != 0) desde a última medição (__atomic)
+    int copias_invalidadas;   // Cópias invalidadas pela escrita que abriu a medição (0 = sem medição)
+    int escritas_restantes;   // Escritas que ainda serão propagadas por atualização
+} AdaptacaoBloco;
+
+// Estrutura para mensagens de rede (representação em memória, independente do formato de rede)
 typedef struct {
     TipoMensagem tipo;
+    int flags;           // FLAG_* (8 bits na rede)
+    int origem;          // Processo remetente (preenchido ao enviar com meu_id)
     int id_bloco;
     int tamanho_dados;
-    byte dados[T_TAMANHO_BLOCO];
+    uint32_t sequencia;  // Casa a resposta com a requisição na conexão
+    uint64_t versao;     // Versão do bloco (requisições, respostas e migração; 0 = nenhuma)
+    byte *dados;         // Payload de tamanho_dados bytes (memória do chamador)
 } Mensagem;
 
 // Estrutura para informações de processo
@@ -70,32 +359,201 @@ typedef struct {
     int porta;
 } InfoProcesso;
 
+// Conexão persistente com um processo par (pool de conexões)
+typedef struct {
+    int socket;                   // -1 enquanto não conectado
+    uint32_t proxima_sequencia;   // Número de sequência da próxima requisição
+    uint32_t geracao;             // Incrementada a cada descarte: o descritor pode ser reusado pela conexão nova
+    pthread_mutex_t mutex;        // Serializa requisição/resposta nesta conexão
+} ConexaoPar;
+
+// Última escrita remota que o dono confirmou a um processo. Uma
+// retransmissão dela (mesma instância e sequência) recebe a mesma
+// confirmação: reaplicada, a escrita não mudaria nada e as cópias já
+// retiradas do diretório não chegariam a quem escreveu
+typedef struct {
+    uint32_t instancia;           // Instância de quem escreveu: a sequência recomeça se ele reiniciar
+    uint32_t sequencia;
+    int posicao;                  // Posição global escrita (-1 = nenhuma)
+    int bytes;
+    uint64_t copias;              // Cópias devolvidas na confirmação
+    uint64_t versao;
+    uint32_t protocolo;           // ProtocoloCoerencia usado
+    int socket;                   // Conexão em que a confirmação saiu, enquanto as cópias não foram tratadas (-1 = nenhuma)
+    pthread_mutex_t mutex;        // Serializa as escritas remotas do processo
+} EscritaConfirmada;
+
+// Parâmetros ajustáveis em tempo de execução, passados para dsm_init_config
+typedef struct {
+    int num_blocos;             // Blocos da memória compartilhada (K)
+    int tamanho_bloco;          // Bytes por bloco (T), ao menos TAMANHO_MIN_BLOCO
+    int num_threads_servidor;   // Threads trabalhadoras que atendem requisições (0 = nº de núcleos)
+    int backlog_listen;         // Tamanho da fila de conexões pendentes do listen()
+    int opcoes_memoria;         // Combinação de MEMORIA_* para a arena de blocos locais
+    int profundidade_prefetch;  // Blocos buscados adiante de um padrão sequencial/estride (0 desliga)
+    size_t memoria_cache;       // Orçamento do cache de blocos remotos, em bytes (mínimo: um bloco)
+    PoliticaCache politica_cache;
+    int timeout_ack_ms;         // Espera máxima pelos ACKs de invalidação antes de reenviar
+    ModoConsistencia modo_consistencia;
+    ProtocoloCoerencia protocolo;  // Protocolo inicial de todos os blocos (ver dsm_definir_protocolo)
+    int compressao;             // 1 = pedir e enviar respostas com o bloco inteiro comprimidas
+    int intervalo_migracao_ms;  // Período do rebalanceador de blocos (0 desliga a migração)
+    int limiar_migracao;        // Acessos de um processo, por rodada, a partir dos quais o bloco migra para ele
+    PoliticaDistribuicao distribuicao;
+    char arquivo_distribuicao[TAMANHO_MAX_CAMINHO];  // DISTRIBUICAO_MAPA: linhas "primeiro ultimo processo" ('#' comenta)
+    NivelLog nivel_log;         // Limiar de log a partir do dsm_init
+    int log_assincrono;         // 1 = logs vão para o anel e são escritos por uma thread de fundo
+} ConfigDSM;
+
+// Fluxo de acessos acompanhado pelo detector de prefetch
+typedef struct {
+    int ultimo_bloco;       // Último bloco atribuído ao fluxo (-1 se livre)
+    int passo;              // Distância entre acessos consecutivos (0 = ainda desconhecido)
+    int confirmacoes;       // Acessos seguidos que repetiram o passo
+    int proximo_prefetch;   // Próximo bloco ainda não enviado ao prefetch
+    unsigned long uso;      // Momento do último acesso, para substituição LRU
+} FluxoPrefetch;
+
 // Estrutura principal do sistema DSM
 typedef struct {
     int meu_id;
     int num_processos;
+    uint32_t instancia;   // Sorteada no dsm_init (nunca 0): distingue esta execução nas escritas remotas
+    
+    // Geometria em uso (copiada de ConfigDSM no dsm_init)
+    int num_blocos;
+    int tamanho_bloco;
+    int tamanho_memoria;  // num_blocos * tamanho_bloco
+    
+    // Informações dos processos (num_processos entradas)
+    InfoProcesso *processos;
     
-    // Informações dos processos
-    InfoProcesso processos[N_NUM_PROCESSOS];
+    // Dono conhecido de cada bloco. Muda com as migrações e pode estar
+    // desatualizado: o dono antigo responde com MSG_REDIRECIONAR
+    int *dono_do_bloco;
     
-    // Mapeamento de donos dos blocos
-    int dono_do_bloco[K_NUM_BLOCOS];
+    // Índice de cada bloco em minha_memoria_local (-1 se não é meu)
+    int *indice_local;
     
-    // Memória local (blocos que este processo possui)
-    byte **minha_memoria_local;
+    // Memória local (blocos que este processo possui), em uma única região
+    // contígua alinhada a página: o bloco de índice i começa em i * tamanho_bloco
+    byte *minha_memoria_local;
+    size_t tamanho_arena;
+    int capacidade_arena;  // Índices disponíveis na arena (blocos iniciais e folga para migrações)
     int num_blocos_locais;
-    int *meus_blocos;  // Array com IDs dos blocos que possuo
+    int *meus_blocos;      // ID do bloco em cada índice da arena (-1 = livre)
+    int *indices_livres;   // Pilha de índices livres da arena
+    int num_indices_livres;
+    pthread_mutex_t mutex_arena;
+    
+    // Posse dos blocos: indice_local, meus_blocos e o conteúdo de um bloco
+    // local só mudam com a trava do bloco, que também serializa os escritores.
+    // Leitores não a usam: copiam o bloco e validam a cópia pela versão
+    pthread_mutex_t travas_posse[NUM_TRAVAS_POSSE];
+    
+    // Seqlock por índice da arena: ímpar durante uma escrita no bloco
+    uint32_t *seqlock_blocos;
+    
+    // Acessos por bloco local e processo (leituras e escritas que chegam ao
+    // dono), usados pelo rebalanceador; reduzidos à metade a cada rodada.
+    // Entrada do índice i da arena e processo p: acessos_bloco[i * num_processos + p]
+    uint32_t *acessos_bloco;
+    
+    // Diretório: para cada bloco local, bitmap dos processos que receberam
+    // uma cópia desde a última escrita (atualizado com __atomic)
+    uint64_t *compartilhadores;
+    
+    // Cópias retiradas do diretório que alguma escrita ainda está invalidando,
+    // por índice da arena, e quantas escritas invalidam cada uma (entrada do
+    // índice i e processo p: invalidacoes_assumidas[i * num_processos + p]).
+    // Escritas seguintes no bloco também as tratam antes de retornar.
+    // Protegidos pela trava de posse do bloco
+    uint64_t *copias_em_invalidacao;
+    uint32_t *invalidacoes_assumidas;
+    
+    // Versão de cada bloco, mantida pelo dono e levada na migração: muda a
+    // cada escrita que altera o conteúdo (nunca é 0, que significa "nenhuma")
+    uint64_t *versoes_dono;
     
-    // Cache local
-    BlocoCache meu_cache[K_NUM_BLOCOS];
+    // Respostas delta, por índice da arena: o trecho alterado pela escrita
+    // que gerou a versão v fica em historico_escritas[idx * PROFUNDIDADE_DELTAS
+    // + v % PROFUNDIDADE_DELTAS], e versoes_no_historico[idx] diz quantas das
+    // últimas versões estão lá (escritos dentro do seqlock do índice)
+    TrechoEscrito *historico_escritas;
+    int *versoes_no_historico;
     
-    // Thread de escuta
+    // Protocolo de coerência de cada bloco (ProtocoloCoerencia), consultado
+    // pelo dono a cada escrita, e o estado do modo adaptativo por índice da arena
+    byte *protocolo_bloco;
+    AdaptacaoBloco *adaptacao;
+    
+    // Consistência de liberação: blocos locais escritos desde o último
+    // dsm_release, cujas cópias remotas ainda não foram invalidadas
+    byte *bloco_sujo;      // 1 por bloco se o bloco está na lista
+    int *blocos_sujos;     // IDs, na ordem da primeira escrita
+    int num_blocos_sujos;
+    BlocoCache **slots_modificados;  // Slots do cache em CACHE_MODIFICADO (fixados até o release)
+    int num_slots_modificados;
+    pthread_mutex_t mutex_sujos;
+    
+    // Cache de blocos remotos com capacidade fixa: slots, índice hash
+    // id do bloco -> slot e estado da política de substituição
+    BlocoCache *slots_cache;
+    byte *memoria_cache;        // Dados dos slots, contíguos
+    int capacidade_cache;       // Número de slots
+    int *indice_cache;          // Primeiro slot de cada posição do índice (-1 = vazia)
+    int mascara_indice_cache;   // Número de posições do índice - 1 (potência de 2)
+    int slots_livres;           // Lista de slots nunca usados ou liberados (-1 = vazia)
+    int inicio_lru;             // Slot usado mais recentemente
+    int fim_lru;                // Slot usado há mais tempo
+    int ponteiro_clock;
+    pthread_mutex_t mutex_cache;
+    
+    // Conexões de saída persistentes, uma por processo par
+    ConexaoPar *conexoes;
+    
+    // Última escrita remota confirmada a cada processo (num_processos entradas)
+    EscritaConfirmada *escritas_confirmadas;
+    
+    // Configuração em uso
+    ConfigDSM config;
+    
+    // Thread de escuta (loop de eventos epoll)
     pthread_t thread_servidor;
     int socket_servidor;
     int servidor_rodando;
+    int epoll_fd;
+    int evento_parada;  // eventfd que acorda o epoll_wait no dsm_cleanup
+    
+    // Conexões de entrada registradas no epoll
+    int sockets_aceitos[MAX_CONEXOES_ACEITAS];
+    pthread_mutex_t mutex_conexoes;
+    
+    // Pool de threads trabalhadoras e fila de conexões com mensagem pendente
+    pthread_t *threads_trabalhadoras;
+    int num_threads_trabalhadoras;
+    int fila_prontos[MAX_CONEXOES_ACEITAS];
+    int inicio_fila;
+    int tamanho_fila;
+    pthread_mutex_t mutex_fila;
+    pthread_cond_t cond_fila;
+    
+    // Prefetch: detector de padrões e fila consumida pela thread de prefetch
+    FluxoPrefetch fluxos_prefetch[NUM_FLUXOS_PREFETCH];
+    unsigned long relogio_prefetch;
+    int fila_prefetch[TAMANHO_FILA_PREFETCH];
+    int inicio_fila_prefetch;
+    int tamanho_fila_prefetch;
+    int prefetch_rodando;
+    pthread_t thread_prefetch;
+    pthread_mutex_t mutex_prefetch;
+    pthread_cond_t cond_prefetch;
     
-    // Mutex para sincronização geral
-    pthread_mutex_t mutex_global;
+    // Rebalanceador: migra blocos para o processo que domina seus acessos
+    int migracao_rodando;
+    pthread_t thread_migracao;
+    pthread_mutex_t mutex_migracao;
+    pthread_cond_t cond_migracao;
     
 } SistemaDSM;
 
@@ -104,25 +562,54 @@ extern SistemaDSM *dsm_global;
 
 // Protótipos das funções principais
 int dsm_init(int meu_id, InfoProcesso processos[], int num_processos);
+int dsm_init_config(int meu_id, InfoProcesso processos[], int num_processos, const ConfigDSM *config);
+void dsm_config_padrao(ConfigDSM *config);
+int dsm_carregar_config(const char *arquivo, ConfigDSM *config);
 int dsm_cleanup(void);
 void* thread_servidora(void* arg);
+void* thread_trabalhadora(void* arg);
+void* thread_prefetch(void* arg);
+void* thread_migracao(void* arg);
 
 // API pública
 int le(int posicao, byte *buffer, int tamanho);
 int escreve(int posicao, byte *buffer, int tamanho);
+int le_vetor(const int *posicoes, byte **buffers, const int *tamanhos, int quantidade);
+int dsm_prefetch(int posicao, int tamanho);
+int dsm_acquire(void);
+int dsm_release(void);
+int dsm_flush(void);
+int dsm_definir_protocolo(int posicao, int tamanho, ProtocoloCoerencia protocolo);
 
 // Funções auxiliares
 int calcular_dono_bloco(int id_bloco);
 int e_meu_bloco(int id_bloco);
+int obter_indice_local(int id_bloco);
+byte* obter_bloco_local(int idx_local);
 int enviar_mensagem(int id_processo_destino, Mensagem *msg);
+int trocar_mensagens(int id_processo_destino, Mensagem *msg, Mensagem *resposta);
+int transmitir_mensagem(int socket, const Mensagem *msg);
 int receber_mensagem(int socket_cliente, Mensagem *msg);
-BlocoCache* obter_bloco_cache(int id_bloco);
-int requisitar_bloco_remoto(int id_bloco, byte *dados_recebidos);
+BlocoCache* obter_bloco_cache(int id_bloco, int criar);
+void liberar_bloco_cache(BlocoCache *slot);
+int requisitar_bloco_remoto(int id_bloco, byte *dados_recebidos, uint64_t *versao);
+int requisitar_blocos_remotos(const int *ids_blocos, byte **destinos, uint64_t *versoes, int *resultados, int quantidade);
 int invalidar_caches_remotos(int id_bloco);
+int invalidar_blocos_remotos(const int *ids_blocos, uint64_t *copias, const AtualizacaoCopia *atualizacoes, int quantidade);
+int migrar_bloco(int id_bloco, int destino);
 void imprimir_estatisticas(int id);
+int dsm_get_stats(EstatisticasDSM *stats);
+void dsm_zerar_stats(void);
+void registrar_no_histograma(HistogramaLatencia *h, uint64_t ns);
+void somar_histogramas(HistogramaLatencia *destino, const HistogramaLatencia *origem);
+void resumir_histograma(const HistogramaLatencia *h, ResumoLatencia *resumo);
 
 // Função de log padronizada
 void log_padronizado(const char *cor, const char *prefixo, const char *formato, ...);
+void log_nivel(NivelLog nivel, const char *cor, const char *prefixo, const char *formato, ...);
+void dsm_definir_nivel_log(NivelLog nivel);
+int dsm_iniciar_log_assincrono(void);
+void dsm_parar_log_assincrono(void);
 void imprimir_estado_cache(void);
 
 #endif // DSM_H 
\ No newline at end of file
@@ -16,6 +16,12 @@ if [ ! -f "test_dsm" ]; then
     fi
 fi
 
+# Configuração comum aos processos: respostas comprimidas, para exercitar o codec LZ
+CONFIG=$(mktemp /tmp/test_dsm_XXXXXX.conf)
+cat > "$CONFIG" <<EOF
+compressao = 1
+EOF
+
 # Função para limpar processos
 cleanup() {
     echo "Limpando processos..."
@@ -30,19 +36,19 @@ echo
 echo "1. Iniciando processos DSM..."
 
 # Iniciar processos em background com modo automático
-./test_dsm 0 auto &
+./test_dsm 0 auto "$CONFIG" &
 PID0=$!
 sleep 1
 
-./test_dsm 1 auto &
+./test_dsm 1 auto "$CONFIG" &
 PID1=$!
 sleep 1
 
-./test_dsm 2 auto &
+./test_dsm 2 auto "$CONFIG" &
 PID2=$!
 sleep 1
 
-./test_dsm 3 auto &
+./test_dsm 3 auto "$CONFIG" &
 PID3=$!
 sleep 1
 
@@ -83,7 +89,7 @@ echo "Os seguintes processos estão rodando:"
 ps aux | grep test_dsm | grep -v grep
 
 # Aguardar sinal de interrupção
-trap 'cleanup; echo "Teste finalizado."; exit 0' INT TERM
+trap 'cleanup; rm -f "$CONFIG"; echo "Teste finalizado."; exit 0' INT TERM
 
 echo
 echo "Pressione Ctrl+C para parar todos os processos..."
@@ -91,5 +97,6 @@ wait
 
 # Se chegou até aqui, os processos terminaram naturalmente
 echo
+rm -f "$CONFIG"
 echo "Todos os processos terminaram naturalmente."
 echo "Teste finalizado." 
\ No newline at end of file
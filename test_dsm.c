@@ -1,5 +1,7 @@
+#define _GNU_SOURCE
 #include "dsm.h"
 #include <signal.h>
+#include <limits.h>
 
 // Flag para controle de execução
 static volatile int continuar_executando = 1;
@@ -35,7 +37,7 @@ void teste_basico() {
     
     // Encontrar um bloco que pertence a este processo
     int bloco_teste = dsm_global->meu_id;  // Primeiro bloco que me pertence
-    int posicao = bloco_teste * T_TAMANHO_BLOCO;
+    int posicao = bloco_teste * dsm_global->tamanho_bloco;
     
     if (escreve(posicao, dados_escrita, strlen((char*)dados_escrita) + 1) == 0) {
         log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 1.1 Escrita local bem-sucedida", id);
@@ -45,16 +47,16 @@ void teste_basico() {
         if (le(posicao, buffer_leitura, strlen((char*)dados_escrita) + 1) == 0) {
             log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 2.1 Leitura local bem-sucedida: '%s'", id, buffer_leitura);
         } else {
-            log_padronizado(COLOR_ERROR, "\n  ▶ ","[P%d] 2.2 Falha na leitura local", id);
+            log_erro("\n  ▶ ","[P%d] 2.2 Falha na leitura local", id);
         }
     } else {
-        log_padronizado(COLOR_ERROR, "\n  ▶ ","[P%d] 2.3 Falha na escrita local", id);
+        log_erro("\n  ▶ ","[P%d] 2.3 Falha na escrita local", id);
     }
     
     // Teste de acesso a bloco remoto
     log_padronizado(COLOR_STEP, "\n  ▶ ","[P%d] 3. Testando acesso a bloco remoto", id);
     int bloco_remoto = (dsm_global->meu_id + 1) % dsm_global->num_processos;
-    int posicao_remota = bloco_remoto * T_TAMANHO_BLOCO;
+    int posicao_remota = bloco_remoto * dsm_global->tamanho_bloco;
     
     if (le(posicao_remota, buffer_leitura, 16) == 0) {
         log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 3.1 Leitura remota bem-sucedida (cache miss)", id);
@@ -64,16 +66,2096 @@ void teste_basico() {
             log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 3.2 Segunda leitura remota bem-sucedida (cache hit)", id);
         }
     } else {
-        log_padronizado(COLOR_ERROR, "\n  ▶ ","[P%d] 3.3 Falha na leitura remota", id);
+        log_erro("\n  ▶ ","[P%d] 3.3 Falha na leitura remota", id);
     }
     
-    // Teste de escrita em bloco remoto (deve falhar)
-    log_padronizado(COLOR_STEP, "\n  ▶ ","[P%d] 4. Testando escrita em bloco remoto (deve falhar)", id);
-    if (escreve(posicao_remota, dados_escrita, strlen((char*)dados_escrita) + 1) != 0) {
-        log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 4.1 Escrita remota rejeitada corretamente", id);
+    // Teste de escrita em bloco remoto (enviada ao dono do bloco)
+    log_padronizado(COLOR_STEP, "\n  ▶ ","[P%d] 4. Testando escrita em bloco remoto", id);
+    int posicao_escrita_remota = posicao_remota + 64;
+    int tamanho_escrita = strlen((char*)dados_escrita) + 1;
+    if (escreve(posicao_escrita_remota, dados_escrita, tamanho_escrita) == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 4.1 Escrita remota bem-sucedida", id);
+        
+        // A leitura seguinte deve ver o valor escrito
+        memset(buffer_leitura, 0, sizeof(buffer_leitura));
+        if (le(posicao_escrita_remota, buffer_leitura, tamanho_escrita) == 0 &&
+            memcmp(buffer_leitura, dados_escrita, tamanho_escrita) == 0) {
+            log_padronizado(COLOR_SUCCESS, "\n  ▶ ","[P%d] 4.2 Leitura após escrita remota bem-sucedida: '%s'", id, buffer_leitura);
+        } else {
+            log_erro("\n  ▶ ","[P%d] 4.3 Leitura após escrita remota retornou valor incorreto", id);
+        }
     } else {
-        log_padronizado(COLOR_ERROR, "\n  ▶ ","[P%d] 4.2 Escrita remota aceita incorretamente", id);
+        log_erro("\n  ▶ ","[P%d] 4.4 Falha na escrita remota", id);
+    }
+}
+
+// =============================================================================
+// SINCRONIZAÇÃO DOS TESTES AUTOMÁTICOS
+// =============================================================================
+
+#define ESPERA_BARREIRA_MS 30000
+
+// Fase da última barreira alcançada por este processo
+static int32_t fase_barreira = 0;
+
+// Barreira entre os processos feita com o próprio DSM: cada um escreve a sua
+// fase no último bloco e espera que todos a alcancem. Retorna -1 se algum
+// processo não chegou a tempo.
+static int barreira_dsm(void) {
+    int n = dsm_global->num_processos;
+    int base = (dsm_global->num_blocos - 1) * dsm_global->tamanho_bloco;
+    int32_t fase = ++fase_barreira;
+    
+    // As escritas anteriores ficam visíveis antes do aviso (modo release)
+    if (dsm_release() != 0 ||
+        escreve(base + dsm_global->meu_id * (int)sizeof(int32_t), (byte*)&fase, sizeof(fase)) != 0 ||
+        dsm_release() != 0) {
+        return -1;
+    }
+    
+    for (int espera = 0; espera < ESPERA_BARREIRA_MS / 10; espera++) {
+        int32_t fases[MAX_PROCESSOS];
+        dsm_acquire();
+        if (le(base, (byte*)fases, n * (int)sizeof(int32_t)) != 0) {
+            return -1;
+        }
+        int todos = 1;
+        for (int p = 0; p < n; p++) {
+            if (fases[p] < fase) todos = 0;
+        }
+        if (todos) {
+            return 0;
+        }
+        usleep(10000);
+    }
+    return -1;
+}
+
+// Bloco de número 'ordem' entre os do processo, sem contar o da barreira;
+// -1 se o processo tem menos blocos. Os testes usam ordens espaçadas de forma
+// irregular para que as leituras não formem um padrão para o prefetch.
+static int bloco_do_processo(int processo, int ordem) {
+    for (int id_bloco = 0; id_bloco < dsm_global->num_blocos - 1; id_bloco++) {
+        if (calcular_dono_bloco(id_bloco) == processo && ordem-- == 0) {
+            return id_bloco;
+        }
+    }
+    return -1;
+}
+
+// =============================================================================
+// TESTE DO MAPA DE DISTRIBUIÇÃO
+// =============================================================================
+
+#define PORTA_BASE_CONFIGURACAO 8180  // Portas das inicializações feitas depois do dsm_cleanup
+#define BLOCOS_MAPA 16
+
+// Grava 'conteudo' em um arquivo temporário do teste; retorna -1 se não conseguiu
+static int gravar_arquivo_teste(const char *nome, const char *conteudo, char *caminho, size_t tamanho) {
+    snprintf(caminho, tamanho, "/tmp/test_dsm_%d_%s", (int)getpid(), nome);
+    FILE *saida = fopen(caminho, "w");
+    if (!saida) {
+        return -1;
+    }
+    fputs(conteudo, saida);
+    fclose(saida);
+    return 0;
+}
+
+// Inicializa o DSM com a configuração dada e o finaliza em seguida. Cada
+// processo do teste usa uma faixa de portas própria, para que as conexões
+// abertas na inicialização não cheguem aos outros. Retorna o resultado de dsm_init_config; com
+// 'donos' != NULL, devolve nele o dono de cada bloco.
+static int inicializar_com_config(int meu_id, int num_processos, const ConfigDSM *config, int *donos) {
+    InfoProcesso processos[MAX_PROCESSOS + 1];
+    for (int i = 0; i <= MAX_PROCESSOS; i++) {
+        processos[i].id = i;
+        strcpy(processos[i].ip, "127.0.0.1");
+        processos[i].porta = PORTA_BASE_CONFIGURACAO + meu_id * (MAX_PROCESSOS + 1) + i;
+    }
+    
+    int resultado = dsm_init_config(meu_id, processos, num_processos, config);
+    if (resultado == 0) {
+        for (int i = 0; donos && i < dsm_global->num_blocos; i++) {
+            donos[i] = calcular_dono_bloco(i);
+        }
+        dsm_cleanup();
+    }
+    return resultado;
+}
+
+// Mapas de distribuição válidos e inválidos, lidos por dsm_init_config.
+// Roda depois do dsm_cleanup do teste principal.
+void teste_mapa_distribuicao(int meu_id) {
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DO MAPA DE DISTRIBUIÇÃO", meu_id);
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 5. Testando mapas válidos e inválidos (as falhas de inicialização abaixo são esperadas)", meu_id);
+    
+    ConfigDSM config;
+    dsm_config_padrao(&config);
+    config.num_blocos = BLOCOS_MAPA;
+    config.distribuicao = DISTRIBUICAO_MAPA;
+    int erros = 0;
+    
+    // Faixas, bloco isolado, comentários e linhas vazias
+    const char *valido = "# donos do teste\n0 3 0\n4 1\n5 7 1   # faixa\n\n8 11 2\n12 15 3\n";
+    const int donos_esperados[BLOCOS_MAPA] = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 };
+    int donos[BLOCOS_MAPA];
+    if (gravar_arquivo_teste("mapa.txt", valido, config.arquivo_distribuicao, sizeof(config.arquivo_distribuicao)) != 0 ||
+        inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, donos) != 0 ||
+        memcmp(donos, donos_esperados, sizeof(donos)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 5.2 Mapa válido não foi aceito como escrito", meu_id);
+        erros++;
+    }
+    unlink(config.arquivo_distribuicao);
+    
+    struct { const char *nome; const char *conteudo; } invalidos[] = {
+        { "dono fora do intervalo", "0 7 0\n8 15 4\n" },
+        { "dono negativo", "0 7 0\n8 15 -1\n" },
+        { "linha sem números", "donos\n0 15 0\n" },
+        { "linha com um número", "0 7 0\n8\n9 15 1\n" },
+        { "texto depois do dono", "0 7 0\n8 15 1 x\n" },
+        { "texto no lugar do dono", "0 7 0\n8 15 abc\n" },
+        { "faixa invertida", "0 7 0\n15 8 1\n" },
+        { "faixa além do último bloco", "0 7 0\n8 16 1\n" },
+        { "blocos com dois donos", "0 8 0\n8 15 1\n" },
+        { "blocos sem dono", "0 7 0\n9 15 1\n" },
+    };
+    for (size_t c = 0; c < sizeof(invalidos) / sizeof(invalidos[0]); c++) {
+        if (gravar_arquivo_teste("mapa.txt", invalidos[c].conteudo, config.arquivo_distribuicao, sizeof(config.arquivo_distribuicao)) != 0 ||
+            inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, NULL) == 0) {
+            log_erro("\n  ▶ ", "[P%d] 5.3 Mapa com %s foi aceito", meu_id, invalidos[c].nome);
+            erros++;
+        }
+        unlink(config.arquivo_distribuicao);
+    }
+    
+    // Mapa ausente ou não informado
+    if (inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, NULL) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 5.3 Mapa inexistente foi aceito", meu_id);
+        erros++;
+    }
+    config.arquivo_distribuicao[0] = '\0';
+    if (inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, NULL) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 5.3 DISTRIBUICAO_MAPA sem arquivo foi aceita", meu_id);
+        erros++;
+    }
+    
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 5.1 Mapa válido aceito e mapas inválidos rejeitados", meu_id);
+    }
+}
+
+// =============================================================================
+// TESTE DO ARQUIVO DE CONFIGURAÇÃO
+// =============================================================================
+
+// Carrega o conteúdo como arquivo de configuração sobre os padrões
+static int carregar_config_teste(const char *conteudo, ConfigDSM *config) {
+    char caminho[TAMANHO_MAX_CAMINHO];
+    dsm_config_padrao(config);
+    if (gravar_arquivo_teste("config.txt", conteudo, caminho, sizeof(caminho)) != 0) {
+        return -1;
+    }
+    int resultado = dsm_carregar_config(caminho, config);
+    unlink(caminho);
+    return resultado;
+}
+
+// Arquivos de configuração válidos e inválidos e geometrias que
+// dsm_init_config recusa. Roda depois do dsm_cleanup do teste principal.
+void teste_arquivo_configuracao(int meu_id) {
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DO ARQUIVO DE CONFIGURAÇÃO", meu_id);
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 6. Testando arquivos e geometrias (os erros de configuração abaixo são esperados)", meu_id);
+    
+    ConfigDSM config;
+    int erros = 0;
+    
+    // Sufixos, maiúsculas e minúsculas, comentários e o maior valor aceito
+    const char *valido = "# geometria\ntamanho_bloco = 64K\nnum_blocos = 2k   # minúsculo\n\n"
+                         "memoria_cache = 1MB\nmodo_consistencia = release\nlimiar_migracao = 2147483647\n";
+    if (carregar_config_teste(valido, &config) != 0 || config.tamanho_bloco != 64 * 1024 || config.num_blocos != 2048 ||
+        config.memoria_cache != 1024 * 1024 || config.modo_consistencia != CONSISTENCIA_RELEASE ||
+        config.limiar_migracao != INT_MAX) {
+        log_erro("\n  ▶ ", "[P%d] 6.2 Arquivo de configuração válido não foi lido como escrito", meu_id);
+        erros++;
+    }
+    
+    struct { const char *nome; const char *conteudo; } invalidos[] = {
+        { "tamanho além de INT_MAX com sufixo", "tamanho_bloco = 2G\n" },
+        { "número além de INT_MAX", "num_blocos = 2147483648\n" },
+        { "número além de 64 bits", "num_blocos = 99999999999999999999\n" },
+        { "sufixo desconhecido", "tamanho_bloco = 64Q\n" },
+        { "espaço antes do sufixo", "tamanho_bloco = 64 K\n" },
+        { "sufixo sem número", "tamanho_bloco = K\n" },
+        { "número negativo", "tamanho_bloco = -4096\n" },
+        { "valor fora da lista", "modo_consistencia = fraca\n" },
+        { "linha sem '='", "tamanho_bloco 4096\n" },
+        { "chave sem valor", "num_blocos =\n" },
+        { "chave desconhecida", "tamanho_blocos = 4096\n" },
+    };
+    for (size_t c = 0; c < sizeof(invalidos) / sizeof(invalidos[0]); c++) {
+        if (carregar_config_teste(invalidos[c].conteudo, &config) == 0) {
+            log_erro("\n  ▶ ", "[P%d] 6.3 Arquivo com %s foi aceito", meu_id, invalidos[c].nome);
+            erros++;
+        }
+    }
+    
+    // Geometrias lidas sem erro, mas recusadas por dsm_init_config
+    struct { const char *nome; const char *conteudo; } geometrias[] = {
+        { "memória além de INT_MAX", "tamanho_bloco = 64K\nnum_blocos = 32K\n" },
+        { "bloco menor que o mínimo", "tamanho_bloco = 32\n" },
+        { "nenhum bloco", "num_blocos = 0\n" },
+    };
+    for (size_t c = 0; c < sizeof(geometrias) / sizeof(geometrias[0]); c++) {
+        if (carregar_config_teste(geometrias[c].conteudo, &config) != 0 ||
+            inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, NULL) == 0) {
+            log_erro("\n  ▶ ", "[P%d] 6.4 Geometria com %s não foi recusada", meu_id, geometrias[c].nome);
+            erros++;
+        }
+    }
+    dsm_config_padrao(&config);
+    if (inicializar_com_config(meu_id, MAX_PROCESSOS + 1, &config, NULL) == 0 ||
+        inicializar_com_config(0, 0, &config, NULL) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 6.4 Número de processos fora de 1..%d não foi recusado", meu_id, MAX_PROCESSOS);
+        erros++;
+    }
+    
+    // A menor geometria aceita
+    if (carregar_config_teste("tamanho_bloco = 64\nnum_blocos = 1\n", &config) != 0 ||
+        inicializar_com_config(meu_id, N_NUM_PROCESSOS, &config, NULL) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 6.4 Um bloco de %d bytes não foi aceito", meu_id, TAMANHO_MIN_BLOCO);
+        erros++;
+    }
+    
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 6.1 Configurações válidas aceitas e inválidas recusadas", meu_id);
+    }
+}
+
+// =============================================================================
+// TESTE DAS RESPOSTAS DELTA
+// =============================================================================
+
+// Ordem do bloco reescrito 'escritas' vezes: espaçamentos crescentes
+#define ORDEM_DELTA(escritas) (8 + (escritas) * ((escritas) + 3) / 2)
+#define ORDEM_VERSAO_LONGA 70
+
+// Blocos de cada ordem com o mesmo protocolo em todos os processos
+static void definir_protocolo_da_ordem(int ordem, ProtocoloCoerencia protocolo) {
+    for (int p = 0; p < dsm_global->num_processos; p++) {
+        int id_bloco = bloco_do_processo(p, ordem);
+        if (id_bloco >= 0) {
+            dsm_definir_protocolo(id_bloco * dsm_global->tamanho_bloco, dsm_global->tamanho_bloco, protocolo);
+        }
+    }
+}
+
+// Aplica em 'copia' a escrita j da rodada (8 bytes a cada 64) e, se
+// id_bloco >= 0, faz a mesma escrita no bloco
+static int escrever_trecho_delta(int id_bloco, int rodada, int j, byte *copia) {
+    byte dados[8];
+    memset(dados, rodada * 16 + j + 1, sizeof(dados));
+    int offset = 64 + j * 64;
+    memcpy(copia + offset, dados, sizeof(dados));
+    return id_bloco >= 0 ? escreve(id_bloco * dsm_global->tamanho_bloco + offset, dados, sizeof(dados)) : 0;
+}
+
+// Lê o bloco inteiro e confere o conteúdo e o tipo da resposta recebida.
+// Retorna 0 se ele chegou como 'tipo_esperado'.
+static int ler_bloco_delta(int id_bloco, const byte *esperado, byte *dados, TipoMensagem tipo_esperado) {
+    int tamanho = dsm_global->tamanho_bloco;
+    EstatisticasDSM antes, depois;
+    dsm_get_stats(&antes);
+    if (le(id_bloco * tamanho, dados, tamanho) != 0 || memcmp(dados, esperado, tamanho) != 0) {
+        return -1;
+    }
+    dsm_get_stats(&depois);
+    
+    uint64_t deltas = depois.mensagens_recebidas[MSG_RESPOSTA_DELTA] - antes.mensagens_recebidas[MSG_RESPOSTA_DELTA];
+    uint64_t blocos = depois.mensagens_recebidas[MSG_RESPOSTA_BLOCO] - antes.mensagens_recebidas[MSG_RESPOSTA_BLOCO];
+    if (tipo_esperado == MSG_RESPOSTA_DELTA) {
+        return deltas == 1 && blocos == 0 ? 0 : -1;
+    }
+    return deltas == 0 && blocos == 1 ? 0 : -1;
+}
+
+// Etapas do teste das respostas delta entre os blocos 'meus', escritos por
+// este processo, e os 'remotos', lidos do seguinte. Retorna o número de
+// falhas, ou -1 se uma barreira expirou.
+static int verificar_deltas(const int *meus, const int *remotos, byte *esperado, byte *dados) {
+    int id = dsm_global->meu_id;
+    int tamanho = dsm_global->tamanho_bloco;
+    int erros = 0;
+    
+    // O bloco 0 chega à maior versão de 32 bits com o histórico cheio
+    dsm_global->versoes_dono[meus[0]] = UINT32_MAX - PROFUNDIDADE_DELTAS;
+    for (int j = 0; j < PROFUNDIDADE_DELTAS; j++) {
+        if (escrever_trecho_delta(meus[0], 0, j, dados) != 0) erros++;
+        escrever_trecho_delta(-1, 0, j, esperado);
+    }
+    
+    // Cópias dos blocos do processo seguinte
+    if (barreira_dsm() != 0) return -1;
+    for (int k = 0; k <= PROFUNDIDADE_DELTAS + 1; k++) {
+        if (le(remotos[k] * tamanho, dados, tamanho) != 0) erros++;
+    }
+    
+    // O bloco k recebe k escritas, e o 0, uma
+    if (barreira_dsm() != 0) return -1;
+    for (int k = 0; k <= PROFUNDIDADE_DELTAS + 1; k++) {
+        for (int j = 0; j < (k == 0 ? 1 : k); j++) {
+            if (escrever_trecho_delta(meus[k], 1, j, dados) != 0) erros++;
+            escrever_trecho_delta(-1, 1, j, esperado + (size_t)k * tamanho);
+        }
+    }
+    
+    if (barreira_dsm() != 0) return -1;
+    for (int k = 1; k <= PROFUNDIDADE_DELTAS + 1; k++) {
+        TipoMensagem tipo = k <= PROFUNDIDADE_DELTAS ? MSG_RESPOSTA_DELTA : MSG_RESPOSTA_BLOCO;
+        if (ler_bloco_delta(remotos[k], esperado + (size_t)k * tamanho, dados, tipo) != 0) {
+            log_erro("\n  ▶ ", "[P%d] 7.2 Cópia %d versões atrás do bloco %d não chegou %s",
+                            id, k, remotos[k], tipo == MSG_RESPOSTA_DELTA ? "como delta" : "inteira");
+            erros++;
+        }
+    }
+    
+    // A versão passa de 32 bits sem voltar: a cópia anterior recebe um delta
+    if (ler_bloco_delta(remotos[0], esperado, dados, MSG_RESPOSTA_DELTA) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 7.3 Cópia do bloco %d anterior à versão 2^32 não chegou como delta", id, remotos[0]);
+        erros++;
+    }
+    
+    // Uma cópia cuja versão coincide com a do dono nos 32 bits baixos não é
+    // revalidada: o bloco mudou e chega inteiro
+    if (barreira_dsm() != 0) return -1;
+    uint64_t versao_copia = __atomic_load_n(&dsm_global->versoes_dono[meus[0]], __ATOMIC_RELAXED);
+    if (escrever_trecho_delta(meus[0], 2, 1, dados) != 0) erros++;
+    escrever_trecho_delta(-1, 2, 1, esperado);
+    __atomic_store_n(&dsm_global->versoes_dono[meus[0]], versao_copia + ((uint64_t)1 << 32), __ATOMIC_RELAXED);
+    if (barreira_dsm() != 0) return -1;
+    if (ler_bloco_delta(remotos[0], esperado, dados, MSG_RESPOSTA_BLOCO) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 7.3 Cópia do bloco %d 2^32 versões atrás não chegou inteira", id, remotos[0]);
+        erros++;
+    }
+    return erros;
+}
+
+// Cópias atrasadas de 1 a PROFUNDIDADE_DELTAS + 1 versões: até a
+// profundidade do histórico vem só o que mudou; depois, o bloco inteiro.
+// Outro bloco passa da versão 2^32, sem volta do contador, e depois fica
+// 2^32 versões à frente de uma cópia.
+void teste_deltas() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int alvo = (id + 1) % n;
+    int tamanho = dsm_global->tamanho_bloco;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DAS RESPOSTAS DELTA", id);
+    
+    // Blocos 1..PROFUNDIDADE_DELTAS + 1 levam esse número de escritas; o 0 passa da versão 2^32
+    int meus[PROFUNDIDADE_DELTAS + 2];
+    int remotos[PROFUNDIDADE_DELTAS + 2];
+    for (int k = 0; k <= PROFUNDIDADE_DELTAS + 1; k++) {
+        int ordem = k == 0 ? ORDEM_VERSAO_LONGA : ORDEM_DELTA(k);
+        meus[k] = bloco_do_processo(id, ordem);
+        remotos[k] = bloco_do_processo(alvo, ordem);
+        definir_protocolo_da_ordem(ordem, PROTOCOLO_INVALIDACAO);
+    }
+    
+    // Os trechos escritos precisam caber em um delta menor que o bloco
+    int suficientes = 64 + (PROFUNDIDADE_DELTAS + 1) * 64 <= tamanho / 2;
+    for (int k = 0; k <= PROFUNDIDADE_DELTAS + 1; k++) {
+        if (meus[k] < 0 || remotos[k] < 0) suficientes = 0;
+    }
+    if (!suficientes) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Blocos pequenos ou poucos demais para o teste; ignorado", id);
+        return;
+    }
+    
+    byte *esperado = (byte*)calloc((size_t)(PROFUNDIDADE_DELTAS + 2) * tamanho, 1);
+    byte *dados = (byte*)malloc(tamanho);
+    if (!esperado || !dados) {
+        free(esperado);
+        free(dados);
+        return;
+    }
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 7. Testando cópias atrasadas de 1 a %d versões", id, PROFUNDIDADE_DELTAS + 1);
+    int erros = verificar_deltas(meus, remotos, esperado, dados);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 7.4 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 7.1 Cópias atrasadas receberam deltas até %d versões e o bloco inteiro depois",
+                        id, PROFUNDIDADE_DELTAS);
+    }
+    
+    free(esperado);
+    free(dados);
+}
+
+// =============================================================================
+// TESTE DOS PROTOCOLOS DE COERÊNCIA
+// =============================================================================
+
+#define ORDEM_ATUALIZACAO 110
+#define ORDEM_FORA_DE_ORDEM 114
+
+// Versão que nenhuma cópia do teste alcança: a atualização chega fora de ordem
+#define VERSAO_FORA_DE_ORDEM 0x4000000000000000ull
+
+#define TAMANHO_TEXTO 32
+
+// Texto que identifica o processo, completado com zeros até TAMANHO_TEXTO
+static void montar_texto(char *texto, const char *rotulo, int processo) {
+    memset(texto, 0, TAMANHO_TEXTO);
+    snprintf(texto, TAMANHO_TEXTO, "%s do P%d", rotulo, processo);
+}
+
+// Etapas do teste dos protocolos. Cada processo lê blocos do seguinte
+// ('alvo') e escreve nos blocos lidos pelo anterior ao anterior, que são do
+// anterior ('dono_escrita'). Retorna o número de falhas, ou -1 se uma
+// barreira expirou.
+static int verificar_protocolos(int alvo, int dono_escrita) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    int leitor = (id + n - 2) % n;
+    int escritor = (id + 2) % n;
+    int atualizado = bloco_do_processo(alvo, ORDEM_ATUALIZACAO);
+    int descartado = bloco_do_processo(alvo, ORDEM_FORA_DE_ORDEM);
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    byte dados[TAMANHO_TEXTO];
+    
+    // O dono marca o bloco cuja cópia vai receber a atualização fora de ordem
+    montar_texto(texto, "Bloco", id);
+    if (escreve(bloco_do_processo(id, ORDEM_FORA_DE_ORDEM) * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    
+    // Cópias dos dois blocos do processo seguinte
+    if (barreira_dsm() != 0) return -1;
+    if (le(atualizado * tamanho, dados, sizeof(dados)) != 0 ||
+        le(descartado * tamanho, dados, sizeof(dados)) != 0) {
+        erros++;
+    }
+    EstatisticasDSM inicio, antes, depois;
+    dsm_get_stats(&inicio);
+    
+    // Escrita remota no bloco de atualização e atualização fora de ordem
+    // enviada direto à cópia do leitor
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Escrita", id);
+    if (escreve(bloco_do_processo(dono_escrita, ORDEM_ATUALIZACAO) * tamanho + 128, (byte*)texto, sizeof(texto)) != 0) erros++;
+    
+    int id_bloco = bloco_do_processo(dono_escrita, ORDEM_FORA_DE_ORDEM);
+    uint64_t copias = (uint64_t)1 << leitor;
+    AtualizacaoCopia atualizacao;
+    atualizacao.offset = 0;
+    atualizacao.bytes = 8;
+    atualizacao.dados = (const byte*)"ERRADO!";
+    atualizacao.versao = VERSAO_FORA_DE_ORDEM;
+    if (invalidar_blocos_remotos(&id_bloco, &copias, &atualizacao, 1) != 1) erros++;
+    
+    // A cópia atualizada continua no cache com a escrita; a outra foi descartada
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Escrita", escritor);
+    dsm_get_stats(&antes);
+    if (le(atualizado * tamanho + 128, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 8.2 Cópia do bloco %d não tem a escrita do P%d", id, atualizado, escritor);
+        erros++;
+    }
+    dsm_get_stats(&depois);
+    if (depois.cache_hits != antes.cache_hits + 1 || depois.cache_misses != antes.cache_misses ||
+        depois.atualizacoes_aplicadas == inicio.atualizacoes_aplicadas) {
+        log_erro("\n  ▶ ", "[P%d] 8.2 Cópia do bloco %d não foi atualizada no cache", id, atualizado);
+        erros++;
+    }
+    
+    montar_texto(texto, "Bloco", alvo);
+    dsm_get_stats(&antes);
+    if (le(descartado * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 8.3 Cópia do bloco %d ficou com a atualização fora de ordem", id, descartado);
+        erros++;
+    }
+    dsm_get_stats(&depois);
+    if (depois.cache_misses != antes.cache_misses + 1) {
+        log_erro("\n  ▶ ", "[P%d] 8.3 Cópia do bloco %d não foi descartada", id, descartado);
+        erros++;
+    }
+    return erros;
+}
+
+// Write-update entre três processos: quem lê um bloco continua com a cópia
+// no cache depois da escrita de outro processo, e uma atualização fora de
+// ordem descarta a cópia em vez de aplicá-la
+void teste_protocolos() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DOS PROTOCOLOS DE COERÊNCIA", id);
+    
+    int alvo = (id + 1) % n;
+    int dono_escrita = (id + n - 1) % n;
+    if (n < 3 || bloco_do_processo(alvo, ORDEM_FORA_DE_ORDEM) < 0 || bloco_do_processo(id, ORDEM_FORA_DE_ORDEM) < 0 ||
+        bloco_do_processo(dono_escrita, ORDEM_FORA_DE_ORDEM) < 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    definir_protocolo_da_ordem(ORDEM_ATUALIZACAO, PROTOCOLO_ATUALIZACAO);
+    definir_protocolo_da_ordem(ORDEM_FORA_DE_ORDEM, PROTOCOLO_ATUALIZACAO);
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 8. Testando atualização de cópias (PROTOCOLO_ATUALIZACAO)", id);
+    int erros = verificar_protocolos(alvo, dono_escrita);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 8.4 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 8.1 Cópia atualizada sem novo miss e atualização fora de ordem descartada", id);
+    }
+}
+
+// =============================================================================
+// TESTE DA COMPRESSÃO
+// =============================================================================
+
+#define NUM_CONTEUDOS_COMPRESSAO 5
+
+static const char *nomes_conteudos[NUM_CONTEUDOS_COMPRESSAO] = {
+    "zerado", "aleatório", "prefixo repetido", "períodos 1 e 3", "período 2 com ruído"
+};
+
+// Ordens dos blocos do teste de compressão entre os blocos de cada processo
+static const int ordens_compressao[NUM_CONTEUDOS_COMPRESSAO] = { 80, 83, 87, 92, 98 };
+
+// Conteúdo do tipo 'tipo' para o bloco, reproduzível por quem o lê: zerado
+// (vai sem payload), aleatório (não comprime), um prefixo aleatório de 256
+// bytes repetido (casamentos longos), uma sequência de 0xAB seguida do
+// período "xyz" (casamentos sobrepostos com deslocamentos 1 e 3) e o período
+// "ab" com um byte diferente a cada 97
+static void gerar_conteudo(int tipo, int id_bloco, byte *dados, int tamanho) {
+    uint32_t estado = 2463534242u ^ (uint32_t)id_bloco;
+    for (int i = 0; i < tamanho; i++) {
+        estado ^= estado << 13;
+        estado ^= estado >> 17;
+        estado ^= estado << 5;
+        switch (tipo) {
+            case 0: dados[i] = 0; break;
+            case 1: dados[i] = (byte)estado; break;
+            case 2: dados[i] = i < 256 ? (byte)estado : dados[i - 256]; break;
+            case 3: dados[i] = i < tamanho / 2 ? 0xAB : (byte)"xyz"[i % 3]; break;
+            default: dados[i] = i % 97 == 96 ? (byte)estado : (byte)"ab"[i % 2]; break;
+        }
+    }
+}
+
+// Envio feito por uma thread, para que o payload não precise caber no buffer do socket
+typedef struct {
+    int socket;
+    Mensagem msg;
+} EnvioLocal;
+
+static void *enviar_mensagem_local(void *arg) {
+    EnvioLocal *envio = (EnvioLocal*)arg;
+    transmitir_mensagem(envio->socket, &envio->msg);
+    shutdown(envio->socket, SHUT_WR);
+    return NULL;
+}
+
+// Entrega a receber_mensagem, por um par de sockets locais, um
+// MSG_RESPOSTA_BLOCO com as flags e o payload dados. Retorna o resultado de
+// receber_mensagem, com o bloco decodificado em 'bloco'.
+static int receber_payload_local(int flags, const byte *payload, int tamanho, byte *bloco) {
+    int par[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, par) != 0) {
+        return -1;
+    }
+    
+    EnvioLocal envio;
+    memset(&envio, 0, sizeof(envio));
+    envio.socket = par[0];
+    envio.msg.tipo = MSG_RESPOSTA_BLOCO;
+    envio.msg.flags = flags;
+    envio.msg.tamanho_dados = tamanho;
+    envio.msg.dados = (byte*)payload;
+    
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, enviar_mensagem_local, &envio) != 0) {
+        close(par[0]);
+        close(par[1]);
+        return -1;
+    }
+    
+    Mensagem msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.dados = bloco;
+    int resultado = receber_mensagem(par[1], &msg);
+    close(par[1]);  // Uma rejeição no meio do payload libera o envio
+    pthread_join(thread, NULL);
+    close(par[0]);
+    return resultado;
+}
+
+// Comprimento LZ acima do valor do token (15): bytes de 255 e o restante
+static int escrever_extensao_lz(byte *destino, int valor) {
+    int n = 0;
+    while (valor >= 255) {
+        destino[n++] = 255;
+        valor -= 255;
+    }
+    destino[n++] = (byte)valor;
+    return n;
+}
+
+// Fluxo LZ de um bloco periódico: os 'periodo' primeiros bytes de 'padrao'
+// como literais e um casamento de deslocamento 'periodo' até o fim do bloco,
+// mais 'excesso' bytes. Retorna o tamanho do fluxo.
+static int montar_fluxo_periodico(const char *padrao, int periodo, int excesso, int tamanho_bloco, byte *fluxo) {
+    int n = 0;
+    fluxo[n++] = (byte)(periodo << 4 | 15);
+    memcpy(fluxo + n, padrao, periodo);
+    n += periodo;
+    fluxo[n++] = (byte)periodo;
+    fluxo[n++] = 0;
+    n += escrever_extensao_lz(fluxo + n, tamanho_bloco - periodo - 4 - 15 + excesso);
+    fluxo[n++] = 0x00;  // Última sequência, sem literais
+    return n;
+}
+
+// Casos do codec LZ entregues direto a receber_mensagem. Retorna o número de falhas.
+static int testar_codec_local(void) {
+    int id = dsm_global->meu_id;
+    int tamanho = dsm_global->tamanho_bloco;
+    byte *fluxo = (byte*)calloc(tamanho + 1, 1);
+    byte *bloco = (byte*)malloc(tamanho);
+    byte *esperado = (byte*)malloc(tamanho);
+    if (!fluxo || !bloco || !esperado) {
+        free(fluxo);
+        free(bloco);
+        free(esperado);
+        return 1;
+    }
+    
+    int erros = 0;
+    int n;
+    
+    // Fluxos válidos: casamentos sobrepostos e bloco zerado
+    struct { const char *padrao; int periodo; } periodicos[] = { { "A", 1 }, { "xyz", 3 } };
+    for (int c = 0; c < 2; c++) {
+        n = montar_fluxo_periodico(periodicos[c].padrao, periodicos[c].periodo, 0, tamanho, fluxo);
+        for (int i = 0; i < tamanho; i++) {
+            esperado[i] = (byte)periodicos[c].padrao[i % periodicos[c].periodo];
+        }
+        memset(bloco, 0xFF, tamanho);
+        if (receber_payload_local(FLAG_COMPRESSAO_LZ, fluxo, n, bloco) != 0 || memcmp(bloco, esperado, tamanho) != 0) {
+            log_erro("\n  ▶ ", "[P%d] 10.2 Fluxo LZ de período %d não reproduziu o bloco", id, periodicos[c].periodo);
+            erros++;
+        }
+    }
+    memset(bloco, 0xFF, tamanho);
+    memset(esperado, 0, tamanho);
+    if (receber_payload_local(FLAG_BLOCO_ZERADO, NULL, 0, bloco) != 0 || memcmp(bloco, esperado, tamanho) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 10.2 Bloco zerado sem payload não foi recebido", id);
+        erros++;
+    }
+    
+    // Fluxos inválidos: truncados, com referências fora do bloco ou grandes demais
+    n = montar_fluxo_periodico("A", 1, 0, tamanho, fluxo);
+    struct { const char *nome; int flags; int tamanho; } invalidos[] = {
+        { "sem a última sequência", FLAG_COMPRESSAO_LZ, n - 1 },
+        { "cortado no deslocamento", FLAG_COMPRESSAO_LZ, 3 },
+        { "com payload e bloco zerado", FLAG_BLOCO_ZERADO, 1 },
+        { "do tamanho do bloco", FLAG_COMPRESSAO_LZ, tamanho },
+        { "maior que o bloco", FLAG_COMPRESSAO_LZ, tamanho + 1 },
+    };
+    for (size_t c = 0; c < sizeof(invalidos) / sizeof(invalidos[0]); c++) {
+        if (receber_payload_local(invalidos[c].flags, fluxo, invalidos[c].tamanho, bloco) == 0) {
+            log_erro("\n  ▶ ", "[P%d] 10.3 Fluxo LZ %s foi aceito", id, invalidos[c].nome);
+            erros++;
+        }
+    }
+    
+    // Casamento que passa do fim do bloco
+    n = montar_fluxo_periodico("A", 1, 1, tamanho, fluxo);
+    if (receber_payload_local(FLAG_COMPRESSAO_LZ, fluxo, n, bloco) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 10.3 Fluxo LZ com casamento além do bloco foi aceito", id);
+        erros++;
+    }
+    
+    // Deslocamentos 0 e antes do início do bloco em um fluxo de resto correto
+    n = montar_fluxo_periodico("A", 1, 0, tamanho, fluxo);
+    for (int deslocamento = 0; deslocamento <= 2; deslocamento += 2) {
+        fluxo[2] = (byte)deslocamento;
+        if (receber_payload_local(FLAG_COMPRESSAO_LZ, fluxo, n, bloco) == 0) {
+            log_erro("\n  ▶ ", "[P%d] 10.3 Fluxo LZ com deslocamento %d foi aceito", id, deslocamento);
+            erros++;
+        }
+    }
+    
+    // Fluxo que termina antes de preencher o bloco
+    const byte curto[] = { 0x20, 'a', 'b' };
+    if (receber_payload_local(FLAG_COMPRESSAO_LZ, curto, sizeof(curto), bloco) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 10.3 Fluxo LZ mais curto que o bloco foi aceito", id);
+        erros++;
+    }
+    
+    free(fluxo);
+    free(bloco);
+    free(esperado);
+    return erros;
+}
+
+// Blocos de conteúdos diferentes buscados de outro processo, comprimidos ou
+// não conforme ConfigDSM::compressao, e os casos do codec LZ
+void teste_compressao() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DA COMPRESSÃO (%s)", id,
+                    dsm_global->config.compressao ? "ligada" : "desligada");
+    
+    int blocos_meus[NUM_CONTEUDOS_COMPRESSAO];
+    int blocos_remotos[NUM_CONTEUDOS_COMPRESSAO];
+    for (int t = 0; t < NUM_CONTEUDOS_COMPRESSAO; t++) {
+        blocos_meus[t] = bloco_do_processo(id, ordens_compressao[t]);
+        blocos_remotos[t] = bloco_do_processo((id + 1) % n, ordens_compressao[t]);
+    }
+    
+    byte *dados = (byte*)malloc(tamanho);
+    byte *esperado = (byte*)malloc(tamanho);
+    if (!dados || !esperado) {
+        free(dados);
+        free(esperado);
+        return;
+    }
+    
+    // Cada processo preenche os seus blocos e lê os do seguinte
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 9. Testando blocos de conteúdos diferentes", id);
+    int erros = 0;
+    for (int t = 1; t < NUM_CONTEUDOS_COMPRESSAO; t++) {
+        if (blocos_meus[t] < 0) continue;
+        gerar_conteudo(t, blocos_meus[t], dados, tamanho);
+        if (escreve(blocos_meus[t] * tamanho, dados, tamanho) != 0) {
+            log_erro("\n  ▶ ", "[P%d] 9.4 Falha ao preencher o bloco %d", id, blocos_meus[t]);
+            erros++;
+        }
+    }
+    if (barreira_dsm() != 0) {
+        log_erro("\n  ▶ ", "[P%d] 9.3 Barreira entre os processos expirou", id);
+        free(dados);
+        free(esperado);
+        return;
+    }
+    
+    for (int t = 0; t < NUM_CONTEUDOS_COMPRESSAO; t++) {
+        if (blocos_remotos[t] < 0) continue;
+        EstatisticasDSM antes, depois;
+        dsm_get_stats(&antes);
+        gerar_conteudo(t, blocos_remotos[t], esperado, tamanho);
+        if (le(blocos_remotos[t] * tamanho, dados, tamanho) != 0 || memcmp(dados, esperado, tamanho) != 0) {
+            log_erro("\n  ▶ ", "[P%d] 9.2 Bloco %d (%s) recebido com conteúdo incorreto",
+                            id, blocos_remotos[t], nomes_conteudos[t]);
+            erros++;
+            continue;
+        }
+        dsm_get_stats(&depois);
+        
+        // Com a compressão ligada, só o bloco aleatório ocupa a rede inteira
+        // (em blocos pequenos nem todos os conteúdos chegam a comprimir)
+        uint64_t bytes = depois.bytes_recebidos[MSG_RESPOSTA_BLOCO] - antes.bytes_recebidos[MSG_RESPOSTA_BLOCO];
+        if (dsm_global->config.compressao && tamanho >= 1024 && t != 1 && bytes >= (uint64_t)tamanho / 2) {
+            log_erro("\n  ▶ ", "[P%d] 9.2 Bloco %d (%s) ocupou %llu bytes na rede",
+                            id, blocos_remotos[t], nomes_conteudos[t], (unsigned long long)bytes);
+            erros++;
+        }
+    }
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 9.1 Blocos remotos recebidos corretamente", id);
+    }
+    
+    // As rejeições registradas pelo DSM nesta etapa são esperadas
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 10. Testando o codec LZ com fluxos válidos e inválidos", id);
+    if (testar_codec_local() == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 10.1 Codec LZ aceitou os fluxos válidos e rejeitou os inválidos", id);
+    }
+    
+    free(dados);
+    free(esperado);
+}
+
+// =============================================================================
+// TESTE DOS ACESSOS QUE CRUZAM BLOCOS
+// =============================================================================
+
+#define BLOCO_FAIXAS 600  // Primeiro bloco das faixas; cada processo usa 8 a partir de BLOCO_FAIXAS + 8 * id
+
+// Faixa do processo: começa no meio de um bloco e termina no meio do
+// terceiro seguinte, cruzando blocos de donos diferentes
+static void faixa_do_processo(int processo, int *posicao, int *tamanho) {
+    int tamanho_bloco = dsm_global->tamanho_bloco;
+    *posicao = (BLOCO_FAIXAS + 8 * processo) * tamanho_bloco + tamanho_bloco / 2;
+    *tamanho = 2 * tamanho_bloco + 100;
+}
+
+static void preencher_faixa(int processo, byte *dados, int tamanho) {
+    for (int i = 0; i < tamanho; i++) {
+        dados[i] = (byte)(processo * 31 + i * 7 + i / 251);
+    }
+}
+
+// Etapas do teste das faixas. Retorna o número de falhas, ou -1 se a
+// barreira expirou.
+static int verificar_faixas(byte *dados, byte *esperado, byte *outro) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int erros = 0;
+    int posicao, tamanho;
+    
+    faixa_do_processo(id, &posicao, &tamanho);
+    preencher_faixa(id, dados, tamanho);
+    if (escreve(posicao, dados, tamanho) != 0) erros++;
+    if (barreira_dsm() != 0) return -1;
+    
+    // Faixa do seguinte com le, e as dos dois seguintes de uma vez com le_vetor
+    int seguinte = (id + 1) % n;
+    int depois = (id + 2) % n;
+    faixa_do_processo(seguinte, &posicao, &tamanho);
+    preencher_faixa(seguinte, esperado, tamanho);
+    if (le(posicao, dados, tamanho) != 0 || memcmp(dados, esperado, tamanho) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 13.2 Faixa do P%d lida com conteúdo incorreto", id, seguinte);
+        erros++;
+    }
+    
+    int posicoes[2], tamanhos[2];
+    byte *buffers[2] = { dados, outro };
+    faixa_do_processo(seguinte, &posicoes[0], &tamanhos[0]);
+    faixa_do_processo(depois, &posicoes[1], &tamanhos[1]);
+    memset(dados, 0, tamanhos[0]);
+    if (le_vetor(posicoes, buffers, tamanhos, 2) != 0 || memcmp(dados, esperado, tamanhos[0]) != 0) {
+        erros++;
+    } else {
+        preencher_faixa(depois, esperado, tamanhos[1]);
+        if (memcmp(outro, esperado, tamanhos[1]) != 0) erros++;
+    }
+    if (erros) {
+        log_erro("\n  ▶ ", "[P%d] 13.2 Faixas lidas com le_vetor com conteúdo incorreto", id);
+    }
+    
+    // Faixas cuja soma passa de INT_MAX precisam ser rejeitadas sem ler nada
+    int memoria = dsm_global->tamanho_memoria;
+    if (le(INT_MAX - 10, dados, 100) == 0 || escreve(memoria - 1, dados, INT_MAX) == 0 ||
+        dsm_prefetch(INT_MAX, INT_MAX) == 0 || dsm_definir_protocolo(1, INT_MAX, PROTOCOLO_INVALIDACAO) == 0 ||
+        le(10, dados, -5) == 0) {
+        log_erro("\n  ▶ ", "[P%d] 13.3 Faixa fora da memória aceita", id);
+        erros++;
+    }
+    posicoes[0] = memoria - 1;
+    tamanhos[0] = INT_MAX;
+    if (le_vetor(posicoes, buffers, tamanhos, 1) == 0 || le(memoria - 1, dados, 1) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 13.3 Limite da memória tratado incorretamente", id);
+        erros++;
+    }
+    return erros;
+}
+
+// Escritas e leituras que começam e terminam no meio de blocos de donos
+// diferentes, e faixas fora da memória
+void teste_faixas() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DOS ACESSOS QUE CRUZAM BLOCOS", id);
+    
+    int posicao, tamanho;
+    faixa_do_processo(n - 1, &posicao, &tamanho);
+    byte *dados = (byte*)malloc(tamanho);
+    byte *esperado = (byte*)malloc(tamanho);
+    byte *outro = (byte*)malloc(tamanho);
+    if (!dados || !esperado || !outro || n < 2 ||
+        (BLOCO_FAIXAS + 8 * n) >= dsm_global->num_blocos - 1) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        free(dados);
+        free(esperado);
+        free(outro);
+        return;
+    }
+    
+    // As rejeições registradas nesta etapa são esperadas
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 13. Testando faixas de %d bytes que cruzam blocos", id, tamanho);
+    int erros = verificar_faixas(dados, esperado, outro);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 13.4 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 13.1 Faixas entre blocos lidas corretamente e faixas fora da memória rejeitadas", id);
+    }
+    free(dados);
+    free(esperado);
+    free(outro);
+}
+
+// =============================================================================
+// TESTE DA INVALIDAÇÃO PARALELA
+// =============================================================================
+
+#define ORDEM_INVALIDACAO 122
+#define TIMEOUT_ACK_TESTE_MS 300
+
+// Troca a conexão persistente com o processo p por um socket local, que
+// o DSM usa como se fosse a conexão com o par. Uma leitura nele que não
+// seja da invalidação (um prefetch atrasado) falha no prazo em vez de
+// prender a conexão.
+static void substituir_conexao(int p, int sock) {
+    struct timeval prazo = { 0, 2 * TIMEOUT_ACK_TESTE_MS * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &prazo, sizeof(prazo));
+    ConexaoPar *conexao = &dsm_global->conexoes[p];
+    pthread_mutex_lock(&conexao->mutex);
+    if (conexao->socket != -1) {
+        close(conexao->socket);
+    }
+    conexao->socket = sock;
+    pthread_mutex_unlock(&conexao->mutex);
+}
+
+static uint64_t milissegundos_desde(const struct timespec *inicio) {
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return (uint64_t)((agora.tv_sec - inicio->tv_sec) * 1000 + (agora.tv_nsec - inicio->tv_nsec) / 1000000);
+}
+
+// Etapas do teste da invalidação com um par que responde ('vivo') e outro
+// cuja conexão foi trocada por um socket local ('mudo'). Retorna o número
+// de falhas.
+static int verificar_invalidacao(int id_bloco, int vivo, int mudo) {
+    int id = dsm_global->meu_id;
+    uint64_t bit_vivo = (uint64_t)1 << vivo;
+    uint64_t bit_mudo = (uint64_t)1 << mudo;
+    int erros = 0;
+    int par[2];
+    struct timespec inicio;
+    
+    // O par mudo nunca confirma: a rodada termina no prazo e a cópia dele fica pendente
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, par) != 0) return 1;
+    substituir_conexao(mudo, par[0]);
+    uint64_t copias = bit_vivo | bit_mudo;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    int confirmados = invalidar_blocos_remotos(&id_bloco, &copias, NULL, 1);
+    uint64_t ms = milissegundos_desde(&inicio);
+    close(par[1]);
+    if (confirmados != 1 || copias != bit_mudo || ms >= 2 * TIMEOUT_ACK_TESTE_MS) {
+        log_erro("\n  ▶ ", "[P%d] 12.2 Par sem ACK: %d confirmados, pendentes 0x%llx, %llu ms",
+                        id, confirmados, (unsigned long long)copias, (unsigned long long)ms);
+        erros++;
+    }
+    
+    // Conexão que cai no meio da rodada: o reenvio por uma conexão nova é confirmado
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, par) != 0) return erros + 1;
+    close(par[1]);
+    substituir_conexao(mudo, par[0]);
+    copias = bit_vivo | bit_mudo;
+    confirmados = invalidar_blocos_remotos(&id_bloco, &copias, NULL, 1);
+    if (confirmados != 2 || copias != 0) {
+        log_erro("\n  ▶ ", "[P%d] 12.3 Reenvio após conexão perdida: %d confirmados, pendentes 0x%llx",
+                        id, confirmados, (unsigned long long)copias);
+        erros++;
+    }
+    
+    // A escrita devolve ao diretório a cópia que não confirmou (no modo
+    // release, a invalidação só sairia no release)
+    if (dsm_global->config.modo_consistencia != CONSISTENCIA_ESTRITA) return erros;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, par) != 0) return erros + 1;
+    substituir_conexao(mudo, par[0]);
+    int idx_local = obter_indice_local(id_bloco);
+    __atomic_fetch_or(&dsm_global->compartilhadores[idx_local], bit_mudo, __ATOMIC_SEQ_CST);
+    byte valor = (byte)(id + 1);
+    if (escreve(id_bloco * dsm_global->tamanho_bloco, &valor, 1) != 0 ||
+        !(__atomic_load_n(&dsm_global->compartilhadores[idx_local], __ATOMIC_SEQ_CST) & bit_mudo)) {
+        log_erro("\n  ▶ ", "[P%d] 12.4 Cópia sem ACK não voltou ao diretório do bloco %d", id, id_bloco);
+        erros++;
+    }
+    close(par[1]);
+    __atomic_and_fetch(&dsm_global->compartilhadores[idx_local], ~bit_mudo, __ATOMIC_SEQ_CST);
+    return erros;
+}
+
+// Rodada de invalidação com um par que não confirma: termina no prazo de
+// ConfigDSM::timeout_ack_ms, inclusive o reenvio, e a cópia sem
+// confirmação volta ao diretório
+void teste_invalidacao() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DA INVALIDAÇÃO PARALELA", id);
+    
+    int id_bloco = bloco_do_processo(id, ORDEM_INVALIDACAO);
+    if (n < 3 || id_bloco < 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    
+    // As falhas de conexão registradas nesta etapa são esperadas. O prefetch
+    // dos testes anteriores termina antes: ele usaria a conexão trocada
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 12. Testando a rodada de invalidação com um par sem ACK", id);
+    int profundidade_original = dsm_global->config.profundidade_prefetch;
+    dsm_global->config.profundidade_prefetch = 0;
+    for (int espera = 0; espera < 100 && __atomic_load_n(&dsm_global->tamanho_fila_prefetch, __ATOMIC_RELAXED) > 0; espera++) {
+        usleep(10000);
+    }
+    usleep(TIMEOUT_ACK_TESTE_MS * 1000);
+    int timeout_original = dsm_global->config.timeout_ack_ms;
+    dsm_global->config.timeout_ack_ms = TIMEOUT_ACK_TESTE_MS;
+    int erros = verificar_invalidacao(id_bloco, (id + 1) % n, (id + 2) % n);
+    dsm_global->config.timeout_ack_ms = timeout_original;
+    dsm_global->config.profundidade_prefetch = profundidade_original;
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 12.1 Rodada terminou no prazo e a cópia sem ACK voltou ao diretório", id);
+    }
+}
+
+// =============================================================================
+// TESTE DAS ESCRITAS REMOTAS
+// =============================================================================
+
+#define ORDEM_ESCRITA_REMOTA 105
+
+// Envia ao dono uma MSG_ESCRITA_REMOTA com a sequência e a instância dadas,
+// como um processo que reiniciou e recomeçou as sequências. Retorna a
+// máscara de cópias do ACK, ou 0 sem ACK.
+static uint64_t enviar_escrita_remota(int dono, int posicao, uint32_t sequencia, uint32_t instancia, const char *texto) {
+    ConexaoPar *conexao = &dsm_global->conexoes[dono];
+    pthread_mutex_lock(&conexao->mutex);
+    conexao->proxima_sequencia = sequencia;
+    pthread_mutex_unlock(&conexao->mutex);
+    
+    Mensagem msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_ESCRITA_REMOTA;
+    msg.id_bloco = posicao;
+    msg.versao = instancia;
+    msg.tamanho_dados = TAMANHO_TEXTO;
+    msg.dados = (byte*)texto;
+    
+    uint32_t ack_rede[3];
+    Mensagem resposta;
+    resposta.dados = (byte*)ack_rede;
+    if (trocar_mensagens(dono, &msg, &resposta) != 0 || resposta.tipo != MSG_ACK_ESCRITA ||
+        resposta.tamanho_dados != (int)sizeof(ack_rede)) {
+        return 0;
+    }
+    return ((uint64_t)ntohl(ack_rede[0]) << 32) | ntohl(ack_rede[1]);
+}
+
+// Avisa o dono de que as cópias de uma escrita enviada por
+// enviar_escrita_remota foram todas invalidadas
+static void concluir_escrita_remota(int dono, int posicao, uint32_t sequencia, uint32_t instancia, uint64_t copias) {
+    uint32_t conclusao_rede[5] = { htonl((uint32_t)(copias >> 32)), htonl((uint32_t)copias), 0, 0, htonl(instancia) };
+    Mensagem msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_ESCRITA_CONCLUIDA;
+    msg.id_bloco = posicao;
+    msg.versao = sequencia;
+    msg.tamanho_dados = sizeof(conclusao_rede);
+    msg.dados = (byte*)conclusao_rede;
+    trocar_mensagens(dono, &msg, NULL);
+}
+
+// Etapas do teste das escritas remotas: cada processo escreve no bloco
+// 'remoto' do seguinte e confere no seu bloco 'meu' as escritas do
+// anterior. Retorna o número de falhas, ou -1 se uma barreira expirou.
+static int verificar_escritas_remotas(int meu, int remoto, byte *dados) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int alvo = (id + 1) % n;
+    int anterior = (id + n - 1) % n;
+    int tamanho = dsm_global->tamanho_bloco;
+    int idx_local = obter_indice_local(meu);
+    uint32_t instancia = dsm_global->instancia + 1;
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    
+    // Com a cópia deste processo no diretório, a escrita a recebe no ACK e
+    // o dono a mantém em invalidação até a conclusão
+    if (le(remoto * tamanho, dados, TAMANHO_TEXTO) != 0) erros++;
+    montar_texto(texto, "Antes do reinicio", id);
+    uint32_t sequencia = dsm_global->conexoes[alvo].proxima_sequencia;
+    uint64_t copias = enviar_escrita_remota(alvo, remoto * tamanho, sequencia, instancia, texto);
+    if (!(copias & ((uint64_t)1 << id))) {
+        log_erro("\n  ▶ ", "[P%d] 14.2 ACK da escrita no bloco %d sem a cópia deste processo", id, remoto);
+        erros++;
+    }
+    if (barreira_dsm() != 0) return -1;
+    if (!(dsm_global->copias_em_invalidacao[idx_local] & ((uint64_t)1 << anterior))) {
+        log_erro("\n  ▶ ", "[P%d] 14.2 Cópia do P%d saiu da invalidação do bloco %d antes da conclusão", id, anterior, meu);
+        erros++;
+    }
+    
+    // A mesma sequência vinda de outra instância é uma escrita nova; repetida, é retransmissão
+    if (barreira_dsm() != 0) return -1;
+    concluir_escrita_remota(alvo, remoto * tamanho, sequencia, instancia, copias);
+    montar_texto(texto, "Depois do reinicio", id);
+    copias = enviar_escrita_remota(alvo, remoto * tamanho, sequencia, instancia + 1, texto);
+    montar_texto(texto, "Retransmitida", id);
+    copias |= enviar_escrita_remota(alvo, remoto * tamanho, sequencia, instancia + 1, texto);
+    concluir_escrita_remota(alvo, remoto * tamanho, sequencia, instancia + 1, copias);
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Depois do reinicio", anterior);
+    if (le(meu * tamanho, dados, TAMANHO_TEXTO) != 0 || memcmp(dados, texto, TAMANHO_TEXTO) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 14.3 Bloco %d não tem a escrita do P%d reiniciado", id, meu, anterior);
+        erros++;
+    }
+    // A última conclusão não tem resposta e pode chegar depois da barreira
+    for (int espera = 0; espera < 100 && __atomic_load_n(&dsm_global->copias_em_invalidacao[idx_local], __ATOMIC_RELAXED); espera++) {
+        usleep(10000);
+    }
+    if (__atomic_load_n(&dsm_global->copias_em_invalidacao[idx_local], __ATOMIC_RELAXED) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 14.2 Cópias do bloco %d ainda em invalidação depois da conclusão", id, meu);
+        erros++;
+    }
+    
+    // A cópia deste processo, que as escritas acima não trataram, é
+    // descartada pela escrita seguinte pelo caminho normal
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Escrita final", id);
+    if (escreve(remoto * tamanho, (byte*)texto, TAMANHO_TEXTO) != 0 || dsm_release() != 0 ||
+        le(remoto * tamanho, dados, TAMANHO_TEXTO) != 0 || memcmp(dados, texto, TAMANHO_TEXTO) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 14.4 Escrita final no bloco %d não foi lida de volta", id, remoto);
+        erros++;
+    }
+    return erros;
+}
+
+// Escritas remotas cruas: as cópias devolvidas ao escritor continuam em
+// invalidação no dono até MSG_ESCRITA_CONCLUIDA, e a deduplicação das
+// retransmissões considera a instância de quem escreveu
+void teste_escritas_remotas() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DAS ESCRITAS REMOTAS", id);
+    
+    int meu = bloco_do_processo(id, ORDEM_ESCRITA_REMOTA);
+    int remoto = bloco_do_processo((id + 1) % n, ORDEM_ESCRITA_REMOTA);
+    byte *dados = (byte*)malloc(dsm_global->tamanho_bloco);
+    if (n < 2 || meu < 0 || remoto < 0 || !dados || dsm_global->tamanho_bloco < TAMANHO_TEXTO) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        free(dados);
+        return;
+    }
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 14. Testando escritas remotas no bloco %d do P%d", id, remoto, (id + 1) % n);
+    int erros = verificar_escritas_remotas(meu, remoto, dados);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 14.5 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 14.1 Cópias em invalidação até a conclusão e instância na deduplicação", id);
+    }
+    free(dados);
+}
+
+// =============================================================================
+// TESTE DO PREFETCH E DAS BUSCAS EM ANDAMENTO
+// =============================================================================
+
+#define ORDEM_BUSCA_CONCORRENTE 126
+#define ORDEM_VARREDURA 130        // Blocos ORDEM_VARREDURA a ORDEM_VARREDURA + BLOCOS_VARREDURA - 1 de cada processo
+#define BLOCOS_VARREDURA 7
+#define THREADS_BUSCA_CONCORRENTE 4
+#define PAUSA_VARREDURA_MS 20      // Trabalho entre os acessos da varredura: o prefetch chega antes
+
+typedef struct {
+    int id_bloco;
+    int *largada;
+    byte dados[TAMANHO_TEXTO];
+    int resultado;
+} LeituraConcorrente;
+
+static void* ler_bloco_concorrente(void* arg) {
+    LeituraConcorrente *leitura = (LeituraConcorrente*)arg;
+    while (!__atomic_load_n(leitura->largada, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+    leitura->resultado = le(leitura->id_bloco * dsm_global->tamanho_bloco, leitura->dados, TAMANHO_TEXTO);
+    return NULL;
+}
+
+// Threads leem ao mesmo tempo um bloco ausente do processo seguinte: só a
+// primeira o busca, e as outras esperam essa busca. Retorna o número de falhas.
+static int verificar_busca_concorrente(int seguinte) {
+    int id = dsm_global->meu_id;
+    int id_bloco = bloco_do_processo(seguinte, ORDEM_BUSCA_CONCORRENTE);
+    char texto[TAMANHO_TEXTO];
+    montar_texto(texto, "Bloco", seguinte);
+    
+    LeituraConcorrente leituras[THREADS_BUSCA_CONCORRENTE];
+    pthread_t threads[THREADS_BUSCA_CONCORRENTE];
+    int largada = 0;
+    int criadas = 0;
+    EstatisticasDSM antes, depois;
+    dsm_get_stats(&antes);
+    for (; criadas < THREADS_BUSCA_CONCORRENTE; criadas++) {
+        leituras[criadas].id_bloco = id_bloco;
+        leituras[criadas].largada = &largada;
+        leituras[criadas].resultado = -1;
+        if (pthread_create(&threads[criadas], NULL, ler_bloco_concorrente, &leituras[criadas]) != 0) break;
+    }
+    __atomic_store_n(&largada, 1, __ATOMIC_RELEASE);
+    int erros = 0;
+    for (int t = 0; t < criadas; t++) {
+        pthread_join(threads[t], NULL);
+        if (leituras[t].resultado != 0 || memcmp(leituras[t].dados, texto, sizeof(texto)) != 0) erros++;
+    }
+    dsm_get_stats(&depois);
+    if (erros || criadas < THREADS_BUSCA_CONCORRENTE) {
+        log_erro("\n  ▶ ", "[P%d] 16.2 Leituras concorrentes do bloco %d com conteúdo incorreto", id, id_bloco);
+        return 1;
+    }
+    if (depois.cache_misses != antes.cache_misses + 1 ||
+        depois.cache_hits != antes.cache_hits + THREADS_BUSCA_CONCORRENTE - 1) {
+        log_erro("\n  ▶ ", "[P%d] 16.2 %llu misses e %llu hits para %d leituras concorrentes do bloco %d", id,
+                 (unsigned long long)(depois.cache_misses - antes.cache_misses),
+                 (unsigned long long)(depois.cache_hits - antes.cache_hits), THREADS_BUSCA_CONCORRENTE, id_bloco);
+        return 1;
+    }
+    return 0;
+}
+
+// Varredura com passo fixo pelos blocos do processo seguinte: depois dos
+// misses que confirmam o passo, os blocos seguintes já chegam pelo prefetch.
+// Retorna o número de falhas.
+static int verificar_varredura(int seguinte) {
+    int id = dsm_global->meu_id;
+    int tamanho = dsm_global->tamanho_bloco;
+    char texto[TAMANHO_TEXTO];
+    byte dados[TAMANHO_TEXTO];
+    montar_texto(texto, "Bloco", seguinte);
+    
+    EstatisticasDSM antes, depois;
+    dsm_get_stats(&antes);
+    int erros = 0;
+    for (int j = 0; j < BLOCOS_VARREDURA; j++) {
+        int id_bloco = bloco_do_processo(seguinte, ORDEM_VARREDURA + j);
+        if (le(id_bloco * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+            log_erro("\n  ▶ ", "[P%d] 16.3 Bloco %d da varredura com conteúdo incorreto", id, id_bloco);
+            erros++;
+        }
+        usleep(PAUSA_VARREDURA_MS * 1000);
+    }
+    dsm_get_stats(&depois);
+    
+    // Um miss abre o fluxo e CONFIRMACOES_PREFETCH confirmam o passo
+    uint64_t misses = depois.cache_misses - antes.cache_misses;
+    uint64_t acertos = depois.prefetch_acertos - antes.prefetch_acertos;
+    if (misses > CONFIRMACOES_PREFETCH + 1 || acertos < BLOCOS_VARREDURA - CONFIRMACOES_PREFETCH - 1) {
+        log_erro("\n  ▶ ", "[P%d] 16.3 Varredura de %d blocos: %llu misses, %llu acertos do prefetch", id,
+                 BLOCOS_VARREDURA, (unsigned long long)misses, (unsigned long long)acertos);
+        erros++;
+    }
+    return erros;
+}
+
+// Passo entre os blocos da varredura de um processo, ou 0 se eles não
+// formam um passo fixo que o detector acompanhe (distribuições por hash)
+static int passo_da_varredura(int processo) {
+    int primeiro = bloco_do_processo(processo, ORDEM_VARREDURA);
+    int segundo = bloco_do_processo(processo, ORDEM_VARREDURA + 1);
+    if (primeiro < 0 || segundo < 0) return 0;
+    int passo = segundo - primeiro;
+    for (int j = 2; j < BLOCOS_VARREDURA; j++) {
+        if (bloco_do_processo(processo, ORDEM_VARREDURA + j) != primeiro + j * passo) return 0;
+    }
+    return passo <= DISTANCIA_MAX_PASSO ? passo : 0;
+}
+
+// Leituras concorrentes de um bloco ausente e prefetch de uma varredura
+void teste_prefetch() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    int seguinte = (id + 1) % n;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DO PREFETCH E DAS BUSCAS EM ANDAMENTO", id);
+    
+    if (n < 2 || bloco_do_processo(id, ORDEM_BUSCA_CONCORRENTE) < 0 || tamanho < TAMANHO_TEXTO ||
+        passo_da_varredura(id) == 0 || passo_da_varredura(seguinte) == 0 ||
+        dsm_global->config.profundidade_prefetch < BLOCOS_VARREDURA - CONFIRMACOES_PREFETCH - 1) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes, ou prefetch raso; teste ignorado", id);
+        return;
+    }
+    
+    // Cada processo marca os próprios blocos antes das leituras do anterior
+    char texto[TAMANHO_TEXTO];
+    montar_texto(texto, "Bloco", id);
+    int erros = 0;
+    if (escreve(bloco_do_processo(id, ORDEM_BUSCA_CONCORRENTE) * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    for (int j = 0; j < BLOCOS_VARREDURA; j++) {
+        if (escreve(bloco_do_processo(id, ORDEM_VARREDURA + j) * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    }
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 16. Testando buscas concorrentes e a varredura de %d blocos do P%d", id, BLOCOS_VARREDURA, seguinte);
+    if (barreira_dsm() != 0) {
+        log_erro("\n  ▶ ", "[P%d] 16.4 Barreira entre os processos expirou", id);
+        return;
+    }
+    erros += verificar_busca_concorrente(seguinte);
+    erros += verificar_varredura(seguinte);
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 16.1 Uma busca por bloco ausente e varredura servida pelo prefetch", id);
+    }
+}
+
+// =============================================================================
+// TESTE DO DIRETÓRIO DE CÓPIAS
+// =============================================================================
+
+#define ORDEM_DIRETORIO 142
+#define ORDEM_SEM_LEITORES 146
+
+// Etapas do teste do diretório: cada processo lê o bloco do seguinte, e o
+// dono confere o diretório antes e depois de escrever. Retorna o número de
+// falhas, ou -1 se uma barreira expirou.
+static int verificar_diretorio(int lido, int sem_leitores, int seguinte) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    uint64_t bit_anterior = (uint64_t)1 << ((id + n - 1) % n);
+    int idx_lido = obter_indice_local(lido);
+    int idx_sem_leitores = obter_indice_local(sem_leitores);
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    byte dados[TAMANHO_TEXTO];
+    
+    montar_texto(texto, "Bloco", id);
+    if (escreve(lido * tamanho, (byte*)texto, sizeof(texto)) != 0 ||
+        escreve(sem_leitores * tamanho, (byte*)texto, sizeof(texto)) != 0) {
+        erros++;
+    }
+    if (barreira_dsm() != 0) return -1;
+    int remoto = bloco_do_processo(seguinte, ORDEM_DIRETORIO);
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0) erros++;
+    
+    // Só quem leu está no diretório, e a escrita o retira
+    if (barreira_dsm() != 0) return -1;
+    uint64_t copias = __atomic_load_n(&dsm_global->compartilhadores[idx_lido], __ATOMIC_SEQ_CST);
+    uint64_t copias_sem_leitores = __atomic_load_n(&dsm_global->compartilhadores[idx_sem_leitores], __ATOMIC_SEQ_CST);
+    if (copias != bit_anterior || copias_sem_leitores != 0) {
+        log_erro("\n  ▶ ", "[P%d] 17.2 Diretório dos blocos %d e %d: 0x%llx e 0x%llx, esperados 0x%llx e 0", id,
+                 lido, sem_leitores, (unsigned long long)copias, (unsigned long long)copias_sem_leitores,
+                 (unsigned long long)bit_anterior);
+        erros++;
+    }
+    montar_texto(texto, "Escrita", id);
+    if (escreve(lido * tamanho, (byte*)texto, sizeof(texto)) != 0 ||
+        escreve(sem_leitores * tamanho, (byte*)texto, sizeof(texto)) != 0 || dsm_release() != 0) {
+        erros++;
+    }
+    copias = __atomic_load_n(&dsm_global->compartilhadores[idx_lido], __ATOMIC_SEQ_CST) |
+             __atomic_load_n(&dsm_global->copias_em_invalidacao[idx_lido], __ATOMIC_SEQ_CST);
+    if (copias != 0) {
+        log_erro("\n  ▶ ", "[P%d] 17.3 Cópias 0x%llx continuam no diretório do bloco %d após a escrita", id,
+                 (unsigned long long)copias, lido);
+        erros++;
+    }
+    
+    // A cópia de quem leu foi invalidada: a leitura seguinte traz a escrita
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Escrita", seguinte);
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 17.3 Cópia do bloco %d não foi invalidada pela escrita do P%d", id, remoto, seguinte);
+        erros++;
+    }
+    return erros;
+}
+
+// Diretório de cópias: o dono registra só os processos que leram o bloco,
+// e a escrita invalida essas cópias e esvazia o diretório
+void teste_diretorio() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int seguinte = (id + 1) % n;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DO DIRETÓRIO DE CÓPIAS", id);
+    
+    int lido = bloco_do_processo(id, ORDEM_DIRETORIO);
+    int sem_leitores = bloco_do_processo(id, ORDEM_SEM_LEITORES);
+    if (n < 3 || lido < 0 || sem_leitores < 0 || bloco_do_processo(seguinte, ORDEM_DIRETORIO) < 0 ||
+        dsm_global->tamanho_bloco < TAMANHO_TEXTO) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    definir_protocolo_da_ordem(ORDEM_DIRETORIO, PROTOCOLO_INVALIDACAO);
+    definir_protocolo_da_ordem(ORDEM_SEM_LEITORES, PROTOCOLO_INVALIDACAO);
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 17. Testando o diretório dos blocos %d e %d", id, lido, sem_leitores);
+    int erros = verificar_diretorio(lido, sem_leitores, seguinte);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 17.4 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 17.1 Diretório só com quem leu, esvaziado e invalidado pela escrita", id);
+    }
+}
+
+// =============================================================================
+// TESTE DA CONSISTÊNCIA DE LIBERAÇÃO
+// =============================================================================
+
+#define ORDEM_LIBERACAO 166
+#define ORDEM_LIBERACAO_REMOTA 170
+#define ROTULO_LIBERACAO "Escrita em duas metades"  // Muda as duas metades do texto
+
+// Escreve o texto em duas metades contíguas, combinadas pelo modo de liberação
+static int escrever_em_metades(int posicao, const char *texto) {
+    int metade = TAMANHO_TEXTO / 2;
+    if (escreve(posicao, (byte*)texto, metade) != 0 ||
+        escreve(posicao + metade, (byte*)texto + metade, TAMANHO_TEXTO - metade) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Etapas do teste da liberação: até o release, as escritas no bloco próprio
+// não invalidam a cópia do anterior e as no bloco do seguinte ficam no
+// cache; o release envia tudo de uma vez. Retorna o número de falhas, ou -1
+// se uma barreira expirou.
+static int verificar_liberacao(int local, int remoto, int seguinte) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    int anterior = (id + n - 1) % n;
+    int idx_local = obter_indice_local(local);
+    int lido = bloco_do_processo(seguinte, ORDEM_LIBERACAO);
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    byte dados[TAMANHO_TEXTO];
+    
+    montar_texto(texto, "Bloco", id);
+    if (escreve(local * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    if (barreira_dsm() != 0) return -1;
+    if (le(lido * tamanho, dados, sizeof(dados)) != 0) erros++;
+    if (barreira_dsm() != 0) return -1;
+    
+    // Escritas adiadas: nenhuma mensagem antes do release
+    EstatisticasDSM antes, meio, depois;
+    dsm_get_stats(&antes);
+    montar_texto(texto, ROTULO_LIBERACAO, id);
+    if (escrever_em_metades(local * tamanho, texto) != 0 || escrever_em_metades(remoto * tamanho, texto) != 0) erros++;
+    dsm_get_stats(&meio);
+    uint64_t copias = __atomic_load_n(&dsm_global->compartilhadores[idx_local], __ATOMIC_SEQ_CST);
+    if (meio.escritas_adiadas != antes.escritas_adiadas + 4 ||
+        meio.escritas_remotas_enviadas != antes.escritas_remotas_enviadas ||
+        !(copias & ((uint64_t)1 << anterior))) {
+        log_erro("\n  ▶ ", "[P%d] 18.2 Escritas antes do release: %llu adiadas, %llu enviadas, diretório 0x%llx", id,
+                 (unsigned long long)(meio.escritas_adiadas - antes.escritas_adiadas),
+                 (unsigned long long)(meio.escritas_remotas_enviadas - antes.escritas_remotas_enviadas),
+                 (unsigned long long)copias);
+        erros++;
+    }
+    
+    // O release devolve o bloco remoto em uma escrita e invalida a cópia do bloco próprio
+    if (dsm_release() != 0) erros++;
+    dsm_get_stats(&depois);
+    copias = __atomic_load_n(&dsm_global->compartilhadores[idx_local], __ATOMIC_SEQ_CST);
+    if (depois.escritas_remotas_enviadas != meio.escritas_remotas_enviadas + 1 || copias != 0) {
+        log_erro("\n  ▶ ", "[P%d] 18.3 Release: %llu escritas enviadas, diretório 0x%llx", id,
+                 (unsigned long long)(depois.escritas_remotas_enviadas - meio.escritas_remotas_enviadas),
+                 (unsigned long long)copias);
+        erros++;
+    }
+    
+    // Depois da barreira, as escritas de todos estão visíveis
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, ROTULO_LIBERACAO, seguinte);
+    if (le(lido * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 18.4 Escrita do P%d no bloco %d não ficou visível", id, seguinte, lido);
+        erros++;
+    }
+    int recebido = bloco_do_processo(id, ORDEM_LIBERACAO_REMOTA);
+    montar_texto(texto, ROTULO_LIBERACAO, anterior);
+    if (le(recebido * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 18.4 Escrita do P%d no bloco %d não chegou ao dono", id, anterior, recebido);
+        erros++;
+    }
+    return erros;
+}
+
+// Consistência de liberação: escritas combinadas e invalidações em lote no
+// release. Todos os processos passam ao modo CONSISTENCIA_RELEASE durante o teste.
+void teste_liberacao() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int seguinte = (id + 1) % n;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DA CONSISTÊNCIA DE LIBERAÇÃO", id);
+    
+    int local = bloco_do_processo(id, ORDEM_LIBERACAO);
+    int remoto = bloco_do_processo(seguinte, ORDEM_LIBERACAO_REMOTA);
+    if (n < 2 || local < 0 || remoto < 0 || bloco_do_processo(id, ORDEM_LIBERACAO_REMOTA) < 0 ||
+        dsm_global->tamanho_bloco < TAMANHO_TEXTO) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    definir_protocolo_da_ordem(ORDEM_LIBERACAO, PROTOCOLO_INVALIDACAO);
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 18. Testando escritas adiadas até o release nos blocos %d e %d", id, local, remoto);
+    ModoConsistencia modo_original = dsm_global->config.modo_consistencia;
+    dsm_global->config.modo_consistencia = CONSISTENCIA_RELEASE;
+    int erros = verificar_liberacao(local, remoto, seguinte);
+    dsm_release();
+    dsm_global->config.modo_consistencia = modo_original;
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 18.5 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 18.1 Escritas combinadas e enviadas de uma vez no release", id);
+    }
+}
+
+// =============================================================================
+// TESTE DAS ESTATÍSTICAS
+// =============================================================================
+
+#define ORDEM_ESTATISTICAS 158
+#define THREADS_ESTATISTICAS 4
+#define LEITURAS_ESTATISTICAS 2000
+
+typedef struct {
+    int posicao;
+    int resultado;
+} LeiturasRepetidas;
+
+static void* ler_repetidamente(void* arg) {
+    LeiturasRepetidas *leituras = (LeiturasRepetidas*)arg;
+    byte dados[TAMANHO_TEXTO];
+    leituras->resultado = 0;
+    for (int i = 0; i < LEITURAS_ESTATISTICAS; i++) {
+        if (le(leituras->posicao, dados, sizeof(dados)) != 0) leituras->resultado = -1;
+    }
+    return NULL;
+}
+
+// Várias threads leem a mesma posição; retorna o número de threads que
+// não rodaram ou falharam
+static int ler_em_threads(int posicao) {
+    pthread_t threads[THREADS_ESTATISTICAS];
+    LeiturasRepetidas leituras[THREADS_ESTATISTICAS];
+    int criadas = 0;
+    for (; criadas < THREADS_ESTATISTICAS; criadas++) {
+        leituras[criadas].posicao = posicao;
+        if (pthread_create(&threads[criadas], NULL, ler_repetidamente, &leituras[criadas]) != 0) break;
+    }
+    int falhas = THREADS_ESTATISTICAS - criadas;
+    for (int t = 0; t < criadas; t++) {
+        pthread_join(threads[t], NULL);
+        if (leituras[t].resultado != 0) falhas++;
+    }
+    return falhas;
+}
+
+// Resumo coerente: mínimo <= p50 <= p99 <= máximo, média entre os extremos
+static int resumo_coerente(const ResumoLatencia *r) {
+    return r->amostras > 0 && r->minimo_ns <= r->p50_ns && r->p50_ns <= r->p99_ns && r->p99_ns <= r->maximo_ns &&
+           r->media_ns >= (double)r->minimo_ns && r->media_ns <= (double)r->maximo_ns;
+}
+
+// Etapas do teste das estatísticas. Retorna o número de falhas.
+static int verificar_estatisticas(int local, int remoto) {
+    int id = dsm_global->meu_id;
+    int tamanho = dsm_global->tamanho_bloco;
+    uint64_t total = (uint64_t)THREADS_ESTATISTICAS * LEITURAS_ESTATISTICAS;
+    int erros = 0;
+    byte dados[TAMANHO_TEXTO];
+    EstatisticasDSM antes, depois;
+    
+    // Leituras locais concorrentes: nenhuma amostra se perde entre os fragmentos
+    dsm_get_stats(&antes);
+    if (ler_em_threads(local * tamanho) != 0) erros++;
+    dsm_get_stats(&depois);
+    uint64_t amostras = depois.latencias[LATENCIA_LEITURA_LOCAL].amostras - antes.latencias[LATENCIA_LEITURA_LOCAL].amostras;
+    if (amostras != total || !resumo_coerente(&depois.latencias[LATENCIA_LEITURA_LOCAL])) {
+        log_erro("\n  ▶ ", "[P%d] 19.2 %llu amostras de leitura local para %llu leituras concorrentes", id,
+                 (unsigned long long)amostras, (unsigned long long)total);
+        erros++;
+    }
+    
+    // Um miss: uma requisição múltipla de um par, com o cabeçalho, e uma busca remota
+    dsm_get_stats(&antes);
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0) erros++;
+    dsm_get_stats(&depois);
+    uint64_t mensagens = depois.mensagens_enviadas[MSG_REQUISICAO_MULTIPLA] - antes.mensagens_enviadas[MSG_REQUISICAO_MULTIPLA];
+    uint64_t bytes = depois.bytes_enviados[MSG_REQUISICAO_MULTIPLA] - antes.bytes_enviados[MSG_REQUISICAO_MULTIPLA];
+    if (depois.cache_misses != antes.cache_misses + 1 || mensagens != 1 ||
+        bytes != TAMANHO_CABECALHO + TAMANHO_PAR_REQUISICAO ||
+        depois.latencias[LATENCIA_BUSCA_REMOTA].amostras != antes.latencias[LATENCIA_BUSCA_REMOTA].amostras + 1) {
+        log_erro("\n  ▶ ", "[P%d] 19.3 Miss do bloco %d: %llu mensagens de %llu bytes", id, remoto,
+                 (unsigned long long)mensagens, (unsigned long long)bytes);
+        erros++;
+    }
+    
+    // Hits concorrentes no bloco trazido
+    dsm_get_stats(&antes);
+    if (ler_em_threads(remoto * tamanho) != 0) erros++;
+    dsm_get_stats(&depois);
+    amostras = depois.latencias[LATENCIA_CACHE_HIT].amostras - antes.latencias[LATENCIA_CACHE_HIT].amostras;
+    if (depois.cache_hits - antes.cache_hits != total || amostras != total ||
+        depois.cache_misses != antes.cache_misses || !resumo_coerente(&depois.latencias[LATENCIA_CACHE_HIT])) {
+        log_erro("\n  ▶ ", "[P%d] 19.4 %llu hits e %llu amostras para %llu leituras concorrentes do bloco %d", id,
+                 (unsigned long long)(depois.cache_hits - antes.cache_hits), (unsigned long long)amostras,
+                 (unsigned long long)total, remoto);
+        erros++;
+    }
+    return erros;
+}
+
+// Contadores por thread e histogramas: leituras concorrentes contadas sem
+// perdas e tráfego de um miss contado por tipo de mensagem. Só leituras:
+// não usa barreiras.
+void teste_estatisticas() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DAS ESTATÍSTICAS", id);
+    
+    int local = bloco_do_processo(id, ORDEM_ESTATISTICAS);
+    int remoto = bloco_do_processo((id + 1) % n, ORDEM_ESTATISTICAS);
+    if (n < 2 || local < 0 || remoto < 0 || dsm_global->tamanho_bloco < TAMANHO_TEXTO) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    
+    // Sem o rastreamento de cada leitura na saída
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 19. Testando contadores e histogramas com %d threads", id, THREADS_ESTATISTICAS);
+    dsm_definir_nivel_log(NIVEL_LOG_INFO);
+    int erros = verificar_estatisticas(local, remoto);
+    dsm_definir_nivel_log(dsm_global->config.nivel_log);
+    if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 19.1 Contadores sem perdas, histogramas coerentes e tráfego por tipo", id);
+    }
+}
+
+// =============================================================================
+// TESTE DAS LEITURAS CONCORRENTES COM ESCRITAS
+// =============================================================================
+
+#define ORDEM_SEQLOCK 174
+#define DURACAO_SEQLOCK_MS 300
+#define LEITORES_SEQLOCK 2
+
+typedef struct {
+    int posicao;
+    int escritor;       // 1: escreve blocos uniformes; 0: lê e confere
+    int *fim;
+    int operacoes;
+    int rasgadas;       // Leituras com bytes de escritas diferentes
+    int falhas;
+} AcessoSeqlock;
+
+// Um bloco inteiro com todos os bytes iguais; leitura rasgada tem bytes diferentes
+static int bloco_uniforme(const byte *dados, int tamanho) {
+    for (int i = 1; i < tamanho; i++) {
+        if (dados[i] != dados[0]) return 0;
+    }
+    return 1;
+}
+
+static void* acessar_bloco_seqlock(void* arg) {
+    AcessoSeqlock *acesso = (AcessoSeqlock*)arg;
+    int tamanho = dsm_global->tamanho_bloco;
+    byte *dados = (byte*)malloc(tamanho);
+    if (!dados) {
+        acesso->falhas++;
+        return NULL;
+    }
+    while (!__atomic_load_n(acesso->fim, __ATOMIC_ACQUIRE)) {
+        if (acesso->escritor) {
+            // No modo de liberação, o release leva a escrita às cópias remotas
+            memset(dados, 1 + acesso->operacoes % 250, tamanho);
+            if (escreve(acesso->posicao, dados, tamanho) != 0 || dsm_release() != 0) acesso->falhas++;
+        } else if (le(acesso->posicao, dados, tamanho) != 0) {
+            acesso->falhas++;
+        } else if (!bloco_uniforme(dados, tamanho)) {
+            acesso->rasgadas++;
+        }
+        acesso->operacoes++;
+    }
+    free(dados);
+    return NULL;
+}
+
+// Cada processo escreve no bloco próprio enquanto threads locais o leem e o
+// processo anterior o lê pela rede: nenhuma leitura pode misturar escritas.
+// Retorna o número de falhas, ou -1 se uma barreira expirou.
+static int verificar_seqlock(int local, int remoto) {
+    int id = dsm_global->meu_id;
+    int tamanho = dsm_global->tamanho_bloco;
+    AcessoSeqlock acessos[LEITORES_SEQLOCK + 2];
+    pthread_t threads[LEITORES_SEQLOCK + 2];
+    int fim = 0;
+    
+    // Escritor e leitores do bloco próprio, e um leitor do bloco do seguinte
+    memset(acessos, 0, sizeof(acessos));
+    for (int t = 0; t < LEITORES_SEQLOCK + 2; t++) {
+        acessos[t].posicao = (t == LEITORES_SEQLOCK + 1 ? remoto : local) * tamanho;
+        acessos[t].escritor = t == 0;
+        acessos[t].fim = &fim;
+    }
+    if (barreira_dsm() != 0) return -1;
+    int criadas = 0;
+    for (; criadas < LEITORES_SEQLOCK + 2; criadas++) {
+        if (pthread_create(&threads[criadas], NULL, acessar_bloco_seqlock, &acessos[criadas]) != 0) break;
+    }
+    usleep(DURACAO_SEQLOCK_MS * 1000);
+    __atomic_store_n(&fim, 1, __ATOMIC_RELEASE);
+    
+    int erros = criadas < LEITORES_SEQLOCK + 2;
+    for (int t = 0; t < criadas; t++) {
+        pthread_join(threads[t], NULL);
+        if (acessos[t].falhas || acessos[t].rasgadas || acessos[t].operacoes == 0) {
+            log_erro("\n  ▶ ", "[P%d] 20.2 %s do bloco %d: %d operações, %d rasgadas, %d falhas", id,
+                     acessos[t].escritor ? "Escritor" : "Leitor", acessos[t].posicao / tamanho,
+                     acessos[t].operacoes, acessos[t].rasgadas, acessos[t].falhas);
+            erros++;
+        }
+    }
+    if (barreira_dsm() != 0) return -1;
+    return erros;
+}
+
+// Leituras locais e remotas de um bloco durante escritas contínuas nele
+void teste_seqlock() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DAS LEITURAS CONCORRENTES COM ESCRITAS", id);
+    
+    int local = bloco_do_processo(id, ORDEM_SEQLOCK);
+    int remoto = bloco_do_processo((id + 1) % n, ORDEM_SEQLOCK);
+    if (n < 2 || local < 0 || remoto < 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    definir_protocolo_da_ordem(ORDEM_SEQLOCK, PROTOCOLO_INVALIDACAO);
+    
+    // Sem o rastreamento de cada acesso na saída
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 20. Testando leituras do bloco %d durante escritas por %d ms", id, local, DURACAO_SEQLOCK_MS);
+    dsm_definir_nivel_log(NIVEL_LOG_INFO);
+    int erros = verificar_seqlock(local, remoto);
+    dsm_definir_nivel_log(dsm_global->config.nivel_log);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 20.3 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 20.1 Nenhuma leitura local ou remota misturou escritas", id);
+    }
+}
+
+// =============================================================================
+// TESTE DA REVALIDAÇÃO DE CÓPIAS
+// =============================================================================
+
+#define ORDEM_REVALIDACAO 178
+
+// Etapas do teste da revalidação. Cada processo lê o bloco do seguinte; o
+// dono invalida a cópia do anterior sem mudar o bloco e, depois, escreve e
+// desfaz a escrita. Retorna o número de falhas, ou -1 se uma barreira expirou.
+static int verificar_revalidacao(int local, int remoto, int seguinte) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int tamanho = dsm_global->tamanho_bloco;
+    uint64_t bit_anterior = (uint64_t)1 << ((id + n - 1) % n);
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    char esperado[TAMANHO_TEXTO];
+    byte dados[TAMANHO_TEXTO];
+    EstatisticasDSM antes, depois;
+    
+    montar_texto(texto, "Bloco", id);
+    montar_texto(esperado, "Bloco", seguinte);
+    if (escreve(local * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    if (barreira_dsm() != 0) return -1;
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0) erros++;
+    
+    // Escrita dos mesmos bytes: sem nova versão nem invalidação
+    if (barreira_dsm() != 0) return -1;
+    dsm_get_stats(&antes);
+    if (escreve(local * tamanho, (byte*)texto, sizeof(texto)) != 0 || dsm_release() != 0) erros++;
+    dsm_get_stats(&depois);
+    uint64_t copias = __atomic_load_n(&dsm_global->compartilhadores[obter_indice_local(local)], __ATOMIC_SEQ_CST);
+    if (depois.escritas_sem_efeito != antes.escritas_sem_efeito + 1 || copias != bit_anterior) {
+        log_erro("\n  ▶ ", "[P%d] 21.2 Escrita sem efeito no bloco %d mudou o diretório para 0x%llx", id, local,
+                 (unsigned long long)copias);
+        erros++;
+    }
+    
+    // Cópia invalidada sem mudança no bloco: a busca só leva o cabeçalho
+    if (invalidar_caches_remotos(local) != 1) erros++;
+    if (barreira_dsm() != 0) return -1;
+    dsm_get_stats(&antes);
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, esperado, sizeof(esperado)) != 0) erros++;
+    dsm_get_stats(&depois);
+    uint64_t nao_modificado = depois.bytes_recebidos[MSG_NAO_MODIFICADO] - antes.bytes_recebidos[MSG_NAO_MODIFICADO];
+    uint64_t blocos = depois.mensagens_recebidas[MSG_RESPOSTA_BLOCO] - antes.mensagens_recebidas[MSG_RESPOSTA_BLOCO];
+    if (depois.revalidacoes != antes.revalidacoes + 1 || nao_modificado != TAMANHO_CABECALHO || blocos != 0) {
+        log_erro("\n  ▶ ", "[P%d] 21.3 Cópia do bloco %d: %llu revalidações, %llu bytes de MSG_NAO_MODIFICADO, %llu blocos", id,
+                 remoto, (unsigned long long)(depois.revalidacoes - antes.revalidacoes),
+                 (unsigned long long)nao_modificado, (unsigned long long)blocos);
+        erros++;
+    }
+    
+    // Escrita desfeita (A→B→A): a versão mudou e a cópia não é revalidada
+    if (barreira_dsm() != 0) return -1;
+    char outro[TAMANHO_TEXTO];
+    montar_texto(outro, "Outro", id);
+    if (escreve(local * tamanho, (byte*)outro, sizeof(outro)) != 0 || dsm_release() != 0 ||
+        escreve(local * tamanho, (byte*)texto, sizeof(texto)) != 0) {
+        erros++;
+    }
+    if (barreira_dsm() != 0) return -1;
+    dsm_get_stats(&antes);
+    if (le(remoto * tamanho, dados, sizeof(dados)) != 0 || memcmp(dados, esperado, sizeof(esperado)) != 0) erros++;
+    dsm_get_stats(&depois);
+    if (depois.revalidacoes != antes.revalidacoes || depois.cache_misses != antes.cache_misses + 1) {
+        log_erro("\n  ▶ ", "[P%d] 21.4 Cópia do bloco %d revalidada depois de uma escrita desfeita", id, remoto);
+        erros++;
+    }
+    return erros;
+}
+
+// Revalidação com MSG_NAO_MODIFICADO: a cópia invalidada de um bloco que
+// não mudou volta a valer, e uma escrita desfeita ainda reenvia o bloco
+void teste_revalidacao() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int seguinte = (id + 1) % n;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DA REVALIDAÇÃO DE CÓPIAS", id);
+    
+    int local = bloco_do_processo(id, ORDEM_REVALIDACAO);
+    int remoto = bloco_do_processo(seguinte, ORDEM_REVALIDACAO);
+    if (n < 3 || local < 0 || remoto < 0 || dsm_global->tamanho_bloco < TAMANHO_TEXTO) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes para o teste; ignorado", id);
+        return;
+    }
+    definir_protocolo_da_ordem(ORDEM_REVALIDACAO, PROTOCOLO_INVALIDACAO);
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 21. Testando a revalidação da cópia do bloco %d", id, remoto);
+    int erros = verificar_revalidacao(local, remoto, seguinte);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 21.5 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 21.1 Cópia revalidada só com o cabeçalho e escrita desfeita reenviada", id);
+    }
+}
+
+// =============================================================================
+// TESTE DO LOG ASSÍNCRONO
+// =============================================================================
+
+#define THREADS_LOG_TESTE 4
+#define DURACAO_LOG_TESTE_MS 20     // Registro antes e depois da parada
+
+static int linhas_log_emitidas = 0;
+static int fim_linhas_log = 0;
+
+static void* emitir_linhas_log(void* arg) {
+    int thread = *(int*)arg;
+    for (int i = 0; !__atomic_load_n(&fim_linhas_log, __ATOMIC_RELAXED); i++) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] LOG-TESTE %d %d", dsm_global->meu_id, thread, i);
+        __atomic_fetch_add(&linhas_log_emitidas, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// Conta as linhas do arquivo que contêm 'marca'; -1 se não abrir
+static int contar_linhas_log(const char *caminho, const char *marca) {
+    FILE *arquivo = fopen(caminho, "r");
+    if (!arquivo) return -1;
+    char linha[TAMANHO_LINHA_LOG + 64];
+    int total = 0;
+    while (fgets(linha, sizeof(linha), arquivo)) {
+        if (strstr(linha, marca)) total++;
+    }
+    fclose(arquivo);
+    return total;
+}
+
+// Com a saída desviada para 'caminho': threads registram linhas enquanto o
+// modo assíncrono é desligado, e cada linha sai ou é contada como descartada;
+// depois, os níveis de log_padronizado e log_erro não dependem da cor.
+// Retorna o número de falhas, ou -1 se o desvio da saída falhou.
+static int verificar_log_assincrono(const char *caminho) {
+    int id = dsm_global->meu_id;
+    fflush(stdout);
+    int saida = dup(STDOUT_FILENO);
+    int arquivo = open(caminho, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (saida < 0 || arquivo < 0 || dup2(arquivo, STDOUT_FILENO) < 0) {
+        if (saida >= 0) close(saida);
+        if (arquivo >= 0) close(arquivo);
+        return -1;
+    }
+    close(arquivo);
+    
+    // Só as linhas de nível INFO do teste: as de depuração dos workers
+    // também poderiam ser descartadas e entrar na contagem
+    dsm_definir_nivel_log(NIVEL_LOG_INFO);
+    EstatisticasDSM antes, depois;
+    dsm_get_stats(&antes);
+    
+    int emitidas_na_parada = -1;
+    pthread_t threads[THREADS_LOG_TESTE];
+    int ids[THREADS_LOG_TESTE];
+    int criadas = 0;
+    __atomic_store_n(&linhas_log_emitidas, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&fim_linhas_log, 0, __ATOMIC_RELAXED);
+    if (dsm_iniciar_log_assincrono() == 0) {
+        for (; criadas < THREADS_LOG_TESTE; criadas++) {
+            ids[criadas] = criadas;
+            if (pthread_create(&threads[criadas], NULL, emitir_linhas_log, &ids[criadas]) != 0) break;
+        }
+        usleep(DURACAO_LOG_TESTE_MS * 1000);
+        emitidas_na_parada = __atomic_load_n(&linhas_log_emitidas, __ATOMIC_RELAXED);
+        dsm_parar_log_assincrono();
+        usleep(DURACAO_LOG_TESTE_MS * 1000);
+        __atomic_store_n(&fim_linhas_log, 1, __ATOMIC_RELAXED);
+        for (int t = 0; t < criadas; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    dsm_get_stats(&depois);
+    
+    // Níveis explícitos: log_padronizado é INFO mesmo na cor de erro
+    dsm_definir_nivel_log(NIVEL_LOG_ERRO);
+    log_padronizado(COLOR_ERROR, "    • ", "[P%d] LOG-NIVEL info", id);
+    log_erro("    • ", "[P%d] LOG-NIVEL erro", id);
+    dsm_definir_nivel_log(dsm_global->config.nivel_log);
+    if (dsm_global->config.log_assincrono) {
+        dsm_iniciar_log_assincrono();
+    }
+    
+    fflush(stdout);
+    dup2(saida, STDOUT_FILENO);
+    close(saida);
+    
+    int erros = 0;
+    int esperadas = __atomic_load_n(&linhas_log_emitidas, __ATOMIC_RELAXED) -
+                    (int)(depois.logs_descartados - antes.logs_descartados);
+    int escritas = contar_linhas_log(caminho, "LOG-TESTE");
+    if (criadas < THREADS_LOG_TESTE || escritas != esperadas) {
+        log_erro("\n  ▶ ", "[P%d] 15.2 %d linhas escritas, esperadas %d (%d threads, parada após %d)",
+                 id, escritas, esperadas, criadas, emitidas_na_parada);
+        erros++;
+    }
+    if (contar_linhas_log(caminho, "LOG-NIVEL") != 1 || contar_linhas_log(caminho, "LOG-NIVEL erro") != 1) {
+        log_erro("\n  ▶ ", "[P%d] 15.3 Nível de log decidido pela cor da linha", id);
+        erros++;
+    }
+    return erros;
+}
+
+// Parada do log assíncrono com threads registrando linhas e níveis
+// explícitos de log_padronizado e log_erro. Só local: não usa barreiras.
+void teste_log_assincrono() {
+    int id = dsm_global->meu_id;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DO LOG ASSÍNCRONO", id);
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 15. Testando a parada do log com %d threads registrando", id, THREADS_LOG_TESTE);
+    
+    char caminho[64];
+    snprintf(caminho, sizeof(caminho), "/tmp/test_dsm_%d_log.txt", (int)getpid());
+    int erros = verificar_log_assincrono(caminho);
+    unlink(caminho);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 15.4 Não foi possível desviar a saída para %s", id, caminho);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 15.1 Nenhuma linha perdida na parada e níveis explícitos", id);
+    }
+}
+
+// =============================================================================
+// TESTE DA MIGRAÇÃO DE BLOCOS
+// =============================================================================
+
+#define ORDEM_MIGRACAO 118
+
+// Reenvia ao dono atual a MSG_MIGRAR_BLOCO de um bloco que já migrou, como
+// depois de um ACK perdido. Retorna o tipo da resposta, ou -1 sem resposta.
+static int reenviar_migracao(int id_bloco, int destino, uint64_t versao, byte *dados) {
+    Mensagem msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.tipo = MSG_MIGRAR_BLOCO;
+    msg.id_bloco = id_bloco;
+    msg.tamanho_dados = dsm_global->tamanho_bloco;
+    msg.versao = versao;
+    msg.dados = dados;
+    
+    Mensagem resposta;
+    resposta.dados = NULL;
+    if (trocar_mensagens(destino, &msg, &resposta) != 0 || resposta.id_bloco != id_bloco) {
+        return -1;
+    }
+    return resposta.tipo;
+}
+
+// Etapas do teste da migração: cada processo migra um bloco seu para o
+// seguinte ('alvo') e recebe o do anterior. Retorna o número de falhas, ou
+// -1 se uma barreira expirou.
+static int verificar_migracao(int meu, int recebido, int remoto, byte *dados) {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    int alvo = (id + 1) % n;
+    int anterior = (id + n - 1) % n;
+    int tamanho = dsm_global->tamanho_bloco;
+    int erros = 0;
+    char texto[TAMANHO_TEXTO];
+    
+    montar_texto(texto, "Bloco", id);
+    if (escreve(meu * tamanho, (byte*)texto, sizeof(texto)) != 0) erros++;
+    
+    if (barreira_dsm() != 0) return -1;
+    if (migrar_bloco(meu, alvo) != 0 || obter_indice_local(meu) >= 0 || calcular_dono_bloco(meu) != alvo) {
+        log_erro("\n  ▶ ", "[P%d] 11.2 Bloco %d não migrou para o P%d", id, meu, alvo);
+        erros++;
+    }
+    
+    // O bloco do anterior é local; o do seguinte é lido no novo dono
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Bloco", anterior);
+    if (obter_indice_local(recebido) < 0 || le(recebido * tamanho, dados, sizeof(texto)) != 0 ||
+        memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 11.3 Bloco %d do P%d não foi instalado", id, recebido, anterior);
+        erros++;
+    }
+    montar_texto(texto, "Bloco", alvo);
+    if (le(remoto * tamanho, dados, sizeof(texto)) != 0 || memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 11.3 Bloco migrado %d lido com conteúdo incorreto", id, remoto);
+        erros++;
+    }
+    
+    // Reenvios: na mesma versão, um novo ACK; em outra, a recusa sem reinstalar
+    uint64_t versao = __atomic_load_n(&dsm_global->versoes_dono[meu], __ATOMIC_RELAXED);
+    memset(dados, 0, tamanho);
+    if (reenviar_migracao(meu, alvo, versao, dados) != MSG_ACK_MIGRACAO ||
+        reenviar_migracao(meu, alvo, versao + 1, dados) != MSG_BLOCO_JA_INSTALADO) {
+        log_erro("\n  ▶ ", "[P%d] 11.4 Reenvio da migração do bloco %d não foi idempotente", id, meu);
+        erros++;
+    }
+    if (barreira_dsm() != 0) return -1;
+    montar_texto(texto, "Bloco", anterior);
+    if (obter_indice_local(recebido) < 0 || le(recebido * tamanho, dados, sizeof(texto)) != 0 ||
+        memcmp(dados, texto, sizeof(texto)) != 0) {
+        log_erro("\n  ▶ ", "[P%d] 11.4 Reenvio alterou o bloco %d", id, recebido);
+        erros++;
+    }
+    return erros;
+}
+
+// Migração explícita de um bloco por processo, leitura no novo dono por
+// redirecionamento e reenvios da MSG_MIGRAR_BLOCO. Fica por último entre os
+// testes com o DSM: muda os donos usados por bloco_do_processo.
+void teste_migracao() {
+    int id = dsm_global->meu_id;
+    int n = dsm_global->num_processos;
+    log_padronizado(COLOR_STEP, "\n█ ", "[P%d] TESTE DA MIGRAÇÃO DE BLOCOS", id);
+    
+    int meu = bloco_do_processo(id, ORDEM_MIGRACAO);
+    int recebido = bloco_do_processo((id + n - 1) % n, ORDEM_MIGRACAO);
+    int remoto = bloco_do_processo((id + 1) % n, ORDEM_MIGRACAO);
+    byte *dados = (byte*)malloc(dsm_global->tamanho_bloco);
+    if (n < 2 || meu < 0 || recebido < 0 || remoto < 0 || !dados ||
+        dsm_global->tamanho_bloco < TAMANHO_TEXTO || dsm_global->config.intervalo_migracao_ms <= 0) {
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Processos ou blocos insuficientes, ou migração desligada; teste ignorado", id);
+        free(dados);
+        return;
+    }
+    
+    log_padronizado(COLOR_STEP, "\n  ▶ ", "[P%d] 11. Testando a migração do bloco %d para o P%d", id, meu, (id + 1) % n);
+    int erros = verificar_migracao(meu, recebido, remoto, dados);
+    if (erros < 0) {
+        log_erro("\n  ▶ ", "[P%d] 11.5 Barreira entre os processos expirou", id);
+    } else if (erros == 0) {
+        log_padronizado(COLOR_SUCCESS, "\n  ▶ ", "[P%d] 11.1 Bloco migrado, lido no novo dono e reenvio idempotente", id);
     }
+    free(dados);
 }
 
 void teste_interativo() {
@@ -132,10 +2214,10 @@ void teste_interativo() {
                         }
                         printf("\n");
                     } else {
-                        log_padronizado(COLOR_ERROR, "    • ", "[P%d] Falha na leitura", id);
+                        log_erro("    • ", "[P%d] Falha na leitura", id);
                     }
                 } else {
-                    log_padronizado(COLOR_ERROR, "    • ", "[P%d] Tamanho inválido", id);
+                    log_erro("    • ", "[P%d] Tamanho inválido", id);
                 }
             } else {
                 log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Uso: r <posicao> <tamanho>", id);
@@ -145,7 +2227,7 @@ void teste_interativo() {
                 if (escreve(posicao, (byte*)dados, strlen(dados) + 1) == 0) {
                     log_padronizado(COLOR_SUCCESS, "    • ", "[P%d] Escrita realizada com sucesso", id);
                 } else {
-                    log_padronizado(COLOR_ERROR, "    • ", "[P%d] Falha na escrita", id);
+                    log_erro("    • ", "[P%d] Falha na escrita", id);
                 }
             } else {
                 log_padronizado(COLOR_DEFAULT, "    • ", "[P%d] Uso: w <posicao> <dados>", id);
@@ -155,28 +2237,41 @@ void teste_interativo() {
         } else if (strcmp(comando, "c") == 0) {
             imprimir_estado_cache();
         } else {
-            log_padronizado(COLOR_ERROR, "    • ", "[P%d] Comando desconhecido: %s", id, comando);
+            log_erro("    • ", "[P%d] Comando desconhecido: %s", id, comando);
         }
     }
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 2 || argc > 3) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P?] Uso: %s <id_processo> [auto]", argv[0]);
+    if (argc < 2 || argc > 4) {
+        log_erro("    • ", "[P?] Uso: %s <id_processo> [auto] [arquivo_config]", argv[0]);
         log_padronizado(COLOR_DEFAULT, "    • ", "[P?] Onde id_processo é um número de 0 a %d", N_NUM_PROCESSOS - 1);
         log_padronizado(COLOR_DEFAULT, "    • ", "[P?] Use 'auto' como segundo parâmetro para modo automático (sem interativo)");
+        log_padronizado(COLOR_DEFAULT, "    • ", "[P?] arquivo_config: linhas 'chave = valor' com campos de ConfigDSM (ex.: tamanho_bloco = 64K)");
         return 1;
     }
     
     int meu_id = atoi(argv[1]);
     if (meu_id < 0 || meu_id >= N_NUM_PROCESSOS) {
-        log_padronizado(COLOR_ERROR, "    • ", "[P%d] ID de processo deve estar entre 0 e %d", meu_id, N_NUM_PROCESSOS - 1);
+        log_erro("    • ", "[P%d] ID de processo deve estar entre 0 e %d", meu_id, N_NUM_PROCESSOS - 1);
         return 1;
     }
     
-    // Verificar modo automático
-    if (argc == 3 && strcmp(argv[2], "auto") == 0) {
-        modo_automatico = 1;
+    // Verificar modo automático e arquivo de configuração
+    // O teste mostra o rastreamento do protocolo; o arquivo pode mudar o nível.
+    // A migração fica ligada para o teste 11 ter folga na arena, com um
+    // limiar que impede o rebalanceador de mudar os donos no meio dos testes
+    ConfigDSM config;
+    dsm_config_padrao(&config);
+    config.nivel_log = NIVEL_LOG_DEBUG;
+    config.intervalo_migracao_ms = 1000;
+    config.limiar_migracao = INT_MAX;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "auto") == 0) {
+            modo_automatico = 1;
+        } else if (dsm_carregar_config(argv[i], &config) != 0) {
+            return 1;
+        }
     }
     
     // Configurar handler para sinais
@@ -196,7 +2291,7 @@ int main(int argc, char *argv[]) {
     log_padronizado(COLOR_DEFAULT, "    • ","[P%d] Porta: %d", meu_id, processos[meu_id].porta);
     
     // Inicializar sistema DSM
-    if (dsm_init(meu_id, processos, N_NUM_PROCESSOS) != 0) {
+    if (dsm_init_config(meu_id, processos, N_NUM_PROCESSOS, &config) != 0) {
         log_padronizado(COLOR_DEFAULT, "    • ","[P%d] Falha ao inicializar sistema DSM", meu_id);
         return 1;
     }
@@ -224,6 +2319,20 @@ int main(int argc, char *argv[]) {
         
         // Executar testes
         teste_basico();
+        teste_deltas();
+        teste_protocolos();
+        teste_compressao();
+        teste_faixas();
+        teste_invalidacao();
+        teste_escritas_remotas();
+        teste_prefetch();
+        teste_diretorio();
+        teste_liberacao();
+        teste_estatisticas();
+        teste_seqlock();
+        teste_revalidacao();
+        teste_log_assincrono();
+        teste_migracao();
         // Aguardar mais tempo no modo automático para outros processos completarem
         sleep(15);
     }
@@ -235,6 +2344,12 @@ int main(int argc, char *argv[]) {
     // Limpar sistema (apenas se não foi chamado pelo signal_handler)
     if (continuar_executando) {
         dsm_cleanup();
+        
+        // Testes que inicializam o DSM de novo com outras configurações
+        if (modo_automatico) {
+            teste_mapa_distribuicao(meu_id);
+            teste_arquivo_configuracao(meu_id);
+        }
     }
     
     log_padronizado(COLOR_DEFAULT, "    • ","[P%d] Processo finalizado.", meu_id);